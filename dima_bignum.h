@@ -9,7 +9,9 @@
 
 		The difference between this and other implementations, is that the data structure
 		has optimal memory utilization (i.e. a 1024 bit integer takes up 128 bytes RAM),
-		and all memory is allocated statically: no dynamic allocation for better or worse.
+		and struct bn is allocated statically: no dynamic allocation for better or worse.
+		Only struct bnv, for numbers that do not fit struct bn, allocates its words, through
+		a pluggable allocator (malloc and free unless one is given).
 
 		Primary goals are correctness, clarity of code and clean, portable implementation.
 		Secondary goal is a memory footprint small enough to make it suitable for use in
@@ -54,6 +56,8 @@
 */
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <assert.h>
@@ -66,6 +70,24 @@
 /* Size of big-numbers in bytes */
 #define DBN_SZARR    (512 / DBN_SZWORD)
 
+/*
+	Operand lengths in words from which bignum_mul switches to Karatsuba and Toom-3.
+	With 4-byte words Karatsuba wins from 32 words on, Toom-3 does not pay off
+	within the 128 words of struct bn and is only reached with 2- and 1-byte
+	words (256 and 512 words). gor_bignum_fuzz.cpp shows how to test both.
+*/
+#ifndef DBN_KARATSUBA_CUTOFF
+#define DBN_KARATSUBA_CUTOFF 32
+#endif
+
+#ifndef DBN_TOOM3_CUTOFF
+#define DBN_TOOM3_CUTOFF 192
+#endif
+
+#if (DBN_KARATSUBA_CUTOFF < 4) || (DBN_TOOM3_CUTOFF < 4)
+#error Multiplication cutoffs must be at least 4 words, smaller halves do not shrink
+#endif
+
 
 /* Here comes the compile-time specialization for how large the underlying array size should be. */
 /* The choices are 1, 2 and 4 bytes in size with uint32, uint64 for DBN_SZWORD==4, as temporary. */
@@ -75,7 +97,7 @@
   /* Data type of array in structure */
 #define DBN_T                    uint8_t
 /* bitmask for getting MSB */
-#define DBN_T_MSB                ((DBN_T_TMP)(0x80))
+#define DBN_T_MSB                ((DBN_T_UTMP)(0x80))
 /* Data-type larger than DBN_T, for holding intermediate results of calculations */
 #define DBN_T_UTMP                uint32_t
 #define DBN_T_STMP                int32_t
@@ -83,20 +105,20 @@
 #define SPRINTF_FORMAT_STR       "%.02x"
 #define SSCANF_FORMAT_STR        "%2hhx"
 /* Max value of integer type */
-#define DBN_MAX_VAL                  ((DBN_T_TMP)0xFF)
+#define DBN_MAX_VAL                  ((DBN_T_UTMP)0xFF)
 #elif (DBN_SZWORD == 2)
 #define DBN_T                    uint16_t
 #define DBN_T_STMP               int32_t
 #define DBN_T_UTMP               uint32_t
-#define DBN_T_MSB                ((DBN_T_TMP)(0x8000))
+#define DBN_T_MSB                ((DBN_T_UTMP)(0x8000))
 #define SPRINTF_FORMAT_STR       "%.04x"
 #define SSCANF_FORMAT_STR        "%4hx"
-#define DBN_MAX_VAL                  ((DBN_T_TMP)0xFFFF)
+#define DBN_MAX_VAL                  ((DBN_T_UTMP)0xFFFF)
 #elif (DBN_SZWORD == 4)
 #define DBN_T                    uint32_t
 #define DBN_T_STMP               int64_t
 #define DBN_T_UTMP               uint64_t
-#define DBN_T_MSB                ((DBN_T_TMP)(0x80000000))
+#define DBN_T_MSB                ((DBN_T_UTMP)(0x80000000))
 #define SPRINTF_FORMAT_STR       "%.08x"
 #define SSCANF_FORMAT_STR        "%8x"
 #define DBN_MAX_VAL                  ((DBN_T_UTMP)0xFFFFFFFF)
@@ -114,6 +136,9 @@
 /*Custom macro for getting the biggest number from two numbers*/
 #define DIMA_BIGNUM_MAX(a, b) (((a) > (b)) ? (a) : (b))
 
+/*Custom macro for getting the smallest number from two numbers*/
+#define DIMA_BIGNUM_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
 /* Data-holding structure: array of DBN_Ts */
 struct bn
 {
@@ -123,6 +148,45 @@ struct bn
 
 
 
+/* Precomputed data for repeated reduction by the same modulus, see bignum_barrett_init() */
+struct bn_barrett
+{
+	int n; /* words in m */
+	int fallback; /* m = B^(n - 1), mu does not fit n + 1 words and bignum_mod is used */
+	struct bn m;
+	DBN_T mu[DBN_SZARR + 1]; /* B^(2n) / m */
+};
+
+/*
+	Allocator behind struct bnv. Sizes are in bytes, free gets the same size that
+	was asked from alloc. alloc returns 0 when out of memory.
+*/
+#define DBN_ALLOC(name) void* name(void* user, size_t size)
+typedef DBN_ALLOC(dbn_alloc_fn);
+
+#define DBN_FREE(name) void name(void* user, void* ptr, size_t size)
+typedef DBN_FREE(dbn_free_fn);
+
+struct bn_allocator
+{
+	dbn_alloc_fn* alloc;
+	dbn_free_fn* free;
+	void* user;
+};
+
+/*
+	Variable-width non-negative number. Only used words are stored, the top
+	one is never zero, so zero has used == 0. Grows through its allocator
+	and has no upper limit other than memory.
+*/
+struct bnv
+{
+	int used;
+	int alloc;
+	DBN_T* array;
+	struct bn_allocator* allocator;
+};
+
 /* Tokens returned by bignum_cmp() for value comparison */
 #define DIMA_BIGNUM_CMP_LARGER 1
 #define DIMA_BIGNUM_CMP_SMALLER -1
@@ -155,8 +219,15 @@ extern "C" {
 	DIMA_BIGNUM_DEF void bignum_add(struct bn* a, struct bn* b, struct bn* c); /* c = a + b */
 	DIMA_BIGNUM_DEF void bignum_sub(struct bn* a, struct bn* b, struct bn* c); /* c = a - b */
 	DIMA_BIGNUM_DEF void bignum_mul(struct bn* a, struct bn* b, struct bn* c); /* c = a * b */
+	DIMA_BIGNUM_DEF void bignum_mul_karatsuba(struct bn* a, struct bn* b, struct bn* c); /* c = a * b, Karatsuba / Toom-3 */
 	DIMA_BIGNUM_DEF void bignum_div(struct bn* a, struct bn* b, struct bn* c); /* c = a / b */
 	DIMA_BIGNUM_DEF void bignum_mod(struct bn* a, struct bn* b, struct bn* c); /* c = a % b */
+	DIMA_BIGNUM_DEF void bignum_divmod(struct bn* a, struct bn* b, struct bn* q, struct bn* r); /* q = a / b, r = a % b */
+	DIMA_BIGNUM_DEF DBN_T bignum_div_word(struct bn* a, DBN_T w, struct bn* q); /* q = a / w, returns a % w */
+
+	/* Barrett reduction, r = x % m for x below B^(2n) where m has n words. Larger x and m = B^(n - 1) fall back to bignum_mod */
+	DIMA_BIGNUM_DEF void bignum_barrett_init(struct bn_barrett* ctx, struct bn* m);
+	DIMA_BIGNUM_DEF void bignum_barrett_mod(struct bn* x, struct bn_barrett* ctx, struct bn* r);
 
 	/* Bitwise operations: */
 	DIMA_BIGNUM_DEF void bignum_and(struct bn* a, struct bn* b, struct bn* c); /* c = a & b */
@@ -172,8 +243,44 @@ extern "C" {
 	DIMA_BIGNUM_DEF void bignum_dec(struct bn* n);                             /* Decrement: subtract one from n */
 	DIMA_BIGNUM_DEF void bignum_pow(struct bn* a, struct bn* b, struct bn* c); /* Calculate a^b -- e.g. 2^10 => 1024 */
 
+	/*
+		r = a^e mod m for odd m, Montgomery multiplication with sliding windows.
+		The _ct version uses fixed 4-bit windows and reads the whole table for
+		every window, its time depends only on the length of m. e must not be
+		longer than m there, and a should already be below m
+	*/
+	DIMA_BIGNUM_DEF void bignum_powmod(struct bn* a, struct bn* e, struct bn* m, struct bn* r);
+	DIMA_BIGNUM_DEF void bignum_powmod_ct(struct bn* a, struct bn* e, struct bn* m, struct bn* r);
+
 	DIMA_BIGNUM_DEF void bignum_mul_pow2(struct bn* a, int32_t k, struct bn* c); /* Calculate c=a*(2^k) */
 
+	/*
+		Variable-width numbers. Every operation costs O(used) (O(used^2) or
+		less for mul and div) instead of scanning whole struct bn arrays.
+		Outputs may alias inputs. Functions returning int give 0 when the
+		allocator is out of memory, the output is left unchanged then.
+		allocator = 0 in bnv_init means malloc and free.
+	*/
+	DIMA_BIGNUM_DEF void bnv_init(struct bnv* n, struct bn_allocator* allocator);
+	DIMA_BIGNUM_DEF void bnv_free(struct bnv* n);
+	DIMA_BIGNUM_DEF int  bnv_reserve(struct bnv* n, int words);
+	DIMA_BIGNUM_DEF int  bnv_copy(struct bnv* dst, struct bnv* src);
+	DIMA_BIGNUM_DEF int  bnv_from_uint(struct bnv* n, DBN_T_UTMP i);
+	DIMA_BIGNUM_DEF int  bnv_from_data(struct bnv* n, void* data, int datasizeinbytes); /* little-endian bytes */
+	DIMA_BIGNUM_DEF int  bnv_to_data(struct bnv* n, void* data, int maxsize); /* returns bytes needed, 0 if maxsize is too small */
+	DIMA_BIGNUM_DEF int  bnv_from_bn(struct bnv* n, struct bn* a);
+	DIMA_BIGNUM_DEF int  bnv_to_bn(struct bn* r, struct bnv* n); /* 0 if n does not fit */
+
+	DIMA_BIGNUM_DEF int  bnv_cmp(struct bnv* a, struct bnv* b);
+	DIMA_BIGNUM_DEF int  bnv_is_zero(struct bnv* n);
+	DIMA_BIGNUM_DEF int  bnv_add(struct bnv* a, struct bnv* b, struct bnv* c); /* c = a + b */
+	DIMA_BIGNUM_DEF int  bnv_sub(struct bnv* a, struct bnv* b, struct bnv* c); /* c = a - b, a >= b */
+	DIMA_BIGNUM_DEF int  bnv_mul(struct bnv* a, struct bnv* b, struct bnv* c); /* c = a * b */
+	DIMA_BIGNUM_DEF int  bnv_sqr(struct bnv* a, struct bnv* c);                /* c = a * a */
+	DIMA_BIGNUM_DEF int  bnv_divmod(struct bnv* a, struct bnv* b, struct bnv* q, struct bnv* r); /* q = a / b, r = a % b, q or r may be 0 */
+	DIMA_BIGNUM_DEF int  bnv_lshift(struct bnv* a, struct bnv* b, int nbits); /* b = a << nbits */
+	DIMA_BIGNUM_DEF int  bnv_rshift(struct bnv* a, struct bnv* b, int nbits); /* b = a >> nbits */
+
 #ifdef __cplusplus
 }
 #endif
@@ -191,10 +298,12 @@ static void _rshift_word(struct bn* a, int nwords)
 	require(nwords >= 0, "no negative shifts");
 
 	int i;
-	for (i = 0; i < nwords; ++i)
+	/* Shift whole words */
+	for (i = 0; i < (DBN_SZARR - nwords); ++i)
 	{
-		a->array[i] = a->array[i + 1];
+		a->array[i] = a->array[i + nwords];
 	}
+	/* Zero pad shifted words. */
 	for (; i < DBN_SZARR; ++i)
 	{
 		a->array[i] = 0;
@@ -221,32 +330,6 @@ static void _lshift_word(struct bn* a, int nwords)
 }
 
 
-static void _lshift_one_bit(struct bn* a)
-{
-	require(a, "a is null");
-
-	int i;
-	for (i = (DBN_SZARR - 1); i > 0; --i)
-	{
-		a->array[i] = (a->array[i] << 1) | (a->array[i - 1] >> ((8 * DBN_SZWORD) - 1));
-	}
-	a->array[0] <<= 1;
-}
-
-
-static void _rshift_one_bit(struct bn* a)
-{
-	require(a, "a is null");
-
-	int i;
-	for (i = 0; i < (DBN_SZARR - 1); ++i)
-	{
-		a->array[i] = (a->array[i] >> 1) | (a->array[i + 1] << ((8 * DBN_SZWORD) - 1));
-	}
-	a->array[DBN_SZARR - 1] >>= 1;
-}
-
-
 static inline int _get_szbytes(struct bn* a) {
 	int result = 0;
 
@@ -261,6 +344,11 @@ static inline int _get_szbytes(struct bn* a) {
 }
 
 
+static inline int _dbn_bit(DBN_T* a, int bitnum) {
+	return((a[bitnum / (DBN_SZWORD * 8)] >> (bitnum % (DBN_SZWORD * 8))) & 1);
+}
+
+
 /* Public / Exported functions. */
 void bignum_init(struct bn* n)
 {
@@ -530,7 +618,7 @@ void bignum_add(struct bn* a, struct bn* b, struct bn* c)
 	int i;
 	for (i = 0; i < DBN_SZARR; ++i)
 	{
-		tmp = a->array[i] + b->array[i] + carry;
+		tmp = (DBN_T_UTMP)a->array[i] + b->array[i] + carry;
 		carry = (tmp > DBN_MAX_VAL);
 		c->array[i] = (tmp & DBN_MAX_VAL);
 	}
@@ -575,6 +663,13 @@ void bignum_mul(struct bn* a, struct bn* b, struct bn* c)
 	int a_szbytes = _get_szbytes(a);
 	int b_szbytes = _get_szbytes(b);
 
+	/* Long operands go to Karatsuba / Toom-3 */
+	if (DIMA_BIGNUM_MIN(a_szbytes, b_szbytes) >= DBN_KARATSUBA_CUTOFF)
+	{
+		bignum_mul_karatsuba(a, b, c);
+		return;
+	}
+
 	bignum_init(c);
 
 	c->sign = a->sign * b->sign;
@@ -638,333 +733,1759 @@ void bignum_mul(struct bn* a, struct bn* b, struct bn* c)
 #endif
 }
 
-void bignum_mul_karatsuba(struct bn* a, struct bn* b, struct bn* res) {
-	/*
-		procedure karatsuba(num1, num2)
-			if (num1 < 10) or (num2 < 10)
-				return num1*num2
-			//calculates the size of the numbers
-			m = max(size_base10(num1), size_base10(num2))
-			m2 = m / 2
-			split the digit sequences about the middle
-			high1, low1 = split_at(num1, m2)
-			high2, low2 = split_at(num2, m2)
-			//3 calls made to numbers approximately half the size
-			z0 = karatsuba(low1, low2)
-			z1 = karatsuba((low1 + high1), (low2 + high2))
-			z2 = karatsuba(high1, high2)
-			return (z2 * 10 ^ (2 * m2)) + ((z1 - z2 - z0) * 10 ^ (m2)) + (z0)
-	*/
+/*
+	NOTE(dima): Word-array kernels for the fast multiplication. They work on
+	plain little-endian DBN_T arrays with explicit lengths, so the recursion runs
+	on halves and thirds of the numbers without building struct bn for them.
+*/
+#define _DBN_WORD_BITS (DBN_SZWORD * 8)
 
-	int a_szbytes = _get_szbytes(a);
-	int b_szbytes = _get_szbytes(b);
+/* Sizes of the local buffers. Operands of the kernels are never longer than DBN_SZARR + 2 words */
+#define _DBN_KARA_HALF (DBN_SZARR / 2 + 4)
+#define _DBN_TOOM_PAD (DBN_SZARR + 4)
+#define _DBN_TOOM_EVAL (DBN_SZARR / 3 + 6)
+#define _DBN_TOOM_COEF (2 * (DBN_SZARR / 3) + 12)
+
+static void _dbn_mul_words(DBN_T* r, DBN_T* a, DBN_T* b, int n);
 
-	if ((a_szbytes <= 1) || 
-		(b_szbytes <= 1)) 
+static void _dbn_zero_words(DBN_T* r, int n)
+{
+	int i;
+	for (i = 0; i < n; ++i)
 	{
-		return bignum_mul(a, b, res);
+		r[i] = 0;
 	}
+}
 
-	int32_t m = DIMA_BIGNUM_MAX(_get_szbytes(a), _get_szbytes(b));
-	int32_t m2 = m / 2;
-
-	struct bn high1, low1;
-	struct bn high2, low2;
-
-	struct bn z0, z1, z2;
-
-	int32_t split_at = m2;
-
-	/*Splitting first number*/
-	bignum_from_data(&low1, (uint8_t*)a->array, split_at);
-	bignum_from_data(&high1, (uint8_t*)a->array + split_at, a_szbytes - split_at);
-
-	/*Splitting second number*/
-	bignum_from_data(&low2, (uint8_t*)b->array, split_at);
-	bignum_from_data(&high2, (uint8_t*)b->array + split_at, b_szbytes - split_at);
-
-	/*Use of z0 and z1 as a temp variables*/
-	bignum_add(&low1, &high1, &z0);
-	bignum_add(&low2, &high2, &z2);
-	bignum_mul_karatsuba(&z0, &z2, &z1);
-	
-	/*Reusing them for algo*/
-	bignum_mul_karatsuba(&low1, &low2, &z0);
-	bignum_mul_karatsuba(&high1, &high2, &z2);
-	
-	bignum_mul_pow2(&z2, 2 * m2 * (DBN_SZWORD << 3), &high1);
+static void _dbn_copy_words(DBN_T* r, DBN_T* a, int n)
+{
+	int i;
+	for (i = 0; i < n; ++i)
+	{
+		r[i] = a[i];
+	}
+}
 
-	bignum_sub(&z1, &z2, &low1);
-	bignum_sub(&low1, &z0, &high2);
-	bignum_mul_pow2(&high2, m2 * (DBN_SZWORD << 3), &low1);
+/* r = a + b where an >= bn, r has an words and may alias a. Returns carry */
+static DBN_T _dbn_add_words(DBN_T* r, DBN_T* a, int an, DBN_T* b, int bn)
+{
+	DBN_T_UTMP carry = 0;
+	int i;
+	for (i = 0; i < bn; ++i)
+	{
+		carry += (DBN_T_UTMP)a[i] + b[i];
+		r[i] = (DBN_T)carry;
+		carry >>= _DBN_WORD_BITS;
+	}
+	for (; i < an; ++i)
+	{
+		carry += a[i];
+		r[i] = (DBN_T)carry;
+		carry >>= _DBN_WORD_BITS;
+	}
 
-	bignum_add(&high1, &low1, &high2);
+	return((DBN_T)carry);
 }
 
-void bignum_div(struct bn* a, struct bn* b, struct bn* c)
+/* r = a - b where an >= bn, r has an words and may alias a. Returns borrow */
+static DBN_T _dbn_sub_words(DBN_T* r, DBN_T* a, int an, DBN_T* b, int bn)
 {
-	require(a, "a is null");
-	require(b, "b is null");
-	require(c, "c is null");
+	DBN_T borrow = 0;
+	int i;
+	for (i = 0; i < an; ++i)
+	{
+		DBN_T bw = (i < bn) ? b[i] : 0;
+		DBN_T d = (DBN_T)(a[i] - bw);
+		DBN_T next = (d > a[i]);
 
-	struct bn current;
-	struct bn denom;
-	struct bn tmp;
+		r[i] = (DBN_T)(d - borrow);
+		borrow = next | (r[i] > d);
+	}
 
-	bignum_from_uint(&current, 1);               // int current = 1;
-	bignum_copy(&denom, b);                   // denom = b
-	bignum_copy(&tmp, a);                     // tmp   = a
+	return(borrow);
+}
 
-	const DBN_T_UTMP half_max = 1 + (DBN_T_UTMP)(DBN_MAX_VAL / 2);
-	bool overflow = false;
-	while (bignum_cmp(&denom, a) != DIMA_BIGNUM_CMP_LARGER)     // while (denom <= a) {
+static void _dbn_neg_words(DBN_T* a, int n)
+{
+	DBN_T carry = 1;
+	int i;
+	for (i = 0; i < n; ++i)
 	{
-		if (denom.array[DBN_SZARR - 1] >= half_max)
-		{
-			overflow = true;
-			break;
-		}
-		_lshift_one_bit(&current);                //   current <<= 1;
-		_lshift_one_bit(&denom);                  //   denom <<= 1;
+		a[i] = (DBN_T)(~a[i] + carry);
+		carry &= (a[i] == 0);
 	}
-	if (!overflow)
+}
+
+/* Arithmetic shift right by one bit of a two's complement number */
+static void _dbn_half_words(DBN_T* a, int n)
+{
+	DBN_T top = (DBN_T)(a[n - 1] & ((DBN_T)1 << (_DBN_WORD_BITS - 1)));
+	int i;
+	for (i = 0; i < n - 1; ++i)
 	{
-		_rshift_one_bit(&denom);                  // denom >>= 1;
-		_rshift_one_bit(&current);                // current >>= 1;
+		a[i] = (DBN_T)((a[i] >> 1) | (a[i + 1] << (_DBN_WORD_BITS - 1)));
 	}
-	bignum_init(c);                             // int answer = 0;
+	a[n - 1] = (DBN_T)((a[n - 1] >> 1) | top);
+}
 
-	while (!bignum_is_zero(&current))           // while (current != 0)
+/* a = a / 3 of a two's complement multiple of 3, by multiplying with 3 ^ -1 mod 2 ^ word bits */
+static void _dbn_divexact3_words(DBN_T* a, int n)
+{
+	const DBN_T inv3 = (DBN_T)((DBN_MAX_VAL / 3) * 2 + 1);
+	DBN_T c = 0;
+	int i;
+	for (i = 0; i < n; ++i)
 	{
-		if (bignum_cmp(&tmp, &denom) != DIMA_BIGNUM_CMP_SMALLER)  //   if (dividend >= denom)
-		{
-			bignum_sub(&tmp, &denom, &tmp);         //     dividend -= denom;
-			bignum_or(c, &current, c);              //     answer |= current;
-		}
-		_rshift_one_bit(&current);                //   current >>= 1;
-		_rshift_one_bit(&denom);                  //   denom >>= 1;
-	}                                           // return answer;
-}
+		DBN_T s = (DBN_T)(a[i] - c);
+		DBN_T borrow = (s > a[i]);
+		DBN_T q = (DBN_T)((DBN_T_UTMP)s * inv3);
 
+		a[i] = q;
+		c = (DBN_T)(borrow + (DBN_T)(((DBN_T_UTMP)q * 3) >> _DBN_WORD_BITS));
+	}
+}
 
-void bignum_lshift(struct bn* a, struct bn* b, int nbits)
+/* r = a * b, r has an + bn words and must not overlap the inputs */
+static void _dbn_mul_school(DBN_T* r, DBN_T* a, int an, DBN_T* b, int bn)
 {
-	require(a, "a is null");
-	require(b, "b is null");
-	require(nbits >= 0, "no negative shifts");
+	int i, j;
 
-	/* Handle shift in multiples of word-size */
-	const int nbits_pr_word = (DBN_SZWORD * 8);
-	int nwords = nbits / nbits_pr_word;
-	if (nwords != 0)
-	{
-		_lshift_word(a, nwords);
-		nbits -= (nwords * nbits_pr_word);
-	}
+	_dbn_zero_words(r, an + bn);
 
-	if (nbits != 0)
+	for (i = 0; i < an; ++i)
 	{
-		int i;
-		for (i = (DBN_SZARR - 1); i > 0; --i)
+		DBN_T_UTMP carry = 0;
+		for (j = 0; j < bn; ++j)
 		{
-			a->array[i] = (a->array[i] << nbits) | (a->array[i - 1] >> ((8 * DBN_SZWORD) - nbits));
+			carry += (DBN_T_UTMP)a[i] * b[j] + r[i + j];
+			r[i + j] = (DBN_T)carry;
+			carry >>= _DBN_WORD_BITS;
 		}
-		a->array[i] <<= nbits;
+		r[i + bn] = (DBN_T)carry;
 	}
-	bignum_copy(b, a);
 }
 
-
-void bignum_rshift(struct bn* a, struct bn* b, int nbits)
+/* r = (a * b) mod B^n, only the words below n are computed */
+static void _dbn_mul_low(DBN_T* r, DBN_T* a, int an, DBN_T* b, int bn, int n)
 {
-	require(a, "a is null");
-	require(b, "b is null");
-	require(nbits >= 0, "no negative shifts");
+	int i, j;
 
-	/* Handle shift in multiples of word-size */
-	const int nbits_pr_word = (DBN_SZWORD * 8);
-	int nwords = nbits / nbits_pr_word;
-	if (nwords != 0)
-	{
-		_rshift_word(a, nwords);
-		nbits -= (nwords * nbits_pr_word);
-	}
+	_dbn_zero_words(r, n);
 
-	if (nbits != 0)
+	for (i = 0; i < DIMA_BIGNUM_MIN(an, n); ++i)
 	{
-		int i;
-		for (i = 0; i < (DBN_SZARR - 1); ++i)
+		DBN_T_UTMP carry = 0;
+		int jn = DIMA_BIGNUM_MIN(bn, n - i);
+		for (j = 0; j < jn; ++j)
 		{
-			a->array[i] = (a->array[i] >> nbits) | (a->array[i + 1] << ((8 * DBN_SZWORD) - nbits));
+			carry += (DBN_T_UTMP)a[i] * b[j] + r[i + j];
+			r[i + j] = (DBN_T)carry;
+			carry >>= _DBN_WORD_BITS;
+		}
+		if (i + jn < n)
+		{
+			r[i + jn] = (DBN_T)carry;
 		}
-		a->array[i] >>= nbits;
 	}
-	bignum_copy(b, a);
 }
 
-
-void bignum_mod(struct bn* a, struct bn* b, struct bn* c)
+/*
+	r = a * b, n words each, r has 2 * n words.
+	a = a1 * B^h + a0, z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+*/
+static void _dbn_mul_karatsuba(DBN_T* r, DBN_T* a, DBN_T* b, int n)
 {
-	/*
-	mod(a,b) = a - ((a / b) * b)
+	DBN_T sa[_DBN_KARA_HALF];
+	DBN_T sb[_DBN_KARA_HALF];
+	DBN_T mid[_DBN_KARA_HALF * 2];
 
-	example:
-	mod(8, 3) = 8 - ((8 / 3) * 3) = 2
-	*/
-	require(a, "a is null");
-	require(b, "b is null");
-	require(c, "c is null");
+	int h = n / 2;
+	int k = n - h;
 
-	struct bn tmp;
+	/* z0 goes to r[0, 2h), z2 to r[2h, 2n) */
+	_dbn_mul_words(r, a, b, h);
+	_dbn_mul_words(r + 2 * h, a + h, b + h, k);
 
-	/* c = (a / b) */
-	bignum_div(a, b, c);
+	sa[k] = _dbn_add_words(sa, a + h, k, a, h);
+	sb[k] = _dbn_add_words(sb, b + h, k, b, h);
+	_dbn_mul_words(mid, sa, sb, k + 1);
 
-	/* tmp = (c * b) */
-	bignum_mul(c, b, &tmp);
+	_dbn_sub_words(mid, mid, 2 * k + 2, r, 2 * h);
+	_dbn_sub_words(mid, mid, 2 * k + 2, r + 2 * h, 2 * k);
 
-	/* c = a - tmp */
-	bignum_sub(a, &tmp, c);
+	//NOTE(dima): z1 fits into the rest of r, the words of mid above it are zero
+	_dbn_add_words(r + h, r + h, 2 * n - h, mid, DIMA_BIGNUM_MIN(2 * k + 2, 2 * n - h));
 }
 
-
-void bignum_and(struct bn* a, struct bn* b, struct bn* c)
+/* Two's complement signed value to magnitude, returns 1 when it was negative */
+static int _dbn_abs_words(DBN_T* a, int n)
 {
-	require(a, "a is null");
-	require(b, "b is null");
-	require(c, "c is null");
-
-	int i;
-	for (i = 0; i < DBN_SZARR; ++i)
+	int negative = (a[n - 1] >> (_DBN_WORD_BITS - 1)) & 1;
+	if (negative)
 	{
-		c->array[i] = (a->array[i] & b->array[i]);
+		_dbn_neg_words(a, n);
 	}
+
+	return(negative);
 }
 
+/*
+	Toom-3 evaluation at 0, 1, -1, -2, inf for one operand of 3 * k words.
+	Results are k + 2 words in two's complement
+*/
+static void _dbn_toom3_eval(DBN_T* v1, DBN_T* vm1, DBN_T* vm2, DBN_T* a, int k)
+{
+	DBN_T p[_DBN_TOOM_EVAL];
+	int e = k + 2;
+
+	/* p = a0 + a2 */
+	_dbn_zero_words(p, e);
+	_dbn_copy_words(p, a, k);
+	_dbn_add_words(p, p, e, a + 2 * k, k);
+
+	/* v1 = p + a1, vm1 = p - a1 */
+	_dbn_add_words(v1, p, e, a + k, k);
+	_dbn_sub_words(vm1, p, e, a + k, k);
+
+	/* vm2 = 2 * (vm1 + a2) - a0 */
+	_dbn_add_words(vm2, vm1, e, a + 2 * k, k);
+	_dbn_add_words(vm2, vm2, e, vm2, e);
+	_dbn_sub_words(vm2, vm2, e, a, k);
+}
 
-void bignum_or(struct bn* a, struct bn* b, struct bn* c)
+/* r = a * b as a two's complement number of l words */
+static void _dbn_toom3_signed_mul(DBN_T* r, int l, DBN_T* a, DBN_T* b, int e)
 {
-	require(a, "a is null");
-	require(b, "b is null");
-	require(c, "c is null");
+	int negative = _dbn_abs_words(a, e) ^ _dbn_abs_words(b, e);
 
-	int i;
-	for (i = 0; i < DBN_SZARR; ++i)
+	//NOTE(dima): Magnitudes are below 6 * B^k, one word less than e
+	_dbn_mul_words(r, a, b, e - 1);
+	_dbn_zero_words(r + 2 * (e - 1), l - 2 * (e - 1));
+	if (negative)
 	{
-		c->array[i] = (a->array[i] | b->array[i]);
+		_dbn_neg_words(r, l);
 	}
 }
 
-
-void bignum_xor(struct bn* a, struct bn* b, struct bn* c)
+/* r = a * b, n words each, r has 2 * n words. Bodrato's interpolation sequence */
+static void _dbn_mul_toom3(DBN_T* r, DBN_T* a, DBN_T* b, int n)
 {
-	require(a, "a is null");
-	require(b, "b is null");
-	require(c, "c is null");
+	DBN_T ap[_DBN_TOOM_PAD];
+	DBN_T bp[_DBN_TOOM_PAD];
+	DBN_T res[_DBN_TOOM_PAD * 2];
 
-	int i;
-	for (i = 0; i < DBN_SZARR; ++i)
-	{
-		c->array[i] = (a->array[i] ^ b->array[i]);
-	}
-}
+	DBN_T a1[_DBN_TOOM_EVAL], am1[_DBN_TOOM_EVAL], am2[_DBN_TOOM_EVAL];
+	DBN_T b1[_DBN_TOOM_EVAL], bm1[_DBN_TOOM_EVAL], bm2[_DBN_TOOM_EVAL];
 
+	DBN_T r1[_DBN_TOOM_COEF], rm1[_DBN_TOOM_COEF], rm2[_DBN_TOOM_COEF];
+	DBN_T r2[_DBN_TOOM_COEF], r3[_DBN_TOOM_COEF];
 
-int bignum_cmp(struct bn* a, struct bn* b)
-{
-	require(a, "a is null");
-	require(b, "b is null");
+	int k = (n + 2) / 3;
+	int e = k + 2;
+	int l = 2 * k + 4;
 
-	int i = DBN_SZARR;
-	do
-	{
-		--i; /* Decrement first, to start with last array element */
-		if (a->array[i] > b->array[i])
-		{
-			return DIMA_BIGNUM_CMP_LARGER;
-		}
-		else if (a->array[i] < b->array[i])
-		{
-			return DIMA_BIGNUM_CMP_SMALLER;
-		}
-	} while (i != 0);
+	/* Operands are padded up to 3 * k words, result is taken from 6 * k words */
+	_dbn_copy_words(ap, a, n);
+	_dbn_zero_words(ap + n, 3 * k - n);
+	_dbn_copy_words(bp, b, n);
+	_dbn_zero_words(bp + n, 3 * k - n);
 
-	return DIMA_BIGNUM_CMP_EQUAL;
-}
+	_dbn_toom3_eval(a1, am1, am2, ap, k);
+	_dbn_toom3_eval(b1, bm1, bm2, bp, k);
 
+	/* r(0) and r(inf) go straight into their places */
+	_dbn_mul_words(res, ap, bp, k);
+	_dbn_mul_words(res + 4 * k, ap + 2 * k, bp + 2 * k, k);
 
-int bignum_is_zero(struct bn* n)
-{
-	require(n, "n is null");
+	_dbn_mul_words(r1, a1, b1, e - 1);
+	_dbn_zero_words(r1 + 2 * (e - 1), l - 2 * (e - 1));
+	_dbn_toom3_signed_mul(rm1, l, am1, bm1, e);
+	_dbn_toom3_signed_mul(rm2, l, am2, bm2, e);
 
-	int i;
-	for (i = 0; i < DBN_SZARR; ++i)
-	{
-		if (n->array[i])
-		{
-			return 0;
-		}
-	}
+	/* r3 = (r(-2) - r(1)) / 3 */
+	_dbn_sub_words(r3, rm2, l, r1, l);
+	_dbn_divexact3_words(r3, l);
 
-	return 1;
+	/* r1 = (r(1) - r(-1)) / 2 */
+	_dbn_sub_words(r1, r1, l, rm1, l);
+	_dbn_half_words(r1, l);
+
+	/* r2 = r(-1) - r(0) */
+	_dbn_sub_words(r2, rm1, l, res, 2 * k);
+
+	/* r3 = (r2 - r3) / 2 + 2 * r(inf) */
+	_dbn_sub_words(r3, r2, l, r3, l);
+	_dbn_half_words(r3, l);
+	_dbn_add_words(r3, r3, l, res + 4 * k, 2 * k);
+	_dbn_add_words(r3, r3, l, res + 4 * k, 2 * k);
+
+	/* r2 = r2 + r1 - r(inf) */
+	_dbn_add_words(r2, r2, l, r1, l);
+	_dbn_sub_words(r2, r2, l, res + 4 * k, 2 * k);
+
+	/* r1 = r1 - r3 */
+	_dbn_sub_words(r1, r1, l, r3, l);
+
+	//NOTE(dima): r1, r2, r3 are non-negative now, r(0) and r(inf) do not overlap
+	_dbn_zero_words(res + 2 * k, 2 * k);
+	_dbn_add_words(res + k, res + k, 5 * k, r1, DIMA_BIGNUM_MIN(l, 5 * k));
+	_dbn_add_words(res + 2 * k, res + 2 * k, 4 * k, r2, DIMA_BIGNUM_MIN(l, 4 * k));
+	_dbn_add_words(res + 3 * k, res + 3 * k, 3 * k, r3, DIMA_BIGNUM_MIN(l, 3 * k));
+
+	_dbn_copy_words(r, res, 2 * n);
 }
 
+/* r = a * b, n words each, r has 2 * n words. Picks the algorithm by size */
+static void _dbn_mul_words(DBN_T* r, DBN_T* a, DBN_T* b, int n)
+{
+	if (n < DBN_KARATSUBA_CUTOFF)
+	{
+		_dbn_mul_school(r, a, n, b, n);
+	}
+	else if (n < DBN_TOOM3_CUTOFF)
+	{
+		_dbn_mul_karatsuba(r, a, b, n);
+	}
+	else
+	{
+		_dbn_mul_toom3(r, a, b, n);
+	}
+}
 
-void bignum_pow(struct bn* a, struct bn* b, struct bn* c)
+void bignum_mul_karatsuba(struct bn* a, struct bn* b, struct bn* c)
 {
 	require(a, "a is null");
 	require(b, "b is null");
 	require(c, "c is null");
 
-	struct bn tmp;
+	DBN_T prod[DBN_SZARR * 2];
+	DBN_T part[DBN_SZARR * 2];
+	DBN_T block[DBN_SZARR];
 
-	bignum_init(c);
+	int32_t sign = a->sign * b->sign;
+	int an = _get_szbytes(a);
+	int bn = _get_szbytes(b);
+	int i;
 
-	if (bignum_cmp(b, c) == DIMA_BIGNUM_CMP_EQUAL)
+	/* a is the longer one */
+	if (an < bn)
 	{
-		/* Return 1 when exponent is 0 -- n^0 = 1 */
-		bignum_inc(c);
+		struct bn* t = a;
+		a = b;
+		b = t;
+
+		i = an;
+		an = bn;
+		bn = i;
 	}
-	else
-	{
-		/* Copy a -> tmp */
-		bignum_copy(&tmp, a);
 
-		bignum_dec(b);
+	_dbn_zero_words(prod, DBN_SZARR * 2);
 
-		/* Begin summing products: */
-		while (!bignum_is_zero(b))
+	if (bn * 2 > an)
+	{
+		//NOTE(dima): Words of b above bn are zero, so it is already padded to an
+		_dbn_mul_words(prod, a->array, b->array, an);
+	}
+	else if (bn > 0)
+	{
+		/* Much shorter b: multiply it by blocks of a of the same length */
+		for (i = 0; i < an; i += bn)
 		{
+			int len = DIMA_BIGNUM_MIN(bn, an - i);
 
-			/* c = tmp * tmp */
-			bignum_mul(&tmp, a, c);
-			/* Decrement b by one */
-			bignum_dec(b);
-
-			bignum_copy(&tmp, c);
+			_dbn_copy_words(block, a->array + i, len);
+			_dbn_zero_words(block + len, bn - len);
+			_dbn_mul_words(part, block, b->array, bn);
+			_dbn_add_words(prod + i, prod + i, DBN_SZARR * 2 - i, part, 2 * bn);
 		}
-
-		/* c = tmp */
-		bignum_copy(c, &tmp);
 	}
+
+	/* Same truncation to DBN_SZARR words as in bignum_mul */
+	_dbn_copy_words(c->array, prod, DBN_SZARR);
+	c->sign = sign;
 }
 
-void bignum_mul_pow2(struct bn* a, int32_t k, struct bn* c) 
+/*
+	NOTE(dima): Long division of word arrays, Knuth's Algorithm D. The divisor
+	is shifted so that its top bit is set, then every quotient word is estimated
+	from the top two words of the remainder and the top word of the divisor,
+	fixed with the next word and is at most one too big after that.
+*/
+#define _DBN_DIV_MAX_WORDS (DBN_SZARR * 2 + 2)
+
+/* q = u / v for a single word v, q has un words and may be 0. Returns the remainder */
+static DBN_T _dbn_div_word(DBN_T* q, DBN_T* u, int un, DBN_T v)
+{
+	DBN_T_UTMP rem = 0;
+	int i;
+
+	for (i = un - 1; i >= 0; --i)
+	{
+		DBN_T_UTMP num = (rem << _DBN_WORD_BITS) | u[i];
+		if (q)
+		{
+			q[i] = (DBN_T)(num / v);
+		}
+		rem = num % v;
+	}
+
+	return((DBN_T)rem);
+}
+
+static int _dbn_count_words(DBN_T* a, int n)
+{
+	while ((n > 0) && (a[n - 1] == 0))
+	{
+		n--;
+	}
+
+	return(n);
+}
+
+/*
+	q = u / v, r = u % v. q has un words, r has vn words, both may be 0.
+	v must be non-zero, outputs must not overlap the inputs.
+	nu and nv are scratch of un + 1 and vn words
+*/
+static void _dbn_divmod_scratch(
+	DBN_T* q, DBN_T* r,
+	DBN_T* u, int un,
+	DBN_T* v, int vn,
+	DBN_T* nu, DBN_T* nv)
+{
+	int m, n, s, i, j;
+
+	m = _dbn_count_words(u, un);
+	n = _dbn_count_words(v, vn);
+	require(n > 0, "division by zero");
+
+	if (q)
+	{
+		_dbn_zero_words(q, un);
+	}
+
+	if (m < n)
+	{
+		if (r)
+		{
+			_dbn_copy_words(r, u, m);
+			_dbn_zero_words(r + m, vn - m);
+		}
+		return;
+	}
+
+	if (n == 1)
+	{
+		DBN_T rem = _dbn_div_word(q, u, m, v[0]);
+		if (r)
+		{
+			_dbn_zero_words(r, vn);
+			r[0] = rem;
+		}
+		return;
+	}
+
+	/* Normalize so that the top bit of the divisor is set */
+	s = 0;
+	while (!((v[n - 1] << s) & ((DBN_T_UTMP)1 << (_DBN_WORD_BITS - 1))))
+	{
+		s++;
+	}
+
+	for (i = n - 1; i > 0; --i)
+	{
+		nv[i] = (DBN_T)((v[i] << s) | (s ? ((DBN_T_UTMP)v[i - 1] >> (_DBN_WORD_BITS - s)) : 0));
+	}
+	nv[0] = (DBN_T)(v[0] << s);
+
+	nu[m] = (DBN_T)(s ? ((DBN_T_UTMP)u[m - 1] >> (_DBN_WORD_BITS - s)) : 0);
+	for (i = m - 1; i > 0; --i)
+	{
+		nu[i] = (DBN_T)((u[i] << s) | (s ? ((DBN_T_UTMP)u[i - 1] >> (_DBN_WORD_BITS - s)) : 0));
+	}
+	nu[0] = (DBN_T)(u[0] << s);
+
+	const DBN_T_UTMP base = (DBN_T_UTMP)DBN_MAX_VAL + 1;
+
+	for (j = m - n; j >= 0; --j)
+	{
+		/* Estimate from the top two words, then correct with the third one */
+		DBN_T_UTMP num = ((DBN_T_UTMP)nu[j + n] << _DBN_WORD_BITS) | nu[j + n - 1];
+		DBN_T_UTMP qhat = num / nv[n - 1];
+		DBN_T_UTMP rhat = num % nv[n - 1];
+
+		while ((qhat >= base) ||
+			(qhat * nv[n - 2] > ((rhat << _DBN_WORD_BITS) | nu[j + n - 2])))
+		{
+			qhat--;
+			rhat += nv[n - 1];
+			if (rhat >= base)
+			{
+				break;
+			}
+		}
+
+		/* nu[j, j + n] -= qhat * nv */
+		DBN_T_STMP k = 0;
+		DBN_T_STMP t;
+		for (i = 0; i < n; ++i)
+		{
+			DBN_T_UTMP p = qhat * nv[i];
+			t = (DBN_T_STMP)nu[i + j] - k - (DBN_T_STMP)(p & DBN_MAX_VAL);
+			nu[i + j] = (DBN_T)t;
+			k = (DBN_T_STMP)(p >> _DBN_WORD_BITS) - (t >> _DBN_WORD_BITS);
+		}
+		t = (DBN_T_STMP)nu[j + n] - k;
+		nu[j + n] = (DBN_T)t;
+
+		/* Estimate was one too big, add the divisor back */
+		if (t < 0)
+		{
+			qhat--;
+			nu[j + n] = (DBN_T)(nu[j + n] + _dbn_add_words(nu + j, nu + j, n, nv, n));
+		}
+
+		if (q)
+		{
+			q[j] = (DBN_T)qhat;
+		}
+	}
+
+	/* Remainder is the low n words shifted back */
+	if (r)
+	{
+		for (i = 0; i < n - 1; ++i)
+		{
+			r[i] = (DBN_T)((nu[i] >> s) | (s ? ((DBN_T_UTMP)nu[i + 1] << (_DBN_WORD_BITS - s)) : 0));
+		}
+		r[n - 1] = (DBN_T)(nu[n - 1] >> s);
+		_dbn_zero_words(r + n, vn - n);
+	}
+}
+
+/* Same with the scratch on the stack, for up to _DBN_DIV_MAX_WORDS words */
+static void _dbn_divmod_words(DBN_T* q, DBN_T* r, DBN_T* u, int un, DBN_T* v, int vn)
+{
+	DBN_T nu[_DBN_DIV_MAX_WORDS + 1];
+	DBN_T nv[_DBN_DIV_MAX_WORDS];
+
+	require(un <= _DBN_DIV_MAX_WORDS && vn <= _DBN_DIV_MAX_WORDS, "operands are too long");
+
+	_dbn_divmod_scratch(q, r, u, un, v, vn, nu, nv);
+}
+
+void bignum_div(struct bn* a, struct bn* b, struct bn* c)
 {
 	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	DBN_T q[DBN_SZARR];
+
+	_dbn_divmod_words(q, 0, a->array, DBN_SZARR, b->array, DBN_SZARR);
+
+	bignum_init(c);
+	_dbn_copy_words(c->array, q, DBN_SZARR);
+}
+
+
+void bignum_divmod(struct bn* a, struct bn* b, struct bn* q, struct bn* r)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(q, "q is null");
+	require(r, "r is null");
+
+	DBN_T qw[DBN_SZARR];
+	DBN_T rw[DBN_SZARR];
+
+	_dbn_divmod_words(qw, rw, a->array, DBN_SZARR, b->array, DBN_SZARR);
+
+	bignum_init(q);
+	bignum_init(r);
+	_dbn_copy_words(q->array, qw, DBN_SZARR);
+	_dbn_copy_words(r->array, rw, DBN_SZARR);
+}
+
+
+DBN_T bignum_div_word(struct bn* a, DBN_T w, struct bn* q)
+{
+	require(a, "a is null");
+	require(q, "q is null");
+	require(w != 0, "division by zero");
+
+	DBN_T qw[DBN_SZARR];
+	DBN_T rem = _dbn_div_word(qw, a->array, DBN_SZARR, w);
+
+	bignum_init(q);
+	_dbn_copy_words(q->array, qw, DBN_SZARR);
+
+	return(rem);
+}
+
+
+void bignum_lshift(struct bn* a, struct bn* b, int nbits)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(nbits >= 0, "no negative shifts");
+
+	/* Handle shift in multiples of word-size */
+	const int nbits_pr_word = (DBN_SZWORD * 8);
+	int nwords = nbits / nbits_pr_word;
+	if (nwords != 0)
+	{
+		_lshift_word(a, nwords);
+		nbits -= (nwords * nbits_pr_word);
+	}
+
+	if (nbits != 0)
+	{
+		int i;
+		for (i = (DBN_SZARR - 1); i > 0; --i)
+		{
+			a->array[i] = (a->array[i] << nbits) | (a->array[i - 1] >> ((8 * DBN_SZWORD) - nbits));
+		}
+		a->array[i] <<= nbits;
+	}
+	bignum_copy(b, a);
+}
+
+
+void bignum_rshift(struct bn* a, struct bn* b, int nbits)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(nbits >= 0, "no negative shifts");
+
+	/* Handle shift in multiples of word-size */
+	const int nbits_pr_word = (DBN_SZWORD * 8);
+	int nwords = nbits / nbits_pr_word;
+	if (nwords != 0)
+	{
+		_rshift_word(a, nwords);
+		nbits -= (nwords * nbits_pr_word);
+	}
+
+	if (nbits != 0)
+	{
+		int i;
+		for (i = 0; i < (DBN_SZARR - 1); ++i)
+		{
+			a->array[i] = (a->array[i] >> nbits) | (a->array[i + 1] << ((8 * DBN_SZWORD) - nbits));
+		}
+		a->array[i] >>= nbits;
+	}
+	bignum_copy(b, a);
+}
+
+
+void bignum_mod(struct bn* a, struct bn* b, struct bn* c)
+{
+	/*
+	mod(a,b) = a - ((a / b) * b)
+
+	example:
+	mod(8, 3) = 8 - ((8 / 3) * 3) = 2
+	*/
+	require(a, "a is null");
+	require(b, "b is null");
 	require(c, "c is null");
-	require(k >= 0, "k must be greater or equal to zero");
 
-	struct bn pow2;
-	int32_t word_index = k / (DBN_SZWORD << 3);
-	int32_t bit_offset = k & ((DBN_SZWORD << 3) - 1);
+	DBN_T r[DBN_SZARR];
+
+	/* Remainder only, the quotient words are not stored */
+	_dbn_divmod_words(0, r, a->array, DBN_SZARR, b->array, DBN_SZARR);
 
 	bignum_init(c);
-	bignum_init(&pow2);
+	_dbn_copy_words(c->array, r, DBN_SZARR);
+}
+
+
+void bignum_and(struct bn* a, struct bn* b, struct bn* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	int i;
+	for (i = 0; i < DBN_SZARR; ++i)
+	{
+		c->array[i] = (a->array[i] & b->array[i]);
+	}
+}
+
+
+void bignum_or(struct bn* a, struct bn* b, struct bn* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	int i;
+	for (i = 0; i < DBN_SZARR; ++i)
+	{
+		c->array[i] = (a->array[i] | b->array[i]);
+	}
+}
+
+
+void bignum_xor(struct bn* a, struct bn* b, struct bn* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	int i;
+	for (i = 0; i < DBN_SZARR; ++i)
+	{
+		c->array[i] = (a->array[i] ^ b->array[i]);
+	}
+}
+
+
+int bignum_cmp(struct bn* a, struct bn* b)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+
+	int i = DBN_SZARR;
+	do
+	{
+		--i; /* Decrement first, to start with last array element */
+		if (a->array[i] > b->array[i])
+		{
+			return DIMA_BIGNUM_CMP_LARGER;
+		}
+		else if (a->array[i] < b->array[i])
+		{
+			return DIMA_BIGNUM_CMP_SMALLER;
+		}
+	} while (i != 0);
+
+	return DIMA_BIGNUM_CMP_EQUAL;
+}
+
+
+int bignum_is_zero(struct bn* n)
+{
+	require(n, "n is null");
+
+	int i;
+	for (i = 0; i < DBN_SZARR; ++i)
+	{
+		if (n->array[i])
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+void bignum_pow(struct bn* a, struct bn* b, struct bn* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	struct bn base;
+	struct bn acc;
+	struct bn tmp;
+	int i;
+
+	bignum_copy(&base, a);
+	bignum_from_int(&acc, 1);
+
+	/* Left-to-right square and multiply, b is left untouched */
+	for (i = _get_szbytes(b) * _DBN_WORD_BITS - 1; i >= 0; --i)
+	{
+		bignum_mul(&acc, &acc, &tmp);
+		if (_dbn_bit(b->array, i))
+		{
+			bignum_mul(&tmp, &base, &acc);
+		}
+		else
+		{
+			bignum_copy(&acc, &tmp);
+		}
+	}
+
+	bignum_copy(c, &acc);
+}
+
+void bignum_mul_pow2(struct bn* a, int32_t k, struct bn* c) 
+{
+	require(a, "a is null");
+	require(c, "c is null");
+	require(k >= 0, "k must be greater or equal to zero");
+
+	/* Word moves and one bit shift pass instead of multiplying by 2^k */
+	bignum_copy(c, a);
+	bignum_lshift(c, c, k);
+}
+
+/*
+	NOTE(dima): Montgomery arithmetic for bignum_powmod. Numbers are arrays of
+	n words where n is the length of the odd modulus and R = B^n. Products go
+	through CIOS, so nothing wider than n + 2 words is built and moduli up to
+	the full struct bn work although their products do not fit into it.
+*/
+typedef struct _dbn_mont {
+	int n;
+	DBN_T m_inv; /* -m^-1 mod B */
+	DBN_T m[DBN_SZARR];
+	DBN_T one[DBN_SZARR]; /* R mod m */
+	DBN_T r2[DBN_SZARR]; /* R^2 mod m */
+} _dbn_mont;
+
+/* Widest window of bignum_powmod, the table holds 2^(w - 1) odd powers */
+#define _DBN_POWMOD_MAX_WINDOW 6
+
+/* Window of bignum_powmod_ct, divides the word size */
+#define _DBN_POWMOD_CT_WINDOW 4
+
+/* r = a * b * R^-1 mod m, a and b below m. r may alias a or b. No branches on the values */
+static void _dbn_mont_mul(DBN_T* r, DBN_T* a, DBN_T* b, _dbn_mont* ctx)
+{
+	DBN_T t[DBN_SZARR + 2];
+	DBN_T d[DBN_SZARR + 1];
+	int n = ctx->n;
+	int i, j;
+
+	_dbn_zero_words(t, n + 2);
+
+	for (i = 0; i < n; ++i)
+	{
+		/* t += a * b[i] */
+		DBN_T_UTMP carry = 0;
+		for (j = 0; j < n; ++j)
+		{
+			carry += (DBN_T_UTMP)a[j] * b[i] + t[j];
+			t[j] = (DBN_T)carry;
+			carry >>= _DBN_WORD_BITS;
+		}
+		carry += t[n];
+		t[n] = (DBN_T)carry;
+		t[n + 1] = (DBN_T)(carry >> _DBN_WORD_BITS);
+
+		/* t = (t + u * m) / B, u makes the lowest word zero */
+		DBN_T u = (DBN_T)((DBN_T_UTMP)t[0] * ctx->m_inv);
+		carry = ((DBN_T_UTMP)u * ctx->m[0] + t[0]) >> _DBN_WORD_BITS;
+		for (j = 1; j < n; ++j)
+		{
+			carry += (DBN_T_UTMP)u * ctx->m[j] + t[j];
+			t[j - 1] = (DBN_T)carry;
+			carry >>= _DBN_WORD_BITS;
+		}
+		carry += t[n];
+		t[n - 1] = (DBN_T)carry;
+		t[n] = (DBN_T)(t[n + 1] + (carry >> _DBN_WORD_BITS));
+	}
+
+	/* t < 2m, r = t - m unless that borrows */
+	DBN_T keep = (DBN_T)(0 - _dbn_sub_words(d, t, n + 1, ctx->m, n));
+	for (j = 0; j < n; ++j)
+	{
+		r[j] = (DBN_T)((t[j] & keep) | (d[j] & ~keep));
+	}
+}
+
+/* x = 2 * x mod m for x below m */
+static void _dbn_mont_double(DBN_T* x, _dbn_mont* ctx)
+{
+	DBN_T d[DBN_SZARR];
+	int n = ctx->n;
+	int j;
+
+	DBN_T top = (DBN_T)(x[n - 1] >> (_DBN_WORD_BITS - 1));
+	_dbn_add_words(x, x, n, x, n);
+
+	DBN_T borrow = _dbn_sub_words(d, x, n, ctx->m, n);
+	DBN_T keep = (DBN_T)(0 - (borrow & (top ^ 1)));
+	for (j = 0; j < n; ++j)
+	{
+		x[j] = (DBN_T)((x[j] & keep) | (d[j] & ~keep));
+	}
+}
+
+/* Returns 0 when m is 1 and everything modulo m is zero */
+static int _dbn_mont_init(_dbn_mont* ctx, struct bn* m)
+{
+	int n = _get_szbytes(m);
+	int i;
+
+	if ((n == 1) && (m->array[0] == 1))
+	{
+		return(0);
+	}
+
+	ctx->n = n;
+	_dbn_copy_words(ctx->m, m->array, n);
+
+	/* m^-1 mod B by Newton iteration, each step doubles the correct bits */
+	DBN_T inv = m->array[0];
+	for (i = 0; i < 5; ++i)
+	{
+		inv = (DBN_T)((DBN_T_UTMP)inv * (DBN_T)(2 - (DBN_T)((DBN_T_UTMP)m->array[0] * inv)));
+	}
+	ctx->m_inv = (DBN_T)(0 - inv);
+
+	/* R mod m and R^2 mod m by doubling 1 */
+	_dbn_zero_words(ctx->one, n);
+	ctx->one[0] = 1;
+	for (i = 0; i < n * _DBN_WORD_BITS; ++i)
+	{
+		_dbn_mont_double(ctx->one, ctx);
+	}
+
+	_dbn_copy_words(ctx->r2, ctx->one, n);
+	for (i = 0; i < n * _DBN_WORD_BITS; ++i)
+	{
+		_dbn_mont_double(ctx->r2, ctx);
+	}
+
+	return(1);
+}
+
+/* Base reduced modulo m and taken into Montgomery form */
+static void _dbn_mont_load(DBN_T* r, struct bn* a, struct bn* m, _dbn_mont* ctx)
+{
+	struct bn base;
+
+	if ((_get_szbytes(a) > ctx->n) || (bignum_cmp(a, m) != DIMA_BIGNUM_CMP_SMALLER))
+	{
+		bignum_mod(a, m, &base);
+	}
+	else
+	{
+		bignum_copy(&base, a);
+	}
+
+	_dbn_mont_mul(r, base.array, ctx->r2, ctx);
+}
+
+/* Back from Montgomery form into a struct bn */
+static void _dbn_mont_store(struct bn* r, DBN_T* a, _dbn_mont* ctx)
+{
+	DBN_T unit[DBN_SZARR];
+
+	_dbn_zero_words(unit, ctx->n);
+	unit[0] = 1;
+
+	bignum_init(r);
+	_dbn_mont_mul(r->array, a, unit, ctx);
+}
+
+static int _dbn_powmod_window(int bits)
+{
+	int result = 1;
+
+	if (bits > 671)
+	{
+		result = 6;
+	}
+	else if (bits > 239)
+	{
+		result = 5;
+	}
+	else if (bits > 79)
+	{
+		result = 4;
+	}
+	else if (bits > 23)
+	{
+		result = 3;
+	}
+
+	return(result);
+}
+
+void bignum_powmod(struct bn* a, struct bn* e, struct bn* m, struct bn* r)
+{
+	require(a, "a is null");
+	require(e, "e is null");
+	require(m, "m is null");
+	require(r, "r is null");
+	require(m->array[0] & 1, "modulus must be odd");
+
+	_dbn_mont ctx;
+	DBN_T table[1 << (_DBN_POWMOD_MAX_WINDOW - 1)][DBN_SZARR];
+	DBN_T acc[DBN_SZARR];
+	int i, j;
+
+	if (!_dbn_mont_init(&ctx, m))
+	{
+		bignum_init(r);
+		return;
+	}
+
+	int bits = _get_szbytes(e) * _DBN_WORD_BITS;
+	while ((bits > 0) && !_dbn_bit(e->array, bits - 1))
+	{
+		bits--;
+	}
+
+	/* table[i] = a^(2 * i + 1) */
+	int window = _dbn_powmod_window(bits);
+	_dbn_mont_load(table[0], a, m, &ctx);
+	if (window > 1)
+	{
+		_dbn_mont_mul(acc, table[0], table[0], &ctx);
+		for (i = 1; i < (1 << (window - 1)); ++i)
+		{
+			_dbn_mont_mul(table[i], table[i - 1], acc, &ctx);
+		}
+	}
+
+	_dbn_copy_words(acc, ctx.one, ctx.n);
+
+	/* Sliding windows from the top, every window starts and ends with a set bit */
+	i = bits - 1;
+	while (i >= 0)
+	{
+		if (!_dbn_bit(e->array, i))
+		{
+			_dbn_mont_mul(acc, acc, acc, &ctx);
+			i--;
+			continue;
+		}
+
+		j = DIMA_BIGNUM_MAX(i - window + 1, 0);
+		while (!_dbn_bit(e->array, j))
+		{
+			j++;
+		}
+
+		int value = 0;
+		int k;
+		for (k = i; k >= j; --k)
+		{
+			value = (value << 1) | _dbn_bit(e->array, k);
+			_dbn_mont_mul(acc, acc, acc, &ctx);
+		}
+		_dbn_mont_mul(acc, acc, table[value >> 1], &ctx);
+
+		i = j - 1;
+	}
+
+	_dbn_mont_store(r, acc, &ctx);
+}
+
+void bignum_powmod_ct(struct bn* a, struct bn* e, struct bn* m, struct bn* r)
+{
+	require(a, "a is null");
+	require(e, "e is null");
+	require(m, "m is null");
+	require(r, "r is null");
+	require(m->array[0] & 1, "modulus must be odd");
+
+	_dbn_mont ctx;
+	DBN_T table[1 << _DBN_POWMOD_CT_WINDOW][DBN_SZARR];
+	DBN_T acc[DBN_SZARR];
+	DBN_T pick[DBN_SZARR];
+	int i, j, k;
+
+	if (!_dbn_mont_init(&ctx, m))
+	{
+		bignum_init(r);
+		return;
+	}
+	require(_get_szbytes(e) <= ctx.n, "exponent must not be longer than the modulus");
+
+	/* table[i] = a^i */
+	_dbn_copy_words(table[0], ctx.one, ctx.n);
+	_dbn_mont_load(table[1], a, m, &ctx);
+	for (i = 2; i < (1 << _DBN_POWMOD_CT_WINDOW); ++i)
+	{
+		_dbn_mont_mul(table[i], table[i - 1], table[1], &ctx);
+	}
+
+	_dbn_copy_words(acc, ctx.one, ctx.n);
+
+	//NOTE(dima): All windows of the modulus length are processed, the table is read whole every time
+	for (i = ctx.n * _DBN_WORD_BITS - _DBN_POWMOD_CT_WINDOW; i >= 0; i -= _DBN_POWMOD_CT_WINDOW)
+	{
+		DBN_T_UTMP value = (e->array[i / _DBN_WORD_BITS] >> (i % _DBN_WORD_BITS)) & ((1 << _DBN_POWMOD_CT_WINDOW) - 1);
+
+		for (k = 0; k < _DBN_POWMOD_CT_WINDOW; ++k)
+		{
+			_dbn_mont_mul(acc, acc, acc, &ctx);
+		}
+
+		_dbn_zero_words(pick, ctx.n);
+		for (k = 0; k < (1 << _DBN_POWMOD_CT_WINDOW); ++k)
+		{
+			/* All ones only when k == value */
+			DBN_T_UTMP diff = (DBN_T_UTMP)k ^ value;
+			DBN_T mask = (DBN_T)(0 - ((diff - 1) >> (sizeof(DBN_T_UTMP) * 8 - 1)));
+			for (j = 0; j < ctx.n; ++j)
+			{
+				pick[j] |= table[k][j] & mask;
+			}
+		}
+		_dbn_mont_mul(acc, acc, pick, &ctx);
+	}
+
+	_dbn_mont_store(r, acc, &ctx);
+}
+
+void bignum_barrett_init(struct bn_barrett* ctx, struct bn* m)
+{
+	require(ctx, "ctx is null");
+	require(m, "m is null");
+
+	DBN_T num[DBN_SZARR * 2 + 1];
+	DBN_T mu[DBN_SZARR * 2 + 1];
+
+	int n = _get_szbytes(m);
+	require(n > 0, "division by zero");
+
+	bignum_copy(&ctx->m, m);
+	ctx->m.sign = 1;
+	ctx->n = n;
+
+	/* mu = B^(2n) / m, n + 1 words */
+	_dbn_zero_words(num, 2 * n + 1);
+	num[2 * n] = 1;
+	_dbn_divmod_words(mu, 0, num, 2 * n + 1, m->array, n);
+	_dbn_copy_words(ctx->mu, mu, n + 1);
+	ctx->fallback = (mu[n + 1] != 0);
+}
+
+
+void bignum_barrett_mod(struct bn* x, struct bn_barrett* ctx, struct bn* r)
+{
+	require(x, "x is null");
+	require(ctx, "ctx is null");
+	require(r, "r is null");
+
+	DBN_T q2[DBN_SZARR * 2 + 2];
+	DBN_T qm[DBN_SZARR + 1];
+	DBN_T rw[DBN_SZARR + 1];
+	DBN_T d[DBN_SZARR + 1];
+
+	int n = ctx->n;
+	int xn = _get_szbytes(x);
+	int i;
+
+	/* Only x below B^(2n) is covered by the estimate */
+	if ((xn > 2 * n) || ctx->fallback)
+	{
+		bignum_mod(x, &ctx->m, r);
+		return;
+	}
+
+	/* q3 = ((x / B^(n - 1)) * mu) / B^(n + 1), at most 2 below x / m */
+	DBN_T q1[DBN_SZARR + 2];
+	_dbn_zero_words(q1, n + 1);
+	if (xn > n - 1)
+	{
+		_dbn_copy_words(q1, x->array + (n - 1), xn - (n - 1));
+	}
+	_dbn_mul_words(q2, q1, ctx->mu, n + 1);
+
+	/* r = (x - q3 * m) mod B^(n + 1), the upper words of q3 * m are not needed */
+	_dbn_mul_low(qm, q2 + (n + 1), n + 1, ctx->m.array, n, n + 1);
+	_dbn_copy_words(rw, x->array, DIMA_BIGNUM_MIN(n + 1, DBN_SZARR));
+	if (n + 1 > DBN_SZARR)
+	{
+		rw[n] = 0;
+	}
+	_dbn_sub_words(rw, rw, n + 1, qm, n + 1);
+
+	for (i = 0; i < 2; ++i)
+	{
+		if (!_dbn_sub_words(d, rw, n + 1, ctx->m.array, n))
+		{
+			_dbn_copy_words(rw, d, n + 1);
+		}
+	}
+
+	bignum_init(r);
+	_dbn_copy_words(r->array, rw, n);
+}
+
+/*
+	NOTE(dima): Variable-width numbers. They reuse the word-array kernels of
+	struct bn, the only difference is that lengths come from used instead of
+	scanning and buffers that can outgrow DBN_SZARR come from the allocator.
+*/
+static DBN_ALLOC(_dbn_default_alloc)
+{
+	(void)user;
+
+	return(malloc(size));
+}
+
+static DBN_FREE(_dbn_default_free)
+{
+	(void)user;
+	(void)size;
+
+	free(ptr);
+}
+
+static struct bn_allocator _dbn_default_allocator = { _dbn_default_alloc, _dbn_default_free, 0 };
+
+static DBN_T* _bnv_alloc_words(struct bn_allocator* allocator, int words)
+{
+	return((DBN_T*)allocator->alloc(allocator->user, sizeof(DBN_T) * (size_t)words));
+}
+
+static void _bnv_free_words(struct bn_allocator* allocator, DBN_T* array, int words)
+{
+	if (array)
+	{
+		allocator->free(allocator->user, array, sizeof(DBN_T) * (size_t)words);
+	}
+}
+
+static void _bnv_trim(struct bnv* n)
+{
+	n->used = _dbn_count_words(n->array, n->used);
+}
+
+/* Exchanges contents, used to move a result computed aside into an output */
+static void _bnv_swap(struct bnv* a, struct bnv* b)
+{
+	struct bnv t = *a;
+	*a = *b;
+	*b = t;
+}
+
+void bnv_init(struct bnv* n, struct bn_allocator* allocator)
+{
+	require(n, "n is null");
+
+	n->used = 0;
+	n->alloc = 0;
+	n->array = 0;
+	n->allocator = allocator ? allocator : &_dbn_default_allocator;
+}
+
+
+void bnv_free(struct bnv* n)
+{
+	require(n, "n is null");
+
+	_bnv_free_words(n->allocator, n->array, n->alloc);
+	n->used = 0;
+	n->alloc = 0;
+	n->array = 0;
+}
+
+
+int bnv_reserve(struct bnv* n, int words)
+{
+	require(n, "n is null");
+
+	if (words <= n->alloc)
+	{
+		return(1);
+	}
+
+	/* Grow by half at least, so that numbers growing word by word do not reallocate every time */
+	int alloc = DIMA_BIGNUM_MAX(words, n->alloc + n->alloc / 2);
+	alloc = DIMA_BIGNUM_MAX(alloc, 4);
+
+	DBN_T* array = _bnv_alloc_words(n->allocator, alloc);
+	if (!array)
+	{
+		return(0);
+	}
+
+	_dbn_copy_words(array, n->array, n->used);
+	_bnv_free_words(n->allocator, n->array, n->alloc);
+
+	n->array = array;
+	n->alloc = alloc;
+
+	return(1);
+}
+
+
+int bnv_copy(struct bnv* dst, struct bnv* src)
+{
+	require(dst, "dst is null");
+	require(src, "src is null");
+
+	if (dst == src)
+	{
+		return(1);
+	}
+
+	if (!bnv_reserve(dst, src->used))
+	{
+		return(0);
+	}
+
+	_dbn_copy_words(dst->array, src->array, src->used);
+	dst->used = src->used;
+
+	return(1);
+}
+
+
+int bnv_from_uint(struct bnv* n, DBN_T_UTMP i)
+{
+	require(n, "n is null");
+
+	int words = (int)(sizeof(DBN_T_UTMP) / sizeof(DBN_T));
+	int k;
+
+	if (!bnv_reserve(n, words))
+	{
+		return(0);
+	}
+
+	for (k = 0; k < words; ++k)
+	{
+		n->array[k] = (DBN_T)(i >> (_DBN_WORD_BITS * k));
+	}
+	n->used = words;
+	_bnv_trim(n);
+
+	return(1);
+}
+
+
+int bnv_from_data(struct bnv* n, void* data, int datasizeinbytes)
+{
+	require(n, "n is null");
+	require(data, "data is null");
+
+	uint8_t* at = (uint8_t*)data;
+	int words = (datasizeinbytes + DBN_SZWORD - 1) / DBN_SZWORD;
+	int i;
+
+	if (!bnv_reserve(n, words))
+	{
+		return(0);
+	}
+
+	_dbn_zero_words(n->array, words);
+	for (i = 0; i < datasizeinbytes; ++i)
+	{
+		n->array[i / DBN_SZWORD] |= (DBN_T)((DBN_T)at[i] << (8 * (i % DBN_SZWORD)));
+	}
+	n->used = words;
+	_bnv_trim(n);
+
+	return(1);
+}
+
+
+int bnv_to_data(struct bnv* n, void* data, int maxsize)
+{
+	require(n, "n is null");
+	require(data, "data is null");
+
+	uint8_t* to = (uint8_t*)data;
+	int needed = n->used * DBN_SZWORD;
+	int i;
+
+	/* Zero bytes of the top word are not needed */
+	while ((needed > 0) && !((n->array[(needed - 1) / DBN_SZWORD] >> (8 * ((needed - 1) % DBN_SZWORD))) & 0xFF))
+	{
+		needed--;
+	}
+
+	if (needed > maxsize)
+	{
+		return(0);
+	}
+
+	for (i = 0; i < maxsize; ++i)
+	{
+		to[i] = (i < needed) ? (uint8_t)(n->array[i / DBN_SZWORD] >> (8 * (i % DBN_SZWORD))) : 0;
+	}
+
+	return(needed);
+}
+
+
+int bnv_from_bn(struct bnv* n, struct bn* a)
+{
+	require(n, "n is null");
+	require(a, "a is null");
+
+	int words = _get_szbytes(a);
+
+	if (!bnv_reserve(n, words))
+	{
+		return(0);
+	}
+
+	_dbn_copy_words(n->array, a->array, words);
+	n->used = words;
+
+	return(1);
+}
+
+
+int bnv_to_bn(struct bn* r, struct bnv* n)
+{
+	require(r, "r is null");
+	require(n, "n is null");
+
+	if (n->used > DBN_SZARR)
+	{
+		return(0);
+	}
+
+	bignum_init(r);
+	_dbn_copy_words(r->array, n->array, n->used);
+
+	return(1);
+}
+
+
+int bnv_cmp(struct bnv* a, struct bnv* b)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+
+	int i;
+
+	if (a->used != b->used)
+	{
+		return((a->used > b->used) ? DIMA_BIGNUM_CMP_LARGER : DIMA_BIGNUM_CMP_SMALLER);
+	}
+
+	for (i = a->used - 1; i >= 0; --i)
+	{
+		if (a->array[i] != b->array[i])
+		{
+			return((a->array[i] > b->array[i]) ? DIMA_BIGNUM_CMP_LARGER : DIMA_BIGNUM_CMP_SMALLER);
+		}
+	}
+
+	return(DIMA_BIGNUM_CMP_EQUAL);
+}
+
+
+int bnv_is_zero(struct bnv* n)
+{
+	require(n, "n is null");
+
+	return(n->used == 0);
+}
+
+
+int bnv_add(struct bnv* a, struct bnv* b, struct bnv* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	/* a is the longer one */
+	if (a->used < b->used)
+	{
+		struct bnv* t = a;
+		a = b;
+		b = t;
+	}
+
+	int an = a->used;
+	int bn = b->used;
+
+	//NOTE(dima): Reserving first, c may be a or b and its array can move
+	if (!bnv_reserve(c, an + 1))
+	{
+		return(0);
+	}
+
+	c->array[an] = _dbn_add_words(c->array, a->array, an, b->array, bn);
+	c->used = an + 1;
+	_bnv_trim(c);
+
+	return(1);
+}
+
+
+int bnv_sub(struct bnv* a, struct bnv* b, struct bnv* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+	require(bnv_cmp(a, b) != DIMA_BIGNUM_CMP_SMALLER, "a must not be smaller than b");
+
+	int an = a->used;
+
+	if (!bnv_reserve(c, an))
+	{
+		return(0);
+	}
+
+	_dbn_sub_words(c->array, a->array, an, b->array, b->used);
+	c->used = an;
+	_bnv_trim(c);
+
+	return(1);
+}
+
+
+/*
+	r = a * b, n words each, r has 2 * n words. Karatsuba with the halves
+	taken from t while they are longer than DBN_SZARR, the fixed kernels below.
+	t holds _bnv_kara_scratch(n) words
+*/
+static int _bnv_kara_scratch(int n)
+{
+	return(4 * n + 512);
+}
+
+static void _bnv_mul_kara(DBN_T* r, DBN_T* a, DBN_T* b, int n, DBN_T* t)
+{
+	if (n <= DBN_SZARR)
+	{
+		_dbn_mul_words(r, a, b, n);
+		return;
+	}
+
+	int h = n / 2;
+	int k = n - h;
+
+	DBN_T* sa = t;
+	DBN_T* sb = sa + (k + 1);
+	DBN_T* mid = sb + (k + 1);
+	DBN_T* rest = mid + (2 * k + 2);
+
+	_bnv_mul_kara(r, a, b, h, rest);
+	_bnv_mul_kara(r + 2 * h, a + h, b + h, k, rest);
+
+	sa[k] = _dbn_add_words(sa, a + h, k, a, h);
+	sb[k] = _dbn_add_words(sb, b + h, k, b, h);
+	_bnv_mul_kara(mid, sa, sb, k + 1, rest);
+
+	_dbn_sub_words(mid, mid, 2 * k + 2, r, 2 * h);
+	_dbn_sub_words(mid, mid, 2 * k + 2, r + 2 * h, 2 * k);
+	_dbn_add_words(r + h, r + h, 2 * n - h, mid, DIMA_BIGNUM_MIN(2 * k + 2, 2 * n - h));
+}
+
+/* r = a * b for an >= bn > 0, r has an + bn words and does not overlap the inputs */
+static int _bnv_mul_words(DBN_T* r, DBN_T* a, int an, DBN_T* b, int bn, struct bn_allocator* allocator)
+{
+	if (bn < DBN_KARATSUBA_CUTOFF)
+	{
+		_dbn_mul_school(r, a, an, b, bn);
+		return(1);
+	}
+
+	/* Balanced operands are padded to an, otherwise a goes by blocks of bn words */
+	int n = (bn * 2 > an) ? an : bn;
+	int scratch_words = n + 2 * n + _bnv_kara_scratch(n);
+	DBN_T* scratch = _bnv_alloc_words(allocator, scratch_words);
+	if (!scratch)
+	{
+		return(0);
+	}
+
+	DBN_T* pad = scratch;
+	DBN_T* prod = pad + n;
+	DBN_T* t = prod + 2 * n;
+	int i;
+
+	if (n == an)
+	{
+		_dbn_copy_words(pad, b, bn);
+		_dbn_zero_words(pad + bn, an - bn);
+		_bnv_mul_kara(prod, a, pad, n, t);
+		_dbn_copy_words(r, prod, an + bn);
+	}
+	else
+	{
+		_dbn_zero_words(r, an + bn);
+		for (i = 0; i < an; i += bn)
+		{
+			int len = DIMA_BIGNUM_MIN(bn, an - i);
+
+			_dbn_copy_words(pad, a + i, len);
+			_dbn_zero_words(pad + len, bn - len);
+			_bnv_mul_kara(prod, pad, b, bn, t);
+			_dbn_add_words(r + i, r + i, an + bn - i, prod, DIMA_BIGNUM_MIN(2 * bn, an + bn - i));
+		}
+	}
+
+	_bnv_free_words(allocator, scratch, scratch_words);
+
+	return(1);
+}
+
+
+int bnv_mul(struct bnv* a, struct bnv* b, struct bnv* c)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(c, "c is null");
+
+	struct bnv t;
+	int result = 1;
+
+	if (a->used < b->used)
+	{
+		struct bnv* s = a;
+		a = b;
+		b = s;
+	}
+
+	if (b->used == 0)
+	{
+		c->used = 0;
+		return(1);
+	}
+
+	/* Computed aside since c may be a or b */
+	bnv_init(&t, c->allocator);
+	result = bnv_reserve(&t, a->used + b->used) &&
+		_bnv_mul_words(t.array, a->array, a->used, b->array, b->used, t.allocator);
+
+	if (result)
+	{
+		t.used = a->used + b->used;
+		_bnv_trim(&t);
+		_bnv_swap(&t, c);
+	}
+	bnv_free(&t);
+
+	return(result);
+}
+
+
+int bnv_sqr(struct bnv* a, struct bnv* c)
+{
+	return(bnv_mul(a, a, c));
+}
+
+
+int bnv_divmod(struct bnv* a, struct bnv* b, struct bnv* q, struct bnv* r)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(b->used > 0, "division by zero");
+
+	struct bn_allocator* allocator = a->allocator;
+	struct bnv tq, tr;
+	int an = a->used;
+	int bn = b->used;
+	int result = 0;
+
+	bnv_init(&tq, q ? q->allocator : allocator);
+	bnv_init(&tr, r ? r->allocator : allocator);
+
+	int scratch_words = (an + 1) + bn;
+	DBN_T* scratch = _bnv_alloc_words(allocator, scratch_words);
+
+	if (scratch &&
+		bnv_reserve(&tq, DIMA_BIGNUM_MAX(an, 1)) &&
+		bnv_reserve(&tr, bn))
+	{
+		_dbn_divmod_scratch(
+			tq.array, tr.array,
+			a->array, an,
+			b->array, bn,
+			scratch, scratch + (an + 1));
+
+		tq.used = an;
+		tr.used = bn;
+		_bnv_trim(&tq);
+		_bnv_trim(&tr);
+
+		if (q)
+		{
+			_bnv_swap(&tq, q);
+		}
+		if (r)
+		{
+			_bnv_swap(&tr, r);
+		}
+		result = 1;
+	}
+
+	if (scratch)
+	{
+		_bnv_free_words(allocator, scratch, scratch_words);
+	}
+	bnv_free(&tq);
+	bnv_free(&tr);
+
+	return(result);
+}
+
+
+int bnv_lshift(struct bnv* a, struct bnv* b, int nbits)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(nbits >= 0, "no negative shifts");
+
+	int nwords = nbits / _DBN_WORD_BITS;
+	int s = nbits % _DBN_WORD_BITS;
+	int an = a->used;
+	int i;
+
+	if (an == 0)
+	{
+		b->used = 0;
+		return(1);
+	}
+
+	if (!bnv_reserve(b, an + nwords + 1))
+	{
+		return(0);
+	}
+
+	//NOTE(dima): From the top down, so that b may be a
+	b->array[an + nwords] = (DBN_T)(s ? ((DBN_T_UTMP)a->array[an - 1] >> (_DBN_WORD_BITS - s)) : 0);
+	for (i = an - 1; i > 0; --i)
+	{
+		b->array[i + nwords] = (DBN_T)((a->array[i] << s) | (s ? ((DBN_T_UTMP)a->array[i - 1] >> (_DBN_WORD_BITS - s)) : 0));
+	}
+	b->array[nwords] = (DBN_T)(a->array[0] << s);
+	_dbn_zero_words(b->array, nwords);
+
+	b->used = an + nwords + 1;
+	_bnv_trim(b);
+
+	return(1);
+}
+
+
+int bnv_rshift(struct bnv* a, struct bnv* b, int nbits)
+{
+	require(a, "a is null");
+	require(b, "b is null");
+	require(nbits >= 0, "no negative shifts");
+
+	int nwords = nbits / _DBN_WORD_BITS;
+	int s = nbits % _DBN_WORD_BITS;
+	int n = a->used - nwords;
+	int i;
+
+	if (n <= 0)
+	{
+		b->used = 0;
+		return(1);
+	}
+
+	if (!bnv_reserve(b, n))
+	{
+		return(0);
+	}
+
+	//NOTE(dima): From the bottom up, so that b may be a
+	for (i = 0; i < n - 1; ++i)
+	{
+		b->array[i] = (DBN_T)((a->array[i + nwords] >> s) | (s ? ((DBN_T_UTMP)a->array[i + nwords + 1] << (_DBN_WORD_BITS - s)) : 0));
+	}
+	b->array[n - 1] = (DBN_T)(a->array[n - 1 + nwords] >> s);
 
-	pow2.array[word_index] = 1 << bit_offset;
+	b->used = n;
+	_bnv_trim(b);
 
-	bignum_mul(a, &pow2, c);
+	return(1);
 }
 
 
@@ -6,7 +6,19 @@
 
 #define DIMA_JSON_WRITER_MAX_DEPTH 64
 #define DIMA_JSON_WRITER_DEFAULT_BUF_LEN 512
-#define DIMA_JSON_WRITER_REALLOC_DIFF 512
+
+/*
+	Buffer size in sink mode. Output goes to the sink in pieces of about
+	this size and the buffer never grows, whatever the document size.
+*/
+#ifndef DIMA_JSON_WRITER_SINK_CHUNK
+#define DIMA_JSON_WRITER_SINK_CHUNK 65536
+#endif
+
+//NOTE(dima): Numbers and hex pieces are formatted right into the buffer, they must fit it whole
+#if DIMA_JSON_WRITER_SINK_CHUNK < 128
+#error DIMA_JSON_WRITER_SINK_CHUNK must be at least 128
+#endif
 
 #ifndef DIMA_JSON_WRITER_USE_STB_SPRINTF
 #ifdef _CRT_SECURE_NO_WARNINGS
@@ -29,18 +41,48 @@
 enum {
 	JSONWriterFlag_None = 0,
 	JSONWriterFlag_Pretty,
+
+	/*
+		Binary CBOR (RFC 8949) instead of text, through the same calls.
+		Objects and arrays are indefinite-length maps and arrays, integers
+		are CBOR integers, JSONAddDataHex data is a byte string, records
+		are a CBOR sequence. Pretty is ignored.
+	*/
+	JSONWriterFlag_CBOR = 2,
 };
 
+/* Sink callback. Must consume all Size bytes, returns 0 on error */
+#define DIMA_JSON_WRITER_SINK(name) int32_t name(void* User, char* Data, int32_t Size)
+typedef DIMA_JSON_WRITER_SINK(json_writer_sink);
+
 struct json_writer {
 	char* Buf;
 	int32_t BufSize;
 
+	/*
+		NOTE(dima): Sink mode, when Sink is not 0. Everything before
+		LastPossibleCommaIndex is final and can be flushed, the rest may
+		still be rewritten by a comma.
+	*/
+	json_writer_sink* Sink;
+	void* SinkUser;
+	int64_t FlushedBytes;
+	int32_t SinkFailed;
+
 	int32_t CurrentIndex;
 	int32_t LastPossibleCommaIndex;
 
 	int32_t CurrentLayer;
 	int32_t LayerElements[DIMA_JSON_WRITER_MAX_DEPTH];
 
+	/*
+		NOTE(dima): Records mode (JSONBeginRecord). RecordsEnd is where the
+		last finished record ends, PendingRecords how many are in the buffer.
+	*/
+	int32_t RecordsEnd;
+	int32_t PendingRecords;
+	int64_t RecordCount;
+
 	uint32_t Flags;
 };
 
@@ -49,6 +91,9 @@ extern "C" {
 #endif
 
 	DIMA_JSON_WRITER_DEF void JSONInit(json_writer* Writer, uint32_t Flags = JSONWriterFlag_None);
+	DIMA_JSON_WRITER_DEF void JSONInitSink(json_writer* Writer, json_writer_sink* Sink, void* User, uint32_t Flags = JSONWriterFlag_None);
+	DIMA_JSON_WRITER_DEF void JSONInitFD(json_writer* Writer, int FD, uint32_t Flags = JSONWriterFlag_None);
+	DIMA_JSON_WRITER_DEF int32_t JSONFlush(json_writer* Writer); /* Sink mode: writes out everything, returns 0 if the sink failed */
 	DIMA_JSON_WRITER_DEF void JSONFree(json_writer* Writer);
 
 	DIMA_JSON_WRITER_DEF void JSONBegin(json_writer* Writer);
@@ -58,6 +103,17 @@ extern "C" {
 	DIMA_JSON_WRITER_DEF void JSONBeginArr(json_writer* Writer, char* Name);
 	DIMA_JSON_WRITER_DEF void JSONEndArr(json_writer* Writer);
 
+	/*
+		Records mode (NDJSON): instead of one document, the writer appends
+		compact top-level objects one per line. JSONFlushRecords hands all
+		finished records to the sink in one call; in buffer mode it drops
+		them (take them with JSONGetBuf first) and the buffer is reused.
+		Sink writers also flush on their own once the buffer is half full.
+	*/
+	DIMA_JSON_WRITER_DEF void JSONBeginRecord(json_writer* Writer);
+	DIMA_JSON_WRITER_DEF void JSONEndRecord(json_writer* Writer);
+	DIMA_JSON_WRITER_DEF int32_t JSONFlushRecords(json_writer* Writer); /* Returns 0 if the sink failed */
+
 	DIMA_JSON_WRITER_DEF void JSONAddU32(json_writer* Writer, char* Key, uint32_t Value);
 	DIMA_JSON_WRITER_DEF void JSONAddS32(json_writer* Writer, char* Key, int32_t Value);
 	DIMA_JSON_WRITER_DEF void JSONAddU64(json_writer* Writer, char* Key, uint64_t Value);
@@ -65,10 +121,12 @@ extern "C" {
 
 	DIMA_JSON_WRITER_DEF void JSONAddSTR(json_writer* Writer, char* Key, char* Value);
 	DIMA_JSON_WRITER_DEF void JSONAddFixedSTR(json_writer* Writer, char* Key, char* Value, int32_t ValueLen);
+	DIMA_JSON_WRITER_DEF void JSONAddSTRLen(json_writer* Writer, char* Key, int32_t KeyLen, char* Value, int32_t ValueLen); /* No strlen at all */
 
 	DIMA_JSON_WRITER_DEF void JSONAddDataHex(json_writer* Writer, char* Key, uint8_t* Value, int32_t ValueLen);
 
-	DIMA_JSON_WRITER_DEF char* JSONGetBuf(json_writer* Writer);
+	DIMA_JSON_WRITER_DEF char* JSONGetBuf(json_writer* Writer); /* Whole document, or the not yet flushed tail in sink mode */
+	DIMA_JSON_WRITER_DEF int32_t JSONGetSize(json_writer* Writer); /* Bytes in JSONGetBuf, CBOR output has zeros inside */
 #ifdef __cplusplus
 }
 #endif
@@ -79,31 +137,115 @@ extern "C" {
 #if defined(DIMA_JSON_WRITER_IMPLEMENTATION) && !defined(DIMA_JSON_WRITER_IMPLEMENTATION_DONE)
 #define DIMA_JSON_WRITER_IMPLEMENTATION_DONE
 
-static void JSONReallocIfNeeded(json_writer* Writer) {
-	if (Writer->CurrentIndex > Writer->BufSize - 128) {
-		Writer->Buf = (char*)realloc(Writer->Buf, Writer->BufSize + DIMA_JSON_WRITER_REALLOC_DIFF);
-		Writer->BufSize += DIMA_JSON_WRITER_REALLOC_DIFF;
+#include <string.h>
+
+#if !defined(DIMA_JSON_WRITER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define DIMA_JSON_WRITER_SSE2 1
+#else
+#define DIMA_JSON_WRITER_SSE2 0
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#define DIMA_JSON_WRITER_WRITE_FD _write
+#else
+#include <unistd.h>
+#define DIMA_JSON_WRITER_WRITE_FD write
+#endif
+
+/* Hands the first Count bytes to the sink and moves the rest down */
+static void JSONFlushBytes(json_writer* Writer, int32_t Count) {
+	if (Count <= 0) {
+		return;
+	}
+
+	//NOTE(dima): Without a sink the bytes are just dropped, records mode does that
+	if (Writer->Sink && !Writer->SinkFailed) {
+		Writer->SinkFailed = !Writer->Sink(Writer->SinkUser, Writer->Buf, Count);
+	}
+	Writer->FlushedBytes += Count;
+
+	memmove(Writer->Buf, Writer->Buf + Count, Writer->CurrentIndex - Count);
+	Writer->CurrentIndex -= Count;
+	Writer->LastPossibleCommaIndex -= Count;
+	if (Writer->LastPossibleCommaIndex < 0) {
+		Writer->LastPossibleCommaIndex = 0;
+	}
+	Writer->RecordsEnd -= Count;
+	if (Writer->RecordsEnd < 0) {
+		Writer->RecordsEnd = 0;
 	}
 }
 
-static void JSONCopyCharToBuf(json_writer* Writer, char ToWrite) {
-	JSONReallocIfNeeded(Writer);
-	Writer->Buf[Writer->CurrentIndex++] = ToWrite;
+/*
+	Makes room for Count more bytes plus the terminating zero. The buffer
+	grows twice at a time, so n bytes of output cost O(n) copying overall.
+	In sink mode the buffer does not grow, it gets flushed instead, and the
+	caller writes whatever fits (returned).
+*/
+static int32_t JSONReserve(json_writer* Writer, int32_t Count) {
+	int32_t Needed = Writer->CurrentIndex + Count + 1;
+
+	if (Needed > Writer->BufSize) {
+		if (Writer->Sink) {
+			//NOTE(dima): Called only while copying, when all written bytes are final
+			JSONFlushBytes(Writer, Writer->CurrentIndex);
+
+			int32_t Room = Writer->BufSize - Writer->CurrentIndex - 1;
+			return((Count < Room) ? Count : Room);
+		}
+
+		int32_t NewSize = Writer->BufSize * 2;
+		if (NewSize < Needed) {
+			NewSize = Needed;
+		}
+
+		Writer->Buf = (char*)realloc(Writer->Buf, NewSize);
+		Writer->BufSize = NewSize;
+	}
+
+	return(Count);
 }
 
-static void JSONCopyStrToBuf(json_writer* Writer, char* ToWrite) {
-	char* At = ToWrite;
-	while (*At) {
-		JSONCopyCharToBuf(Writer, *At);
+static void JSONCopyBytesToBuf(json_writer* Writer, char* ToWrite, int32_t Count) {
+	while (Count > 0) {
+		int32_t Part = JSONReserve(Writer, Count);
 
-		At++;
+		memcpy(Writer->Buf + Writer->CurrentIndex, ToWrite, Part);
+		Writer->CurrentIndex += Part;
+
+		ToWrite += Part;
+		Count -= Part;
 	}
 }
 
-static void JSONWriteLine(json_writer* Writer, char* Str) {
-	int32_t StrLen = strlen(Str);
+/* Room for Count <= 64 bytes in one piece, returns where to write them */
+static char* JSONReserveDirect(json_writer* Writer, int32_t Count) {
+	JSONReserve(Writer, Count);
+
+	return(Writer->Buf + Writer->CurrentIndex);
+}
+
+static void JSONCopyCharToBuf(json_writer* Writer, char ToWrite) {
+	JSONCopyBytesToBuf(Writer, &ToWrite, 1);
+}
+
+/*
+	NOTE(dima): Every line is written as JSONBeginLine(), the line itself
+	straight into the buffer, JSONEndLine(). IsClosing is for } and ],
+	they never get a comma before them.
+*/
+static void JSONBeginLine(json_writer* Writer, int32_t IsClosing) {
+	//NOTE(dima): CBOR has no separators, maps and arrays are terminated by a break
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		return;
+	}
 
-	if (Str[StrLen - 1] != '}' && Str[StrLen - 1] != ']') {
+	if (!IsClosing) {
 		if (Writer->LayerElements[Writer->CurrentLayer] > 0) {
 			Writer->CurrentIndex = Writer->LastPossibleCommaIndex;
 			JSONCopyCharToBuf(Writer, ',');
@@ -122,24 +264,319 @@ static void JSONWriteLine(json_writer* Writer, char* Str) {
 			JSONCopyCharToBuf(Writer, '\t');
 		}
 	}
+}
 
-	JSONCopyStrToBuf(Writer, Str);
-
+static void JSONEndLine(json_writer* Writer) {
 	Writer->LastPossibleCommaIndex = Writer->CurrentIndex;
 
-	if (Writer->Flags & JSONWriterFlag_Pretty) {
+	if ((Writer->Flags & JSONWriterFlag_Pretty) && !(Writer->Flags & JSONWriterFlag_CBOR)) {
 		JSONCopyCharToBuf(Writer, '\n');
 	}
 }
 
+#define DIMA_JSON_WRITER_CBOR_UINT 0
+#define DIMA_JSON_WRITER_CBOR_NINT 1
+#define DIMA_JSON_WRITER_CBOR_BYTES 2
+#define DIMA_JSON_WRITER_CBOR_TEXT 3
+
+//NOTE(dima): Initial bytes of indefinite-length map and array, and of the break that ends them
+#define DIMA_JSON_WRITER_CBOR_MAP_BEGIN ((char)0xBF)
+#define DIMA_JSON_WRITER_CBOR_ARR_BEGIN ((char)0x9F)
+#define DIMA_JSON_WRITER_CBOR_BREAK ((char)0xFF)
+
+/* Major type and its argument in the shortest form, big endian */
+static void JSONWriteCBORHead(json_writer* Writer, int32_t Major, uint64_t Value) {
+	uint8_t* To = (uint8_t*)JSONReserveDirect(Writer, 9);
+	int32_t Size;
+
+	Major <<= 5;
+	if (Value < 24) {
+		To[0] = (uint8_t)(Major | Value);
+		Size = 0;
+	}
+	else if (Value <= 0xFF) {
+		To[0] = (uint8_t)(Major | 24);
+		Size = 1;
+	}
+	else if (Value <= 0xFFFF) {
+		To[0] = (uint8_t)(Major | 25);
+		Size = 2;
+	}
+	else if (Value <= 0xFFFFFFFF) {
+		To[0] = (uint8_t)(Major | 26);
+		Size = 4;
+	}
+	else {
+		To[0] = (uint8_t)(Major | 27);
+		Size = 8;
+	}
+
+	for (int32_t i = 0; i < Size; i++) {
+		To[Size - i] = (uint8_t)(Value >> (i * 8));
+	}
+
+	Writer->CurrentIndex += 1 + Size;
+}
+
+/* { } [ ] on a line of their own, or the CBOR byte for them */
+static void JSONWriteBracket(json_writer* Writer, char Bracket, char CBORByte) {
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		JSONCopyCharToBuf(Writer, CBORByte);
+		return;
+	}
+
+	JSONBeginLine(Writer, Bracket == '}' || Bracket == ']');
+	JSONCopyCharToBuf(Writer, Bracket);
+	JSONEndLine(Writer);
+}
+
+static const char JSONHexDigits[17] = "0123456789ABCDEF";
+
+#if DIMA_JSON_WRITER_SSE2
+static int32_t JSONLowestBit(uint32_t Mask) {
+#ifdef _MSC_VER
+	unsigned long Index;
+	_BitScanForward(&Index, Mask);
+	return((int32_t)Index);
+#else
+	return(__builtin_ctz(Mask));
+#endif
+}
+#endif
+
+/* Count of leading bytes of Str that go out as is: not ", \ or a control char */
+static int32_t JSONScanPlain(char* Str, int32_t Len) {
+	int32_t i = 0;
+
+#if DIMA_JSON_WRITER_SSE2
+	__m128i Quote = _mm_set1_epi8('\"');
+	__m128i Backslash = _mm_set1_epi8('\\');
+	__m128i LastControl = _mm_set1_epi8(0x1F);
+
+	for (; i + 16 <= Len; i += 16) {
+		__m128i Chars = _mm_loadu_si128((__m128i*)(Str + i));
+
+		//NOTE(dima): max(c, 0x1F) == 0x1F is an unsigned c <= 0x1F
+		__m128i Special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(Chars, Quote), _mm_cmpeq_epi8(Chars, Backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(Chars, LastControl), LastControl));
+
+		uint32_t Mask = (uint32_t)_mm_movemask_epi8(Special);
+		if (Mask) {
+			return(i + JSONLowestBit(Mask));
+		}
+	}
+#endif
+
+	for (; i < Len; i++) {
+		uint8_t c = (uint8_t)Str[i];
+
+		if (c == '\"' || c == '\\' || c < 0x20) {
+			break;
+		}
+	}
+
+	return(i);
+}
+
+static void JSONWriteEscapedChar(json_writer* Writer, uint8_t c) {
+	char* To = JSONReserveDirect(Writer, 6);
+
+	To[0] = '\\';
+	switch (c) {
+		case '\"': To[1] = '\"'; break;
+		case '\\': To[1] = '\\'; break;
+		case '\b': To[1] = 'b'; break;
+		case '\f': To[1] = 'f'; break;
+		case '\n': To[1] = 'n'; break;
+		case '\r': To[1] = 'r'; break;
+		case '\t': To[1] = 't'; break;
+		default: {
+			To[1] = 'u';
+			To[2] = '0';
+			To[3] = '0';
+			To[4] = JSONHexDigits[c >> 4];
+			To[5] = JSONHexDigits[c & 0x0F];
+
+			Writer->CurrentIndex += 6;
+			return;
+		}
+	}
+
+	Writer->CurrentIndex += 2;
+}
+
+/* Copies Len bytes of Str escaped, in runs of plain bytes between the escapes */
+static void JSONWriteEscaped(json_writer* Writer, char* Str, int32_t Len) {
+	while (Len > 0) {
+		int32_t Plain = JSONScanPlain(Str, Len);
+		JSONCopyBytesToBuf(Writer, Str, Plain);
+
+		if (Plain == Len) {
+			break;
+		}
+
+		JSONWriteEscapedChar(Writer, (uint8_t)Str[Plain]);
+		Str += Plain + 1;
+		Len -= Plain + 1;
+	}
+}
+
+/* "Key": */
+static void JSONWriteKeyLen(json_writer* Writer, char* Key, int32_t KeyLen) {
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_TEXT, (uint64_t)KeyLen);
+		JSONCopyBytesToBuf(Writer, Key, KeyLen);
+		return;
+	}
+
+	JSONCopyCharToBuf(Writer, '\"');
+	JSONWriteEscaped(Writer, Key, KeyLen);
+	JSONCopyBytesToBuf(Writer, (char*)"\": ", 3);
+}
+
+static void JSONWriteKey(json_writer* Writer, char* Key) {
+	JSONWriteKeyLen(Writer, Key, (int32_t)strlen(Key));
+}
+
+static const char JSONDigitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static int32_t JSONCountDigits(uint64_t Value) {
+	int32_t Result = 1;
+
+	for (;;) {
+		if (Value < 10) return(Result);
+		if (Value < 100) return(Result + 1);
+		if (Value < 1000) return(Result + 2);
+		if (Value < 10000) return(Result + 3);
+
+		Value /= 10000;
+		Result += 4;
+	}
+}
+
+/* Writes decimal Value to To (up to 20 chars), returns the end. Two digits per division */
+static char* JSONFormatU64(char* To, uint64_t Value) {
+	char* End = To + JSONCountDigits(Value);
+	char* At = End;
+
+	while (Value >= 100) {
+		int32_t Pair = (int32_t)(Value % 100) * 2;
+		Value /= 100;
+
+		*--At = JSONDigitPairs[Pair + 1];
+		*--At = JSONDigitPairs[Pair];
+	}
+
+	if (Value >= 10) {
+		int32_t Pair = (int32_t)Value * 2;
+
+		*--At = JSONDigitPairs[Pair + 1];
+		*--At = JSONDigitPairs[Pair];
+	}
+	else {
+		*--At = (char)('0' + Value);
+	}
+
+	return(End);
+}
+
+static char* JSONFormatS64(char* To, int64_t Value) {
+	uint64_t Magnitude = (uint64_t)Value;
+
+	if (Value < 0) {
+		*To++ = '-';
+		Magnitude = (uint64_t)0 - Magnitude;
+	}
+
+	return(JSONFormatU64(To, Magnitude));
+}
+
+static void JSONAddNumberLine(json_writer* Writer, char* Key, uint64_t Value, int32_t IsSigned) {
+	JSONBeginLine(Writer, 0);
+	JSONWriteKey(Writer, Key);
+
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		//NOTE(dima): Negative n is stored as -1 - n, which is ~n
+		if (IsSigned && (int64_t)Value < 0) {
+			JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_NINT, ~Value);
+		}
+		else {
+			JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_UINT, Value);
+		}
+	}
+	else {
+		char* To = JSONReserveDirect(Writer, 24);
+		char* End = IsSigned ? JSONFormatS64(To, (int64_t)Value) : JSONFormatU64(To, Value);
+		Writer->CurrentIndex += (int32_t)(End - To);
+	}
+
+	JSONEndLine(Writer);
+
+	Writer->LayerElements[Writer->CurrentLayer]++;
+}
+
+/*
+	Writes 2 * Count uppercase hex digits of Data to To. With SSE2 16 bytes
+	go at once: nibbles are split, '0' or 'A' - 10 added by compare mask,
+	and high and low nibbles interleaved.
+*/
+static void JSONFormatHex(char* To, uint8_t* Data, int32_t Count) {
+	int32_t i = 0;
+
+#if DIMA_JSON_WRITER_SSE2
+	__m128i LowMask = _mm_set1_epi8(0x0F);
+	__m128i Nine = _mm_set1_epi8(9);
+	__m128i Zero = _mm_set1_epi8('0');
+	__m128i LetterShift = _mm_set1_epi8('A' - '0' - 10);
+
+	for (; i + 16 <= Count; i += 16) {
+		__m128i Bytes = _mm_loadu_si128((__m128i*)(Data + i));
+		__m128i Hi = _mm_and_si128(_mm_srli_epi16(Bytes, 4), LowMask);
+		__m128i Lo = _mm_and_si128(Bytes, LowMask);
+
+		Hi = _mm_add_epi8(_mm_add_epi8(Hi, Zero), _mm_and_si128(_mm_cmpgt_epi8(Hi, Nine), LetterShift));
+		Lo = _mm_add_epi8(_mm_add_epi8(Lo, Zero), _mm_and_si128(_mm_cmpgt_epi8(Lo, Nine), LetterShift));
+
+		_mm_storeu_si128((__m128i*)(To + i * 2), _mm_unpacklo_epi8(Hi, Lo));
+		_mm_storeu_si128((__m128i*)(To + i * 2 + 16), _mm_unpackhi_epi8(Hi, Lo));
+	}
+#endif
+
+	for (; i < Count; i++) {
+		To[i * 2] = JSONHexDigits[Data[i] >> 4];
+		To[i * 2 + 1] = JSONHexDigits[Data[i] & 0x0F];
+	}
+}
+
 void JSONInit(json_writer* Writer, uint32_t Flags) {
 	Writer->Buf = (char*)malloc(DIMA_JSON_WRITER_DEFAULT_BUF_LEN * sizeof(char));
 	Writer->BufSize = DIMA_JSON_WRITER_DEFAULT_BUF_LEN;
+	Writer->Buf[0] = 0;
+
+	Writer->Sink = 0;
+	Writer->SinkUser = 0;
+	Writer->FlushedBytes = 0;
+	Writer->SinkFailed = 0;
 
 	Writer->CurrentIndex = 0;
 	Writer->LastPossibleCommaIndex = 0;
 	Writer->Flags = Flags;
 
+	Writer->RecordsEnd = 0;
+	Writer->PendingRecords = 0;
+	Writer->RecordCount = 0;
+
 	Writer->CurrentLayer = 0;
 	for (int LayerIndex = 0;
 		LayerIndex < DIMA_JSON_WRITER_MAX_DEPTH;
@@ -149,21 +586,59 @@ void JSONInit(json_writer* Writer, uint32_t Flags) {
 	}
 }
 
+void JSONInitSink(json_writer* Writer, json_writer_sink* Sink, void* User, uint32_t Flags) {
+	JSONInit(Writer, Flags);
+
+	Writer->Buf = (char*)realloc(Writer->Buf, DIMA_JSON_WRITER_SINK_CHUNK);
+	Writer->BufSize = DIMA_JSON_WRITER_SINK_CHUNK;
+	Writer->Sink = Sink;
+	Writer->SinkUser = User;
+}
+
+static DIMA_JSON_WRITER_SINK(JSONSinkFD) {
+	int FD = (int)(intptr_t)User;
+
+	while (Size > 0) {
+		int Written = (int)DIMA_JSON_WRITER_WRITE_FD(FD, Data, Size);
+		if (Written <= 0) {
+			return(0);
+		}
+
+		Data += Written;
+		Size -= Written;
+	}
+
+	return(1);
+}
+
+void JSONInitFD(json_writer* Writer, int FD, uint32_t Flags) {
+	JSONInitSink(Writer, JSONSinkFD, (void*)(intptr_t)FD, Flags);
+}
+
+int32_t JSONFlush(json_writer* Writer) {
+	if (Writer->Sink) {
+		JSONFlushBytes(Writer, Writer->CurrentIndex);
+		Writer->PendingRecords = 0;
+	}
+
+	return(!Writer->SinkFailed);
+}
+
 void JSONFree(json_writer* Writer) {
 	free(Writer->Buf);
 }
 
 void JSONBegin(json_writer* Writer) {
-	JSONWriteLine(Writer, "{");
+	JSONWriteBracket(Writer, '{', DIMA_JSON_WRITER_CBOR_MAP_BEGIN);
 
 	Writer->CurrentLayer++;
 }
 
 void JSONBeginName(json_writer* Writer, char* Name) {
-	char LineBuf[256];
-	DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": {", Name);
-
-	JSONWriteLine(Writer, LineBuf);
+	JSONBeginLine(Writer, 0);
+	JSONWriteKey(Writer, Name);
+	JSONCopyCharToBuf(Writer, (Writer->Flags & JSONWriterFlag_CBOR) ? DIMA_JSON_WRITER_CBOR_MAP_BEGIN : '{');
+	JSONEndLine(Writer);
 
 	Writer->CurrentLayer++;
 }
@@ -172,17 +647,17 @@ void JSONEnd(json_writer* Writer) {
 	Writer->LayerElements[Writer->CurrentLayer] = 0;
 	Writer->CurrentLayer--;
 
-	JSONWriteLine(Writer, "}");
+	JSONWriteBracket(Writer, '}', DIMA_JSON_WRITER_CBOR_BREAK);
 	Writer->Buf[Writer->CurrentIndex] = 0;
 
 	Writer->LayerElements[Writer->CurrentLayer]++;
 }
 
 void JSONBeginArr(json_writer* Writer, char* Name) {
-	char LineBuf[256];
-	DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": [", Name);
-
-	JSONWriteLine(Writer, LineBuf);
+	JSONBeginLine(Writer, 0);
+	JSONWriteKey(Writer, Name);
+	JSONCopyCharToBuf(Writer, (Writer->Flags & JSONWriterFlag_CBOR) ? DIMA_JSON_WRITER_CBOR_ARR_BEGIN : '[');
+	JSONEndLine(Writer);
 
 	Writer->CurrentLayer++;
 }
@@ -191,45 +666,66 @@ void JSONEndArr(json_writer* Writer) {
 	Writer->LayerElements[Writer->CurrentLayer] = 0;
 	Writer->CurrentLayer--;
 
-	JSONWriteLine(Writer, "]");
+	JSONWriteBracket(Writer, ']', DIMA_JSON_WRITER_CBOR_BREAK);
 
 	Writer->LayerElements[Writer->CurrentLayer]++;
 }
 
-void JSONAddU32(json_writer* Writer, char* Key, uint32_t Value) {
-	char LineBuf[256];
-	DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": %u", Key, Value);
+void JSONBeginRecord(json_writer* Writer) {
+	//NOTE(dima): A record is one line, and it never takes a comma after the previous one
+	Writer->Flags &= ~JSONWriterFlag_Pretty;
 
-	JSONWriteLine(Writer, LineBuf);
+	JSONCopyCharToBuf(Writer, (Writer->Flags & JSONWriterFlag_CBOR) ? DIMA_JSON_WRITER_CBOR_MAP_BEGIN : '{');
+	Writer->LastPossibleCommaIndex = Writer->CurrentIndex;
 
-	Writer->LayerElements[Writer->CurrentLayer]++;
+	Writer->CurrentLayer = 1;
+	Writer->LayerElements[1] = 0;
 }
 
-void JSONAddS32(json_writer* Writer, char* Key, int32_t Value) {
-	char LineBuf[256];
-	DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": %d", Key, Value);
+void JSONEndRecord(json_writer* Writer) {
+	Writer->LayerElements[1] = 0;
+	Writer->CurrentLayer = 0;
+	Writer->LayerElements[0] = 0;
+
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		JSONCopyCharToBuf(Writer, DIMA_JSON_WRITER_CBOR_BREAK);
+	}
+	else {
+		JSONCopyBytesToBuf(Writer, (char*)"}\n", 2);
+	}
+	Writer->LastPossibleCommaIndex = Writer->CurrentIndex;
 
-	JSONWriteLine(Writer, LineBuf);
+	Writer->RecordsEnd = Writer->CurrentIndex;
+	Writer->PendingRecords++;
+	Writer->RecordCount++;
 
-	Writer->LayerElements[Writer->CurrentLayer]++;
+	//NOTE(dima): So that the sink gets whole records, unless one is bigger than half the buffer
+	if (Writer->Sink && Writer->CurrentIndex >= Writer->BufSize / 2) {
+		JSONFlushRecords(Writer);
+	}
 }
 
-void JSONAddU64(json_writer* Writer, char* Key, uint64_t Value) {
-	char LineBuf[256];
-	DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": %llu", Key, Value);
+int32_t JSONFlushRecords(json_writer* Writer) {
+	JSONFlushBytes(Writer, Writer->RecordsEnd);
+	Writer->PendingRecords = 0;
 
-	JSONWriteLine(Writer, LineBuf);
+	return(!Writer->SinkFailed);
+}
 
-	Writer->LayerElements[Writer->CurrentLayer]++;
+void JSONAddU32(json_writer* Writer, char* Key, uint32_t Value) {
+	JSONAddNumberLine(Writer, Key, (uint64_t)Value, 0);
 }
 
-void JSONAddS64(json_writer* Writer, char* Key, int64_t Value) {
-	char LineBuf[256];
-	DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": %lld", Key, Value);
+void JSONAddS32(json_writer* Writer, char* Key, int32_t Value) {
+	JSONAddNumberLine(Writer, Key, (uint64_t)(int64_t)Value, 1);
+}
 
-	JSONWriteLine(Writer, LineBuf);
+void JSONAddU64(json_writer* Writer, char* Key, uint64_t Value) {
+	JSONAddNumberLine(Writer, Key, (uint64_t)Value, 0);
+}
 
-	Writer->LayerElements[Writer->CurrentLayer]++;
+void JSONAddS64(json_writer* Writer, char* Key, int64_t Value) {
+	JSONAddNumberLine(Writer, Key, (uint64_t)(int64_t)Value, 1);
 }
 
 
@@ -244,97 +740,90 @@ void add_str(char* Key, char* Value) {
 }
 */
 
-void JSONAddSTR(json_writer* Writer, char* Key, char* Value) {
-	int32_t KeyLen = strlen(Key);
-	int32_t ValueLen = strlen(Value);
+void JSONAddSTRLen(json_writer* Writer, char* Key, int32_t KeyLen, char* Value, int32_t ValueLen) {
+	JSONBeginLine(Writer, 0);
+	JSONWriteKeyLen(Writer, Key, KeyLen);
 
-	char* LineBuf = (char*)malloc(KeyLen + ValueLen + 16);
-	if (Value) {
-		DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": \"%s\"", Key, Value);
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		if (Value) {
+			JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_TEXT, (uint64_t)ValueLen);
+			JSONCopyBytesToBuf(Writer, Value, ValueLen);
+		}
+		else {
+			JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_UINT, 0);
+		}
+	}
+	else if (Value) {
+		JSONCopyCharToBuf(Writer, '\"');
+		JSONWriteEscaped(Writer, Value, ValueLen);
+		JSONCopyCharToBuf(Writer, '\"');
 	}
 	else {
-		DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": 0", Key);
+		JSONCopyCharToBuf(Writer, '0');
 	}
 
-	JSONWriteLine(Writer, LineBuf);
+	JSONEndLine(Writer);
 
 	Writer->LayerElements[Writer->CurrentLayer]++;
+}
 
-	free(LineBuf);
+void JSONAddSTR(json_writer* Writer, char* Key, char* Value) {
+	JSONAddSTRLen(Writer, Key, (int32_t)strlen(Key), Value, Value ? (int32_t)strlen(Value) : 0);
 }
 
 void JSONAddFixedSTR(json_writer* Writer, char* Key, char* Value, int32_t ValueLen) {
-	int32_t KeyLen = strlen(Key);
-	char* LineBuf = (char*)malloc(KeyLen + ValueLen + 16);
-
-	if (Value) {
-		char LinePart1[256];
-		DIMA_JSON_WRITER_SPRINTF(LinePart1, "\"%s\": \"", Key);
-
-		char LinePart2[256];
-		int i = 0;
-		for (i = 0; i < ValueLen; i++)
-		{
-			LinePart2[i] = Value[i];
-		}
-		LinePart2[i++] = '\"';
-		LinePart2[i] = 0;
-
-		DIMA_JSON_WRITER_SPRINTF(LineBuf, "%s%s", LinePart1, LinePart2);
-	}
-	else {
-		DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": 0", Key);
-	}
-
-	JSONWriteLine(Writer, LineBuf);
-
-	Writer->LayerElements[Writer->CurrentLayer]++;
-
-	free(LineBuf);
+	JSONAddSTRLen(Writer, Key, (int32_t)strlen(Key), Value, ValueLen);
 }
 
 void JSONAddDataHex(json_writer* Writer, char* Key, uint8_t* Value, int32_t ValueLen) {
-	int32_t KeyLen = strlen(Key);
-
-	char* LineBuf = (char*)malloc(KeyLen + ValueLen * 2 + 16);
-
-	if (Value) {
-		char* To = LineBuf;
-		*To++ = '\"';
-
-		for (int i = 0; i < KeyLen; i++) {
-			*To++ = Key[i];
+	JSONBeginLine(Writer, 0);
+	JSONWriteKey(Writer, Key);
+
+	if (Writer->Flags & JSONWriterFlag_CBOR) {
+		//NOTE(dima): Raw bytes, no hex
+		if (Value) {
+			JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_BYTES, (uint64_t)ValueLen);
+			JSONCopyBytesToBuf(Writer, (char*)Value, ValueLen);
+		}
+		else {
+			JSONWriteCBORHead(Writer, DIMA_JSON_WRITER_CBOR_UINT, 0);
 		}
-		*To++ = '\"';
-		*To++ = ':';
-		*To++ = ' ';
-		*To++ = '\"';
+	}
+	else if (Value) {
+		JSONCopyCharToBuf(Writer, '\"');
 
-		for (int i = 0; i < ValueLen; i++) {
-			char Temp[4];
-			DIMA_JSON_WRITER_SPRINTF(Temp, "%2.2X", Value[i]);
+		//NOTE(dima): 32 bytes of input, 64 chars of output at a time, so that it works in sink mode too
+		for (int32_t Offset = 0; Offset < ValueLen; Offset += 32) {
+			int32_t Count = (ValueLen - Offset < 32) ? (ValueLen - Offset) : 32;
 
-			*To++ = Temp[0];
-			*To++ = Temp[1];
+			JSONFormatHex(JSONReserveDirect(Writer, Count * 2), Value + Offset, Count);
+			Writer->CurrentIndex += Count * 2;
 		}
-		*To++ = '\"';
-		*To = 0;
+
+		JSONCopyCharToBuf(Writer, '\"');
 	}
 	else {
-		DIMA_JSON_WRITER_SPRINTF(LineBuf, "\"%s\": 0", Key);
+		JSONCopyCharToBuf(Writer, '0');
 	}
 
-	JSONWriteLine(Writer, LineBuf);
+	JSONEndLine(Writer);
 
 	Writer->LayerElements[Writer->CurrentLayer]++;
-
-	free(LineBuf);
 }
 
 char* JSONGetBuf(json_writer* Writer) {
+	//NOTE(dima): JSONReserve always leaves room for the zero
+	Writer->Buf[Writer->CurrentIndex] = 0;
+
 	char* Result = Writer->Buf;
 
 	return(Result);
 }
 
+int32_t JSONGetSize(json_writer* Writer) {
+	int32_t Result = Writer->CurrentIndex;
+
+	return(Result);
+}
+
 #endif
\ No newline at end of file
@@ -850,6 +850,44 @@ void memRev(
 
 
 
+/*
+*******************************************************************************
+Редукция Крэндалла
+*******************************************************************************
+*/
+
+/*!	\brief Модуль Крэндалла?
+
+	Проверяется, что модуль [n]mod имеет вид B^n - c, где B = 2^B_PER_W 
+	и 0 < c < B. Такой вид имеют модули p всех уровней стойкости bign:
+	2^256 - 189, 2^384 - 317 и 2^512 - 569.
+	\return Признак успеха.
+*/
+bool_t zzIsCrand(
+	const word mod[],	/*!< [in] модуль */
+	size_t n			/*!< [in] длина mod в машинных словах */
+);
+
+/*!	\brief Редукция Крэндалла
+
+	Определяется вычет [n]a числа [2 * n]a по модулю Крэндалла [n]mod:
+	\code
+		a <- a mod mod.
+	\endcode
+	Старшая половина a умножается на c = B^n - mod и добавляется 
+	к младшей половине (B^n = c по модулю mod). Деление не выполняется.
+	\pre zzIsCrand(mod, n).
+	\deep{stack} zzRedCrand_deep(n).
+*/
+void zzRedCrand(
+	word a[],			/*!< [in/out] делимое / вычет */
+	const word mod[],	/*!< [in] модуль */
+	size_t n,			/*!< [in] длина mod в машинных словах */
+	void* stack			/*!< [in] вспомогательная память */
+);
+
+size_t zzRedCrand_deep(size_t n);
+
 /*!	\brief Импорт из аффинной точки
 
 	По аффинной точке [2 * ec->f->n]a эллиптической кривой ec строится 
@@ -1153,6 +1191,22 @@ typedef struct ec_o
 #define ecIsO(a, ec)\
 	wwIsZero(ecZ(a, (ec)->f->n), (ec)->f->n)
 
+/*!	\brief Максимальная глубина стека для кривой
+
+	Определяется глубина стека, достаточная для любой функции 
+	описания ec и для ecMulA() с кратностями из m машинных слов.
+	Значение зависит только от кривой и m, поэтому рассчитывается один раз 
+	для кривой. Память такого размера выделяется заранее (например, 
+	в арене gorbn_arena, см. gor_bignum.h) и многократно передается 
+	в функции ec* в качестве stack: на горячем пути память не выделяется.
+	\pre Описание ec работоспособно.
+	\return Глубина стека в октетах.
+*/
+size_t ecMax_deep(
+	const ec_o* ec,		/*!< [in] описание кривой */
+	size_t m			/*!< [in] длина кратности в машинных словах */
+);
+
 #endif
 
 
@@ -1601,6 +1655,83 @@ void memRev(void* buf, size_t count)
 }
 
 
+/*
+*******************************************************************************
+Редукция Крэндалла
+*******************************************************************************
+*/
+
+bool_t zzIsCrand(const word mod[], size_t n)
+{
+	size_t i;
+	if (n < 2 || mod[0] == 0)
+		return FALSE;
+	for (i = 1; i < n; ++i)
+		if (mod[i] != WORD_MAX)
+			return FALSE;
+	return TRUE;
+}
+
+void zzRedCrand(word a[], const word mod[], size_t n, void* stack)
+{
+	register word c = WORD_0 - mod[0];
+	register word carry;
+	register word mask;
+	register dword prod;
+	register size_t pass;
+	size_t i;
+	// pre
+	ASSERT(zzIsCrand(mod, n));
+	ASSERT(memIsValid(a, O_OF_W(2 * n)));
+	// a[0..n) <- a[0..n) + c * a[n..2n), carry <- старшее слово (<= c)
+	for (i = 0, carry = 0; i < n; ++i)
+	{
+		prod = (dword)c * a[n + i] + a[i] + carry;
+		a[i] = (word)prod;
+		carry = (word)(prod >> B_PER_W);
+	}
+	// a <- a + c * carry (второй проход учитывает возможный перенос)
+	for (pass = 0; pass < 2; ++pass)
+	{
+		prod = (dword)c * carry + a[0];
+		a[0] = (word)prod;
+		carry = (word)(prod >> B_PER_W);
+		for (i = 1; i < n; ++i)
+		{
+			prod = (dword)a[i] + carry;
+			a[i] = (word)prod;
+			carry = (word)(prod >> B_PER_W);
+		}
+	}
+	// a < B^n < 2 mod => не более одного вычитания
+	// a - mod = a + c - B^n => a >= mod <=> a + c дает перенос
+	prod = (dword)a[0] + c;
+	carry = (word)(prod >> B_PER_W);
+	for (i = 1; i < n; ++i)
+	{
+		prod = (dword)a[i] + carry;
+		carry = (word)(prod >> B_PER_W);
+	}
+	// a <- a + (c & mask) без ветвлений, перенос B^n отбрасывается
+	mask = WORD_0 - carry;
+	prod = (dword)a[0] + (c & mask);
+	a[0] = (word)prod;
+	carry = (word)(prod >> B_PER_W);
+	for (i = 1; i < n; ++i)
+	{
+		prod = (dword)a[i] + carry;
+		a[i] = (word)prod;
+		carry = (word)(prod >> B_PER_W);
+	}
+	// очистка
+	prod = 0, carry = 0, c = 0, mask = 0;
+}
+
+size_t zzRedCrand_deep(size_t n)
+{
+	return 0;
+}
+
 bool_t ecpCreateJ(ec_o* ec, const qr_o* f, const octet A[], const octet B[], 
 	void* stack)
 {
@@ -1823,4 +1954,12 @@ size_t ecMulA_deep(size_t n, size_t ec_d, size_t ec_deep, size_t m)
 		O_OF_W(ec_d * n) +
 		O_OF_W(ec_d * n * naf_count) +
 		ec_deep;
-}
\ No newline at end of file
+}
+
+size_t ecMax_deep(const ec_o* ec, size_t m)
+{
+	ASSERT(ecIsOperable(ec));
+	return utilMax(2,
+		ec->deep,
+		ecMulA_deep(ec->f->n, ec->d, ec->deep, m));
+}
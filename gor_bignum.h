@@ -51,7 +51,13 @@
 		Gorevoy Dmitry - github.com/gorevojd
 */
 
+/*
+	NOTE(dima): Limb size in bytes. Can be defined before including this file.
+	8-byte limbs need unsigned __int128 for the double-width temporaries.
+*/
+#ifndef GORBN_SZWORD
 #define GORBN_SZWORD 2
+#endif
 #define GORBN_SZARR (32 / GORBN_SZWORD)
 
 #ifndef GORBN_SZWORD
@@ -83,8 +89,20 @@
 #define GORBN_SZWORD_BITS_MINUS_ONE 31
 #define GORBN_HIGH_BIT_SET 0x80000000
 
-#elif
-#error GORBN_SZWORD must be defined to 1, 2 or 4
+#elif (GORBN_SZWORD == 8)
+#if !defined(__SIZEOF_INT128__)
+#error GORBN_SZWORD 8 requires unsigned __int128 support
+#endif
+#define gorbn_t unsigned long long
+#define gorbn_utmp_t unsigned __int128
+#define gorbn_stmp_t __int128
+#define GORBN_MAX_VAL 0xFFFFFFFFFFFFFFFFull
+#define GORBN_SZWORD_BITS 64
+#define GORBN_SZWORD_BITS_MINUS_ONE 63
+#define GORBN_HIGH_BIT_SET 0x8000000000000000ull
+
+#else
+#error GORBN_SZWORD must be defined to 1, 2, 4 or 8
 #endif
 
 #define GORBN_SZARR_BITS_TOTAL (GORBN_SZARR * GORBN_SZWORD_BITS)
@@ -97,6 +115,53 @@ typedef struct gorec_point {
 	int is_inf;
 } gorec_point;
 
+/*
+	Montgomery context. Precomputed once per modulus m (m must be odd).
+	R = 2 ^ GORBN_SZARR_BITS_TOTAL.
+*/
+typedef struct gorbn_mont_ctx {
+	gorbn_t m[GORBN_SZARR];
+	gorbn_t r2[GORBN_SZARR]; /* R ^ 2 mod m */
+	gorbn_t one[GORBN_SZARR]; /* R mod m, i.e. 1 in Montgomery form */
+	gorbn_t m_inv; /* -m ^ -1 mod 2 ^ GORBN_SZWORD_BITS */
+} gorbn_mont_ctx;
+
+struct gorec_curve;
+
+#define GOREC_PT_ADD(name) void name(gorec_point* r, gorec_point* a, gorec_point* b, struct gorec_curve* crv)
+typedef GOREC_PT_ADD(gorec_pt_add_type);
+
+#define GOREC_PT_DOUBLE(name) void name(gorec_point* r, gorec_point* a, struct gorec_curve* crv)
+typedef GOREC_PT_DOUBLE(gorec_pt_double_type);
+
+/*
+	4-way field arithmetic for p = 2^256 - c with small c (all bign curves).
+	Four independent field elements are stored limb-sliced: limb i of lane j
+	is l[i][j], 10 limbs of 26 bits, so one AVX2 register holds the same
+	limb of all four elements. Between operations values are only loosely
+	reduced (below 2^260), gorec_fe_x4_store() returns the canonical one.
+
+	AVX2 code is picked at runtime, otherwise the same layout is processed
+	by plain C. Define GOR_BIGNUM_NO_SIMD to never use intrinsics.
+*/
+#define GOREC_X4_LANES 4
+#define GOREC_X4_LIMBS 10
+#define GOREC_X4_LIMB_BITS 26
+
+typedef struct gorec_fe_x4 {
+	uint64_t l[GOREC_X4_LIMBS][GOREC_X4_LANES];
+} gorec_fe_x4;
+
+typedef struct gorec_x4_ctx {
+	int enabled; /* p = 2^256 - c, c < 2^16 */
+	uint64_t fold; /* 2^260 mod p = 16 * c */
+	uint64_t p32[GOREC_X4_LIMBS]; /* 32 * p, every limb is above 2^27 */
+} gorec_x4_ctx;
+
+/*Tokens returned by gorec_x4_simd()*/
+#define GOREC_X4_SIMD_NONE 0
+#define GOREC_X4_SIMD_AVX2 1
+
 typedef struct gorec_curve {
 	gorbn_t a[GORBN_SZARR];
 	gorbn_t b[GORBN_SZARR];
@@ -105,8 +170,164 @@ typedef struct gorec_curve {
 	gorbn_t q[GORBN_SZARR];
 
 	gorec_point g;
+
+	/*NOTE(dima): Filled by gorec_curve_prepare()*/
+	int field_kind; /* One of GOREC_FIELD_* */
+	gorbn_t crand_c; /* c for p = 2 ^ GORBN_SZARR_BITS_TOTAL - c */
+	gorbn_mont_ctx mont;
+	gorbn_t a_repr[GORBN_SZARR]; /* A in the internal field representation */
+	int a_is_minus3; /* A = p - 3 */
+	gorec_pt_double_type* pt_double; /* Jacobian doubling picked for this A */
+	gorec_x4_ctx x4;
 } gorec_curve;
 
+/*Tokens for gorec_curve::field_kind - how field elements are reduced*/
+#define GOREC_FIELD_MONT 0 /* Montgomery form, any odd p */
+#define GOREC_FIELD_CRAND 1 /* Pseudo-Mersenne p = 2^n - c, normal form */
+
+/*
+	Batch scalar multiplication (gorec_pt_mul_batch). Work is split into
+	chunks of GOREC_BATCH_CHUNK points, every chunk is normalized with one
+	inversion. Define GOR_BIGNUM_NO_THREADS to always run on the calling
+	thread. Otherwise pthreads are used (link with -lpthread), or Win32
+	threads on Windows.
+
+	Worker threads live in one process-wide pool. They are created by the
+	first batch that needs them and then sleep between batches, so a batch
+	costs a wakeup per worker, not a thread creation. Batches started from
+	different threads at once take turns on the pool.
+*/
+#ifndef GOREC_BATCH_CHUNK
+#define GOREC_BATCH_CHUNK 16
+#endif
+#define GOREC_BATCH_MAX_THREADS 64
+
+/*Max number of points sharing one inversion in gorec_pt_normalize_batch()*/
+#ifndef GOREC_NORMALIZE_BATCH_CHUNK
+#define GOREC_NORMALIZE_BATCH_CHUNK 64
+#endif
+
+/*
+	Fixed-base table for the generator. Window i holds affine multiples
+	j * 2^(GOREC_BASE_W * i) * G, j = 1..2^(GOREC_BASE_W-1), in the internal
+	field representation of the curve it was built for. Signed digits are
+	used, so negative multiples are obtained by negating y.
+
+	The table is only read by gorec_pt_mul_base(), so one table can be
+	shared between threads. It is big (about 50 KB for 256-bit curves),
+	better not to put it on the stack.
+*/
+#define GOREC_BASE_W 4
+#define GOREC_BASE_WINDOWS_COUNT (GORBN_SZARR_BITS_TOTAL / GOREC_BASE_W + 1)
+#define GOREC_BASE_POINTS_PER_WINDOW (1 << (GOREC_BASE_W - 1))
+
+typedef struct gorec_base_table {
+	gorec_point points[GOREC_BASE_WINDOWS_COUNT][GOREC_BASE_POINTS_PER_WINDOW];
+} gorec_base_table;
+
+/*
+	Cache of fixed-base tables for points that are multiplied over and over
+	(public keys checked in every signature verification). Keys are affine
+	points, tables are the same as gorec_base_table, so a hit costs about as
+	much as gorec_pt_mul_base(). Building a table costs several uncached
+	multiplications, so a point gets one only when it is missed a second
+	time while still among the last missed points, twice as many as there
+	are entries (at most GOREC_TABLE_CACHE_RECENT). Until then, and whenever
+	every entry is in use, it goes the uncached way. So keys that come back
+	less often than that never replace tables, and cost no more than
+	uncached multiplication.
+
+	Memory is given by the caller at init, its size is the budget: every
+	entry takes sizeof(gorec_table_cache_entry) bytes (about 50 KB for
+	256-bit curves), nothing is allocated later. Entries are split into sets
+	of GOREC_TABLE_CACHE_WAYS by a hash of x, a point is looked up in its
+	set only, and the least recently missed table not in use is replaced.
+
+	Lookups are safe from any number of threads. A hit takes no lock, only
+	an atomic increment of the users of the entry, so hits on the same
+	table run at the same time. A short spin lock guards misses, admission
+	and replacement, tables are built outside of it, and an entry is never
+	replaced while some thread uses its table. With GOR_BIGNUM_NO_THREADS
+	there is no locking at all.
+*/
+#ifndef GOREC_TABLE_CACHE_WAYS
+#define GOREC_TABLE_CACHE_WAYS 4
+#endif
+#ifndef GOREC_TABLE_CACHE_RECENT
+#define GOREC_TABLE_CACHE_RECENT 64
+#endif
+
+#define GOREC_TABLE_CACHE_FREE 0
+#define GOREC_TABLE_CACHE_BUILDING 1 /* table is being built by some thread */
+#define GOREC_TABLE_CACHE_READY 2
+
+typedef struct gorec_table_cache_entry {
+	gorbn_t x[GORBN_SZARR];
+	gorbn_t y[GORBN_SZARR];
+	uint32_t hash; /* of x */
+
+	volatile long state; /* One of GOREC_TABLE_CACHE_* */
+	volatile long users; /* Threads that use the table right now, -1 while it is replaced */
+	volatile uint64_t last_used; /* Cache clock of the last lookup */
+
+	gorec_base_table table;
+} gorec_table_cache_entry;
+
+typedef struct gorec_table_cache {
+	gorec_curve* crv;
+	gorec_table_cache_entry* entries;
+	int entries_count;
+	int sets_count;
+
+	volatile long lock;
+	volatile uint64_t clock; /* Goes up on every miss */
+
+	//NOTE(dima): Hashes of recently missed points, 0 is an empty slot
+	uint32_t recent[GOREC_TABLE_CACHE_RECENT];
+	int recent_count;
+	int recent_next;
+
+	volatile uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} gorec_table_cache;
+
+typedef struct gorec_table_cache_stats {
+	uint64_t hits;
+	uint64_t misses; /* Including lookups that fell back to uncached multiplication */
+	uint64_t evictions;
+	int entries_used;
+	int entries_count;
+	size_t bytes;
+} gorec_table_cache_stats;
+
+/*
+	Scratch arena. A caller-owned block of memory that hands out aligned
+	pieces and is reset between operations, so that nothing is allocated
+	on the hot path. Bind it with gorbn_arena_bind() and gor_bignum takes
+	its big temporaries (gorbn_div buffers) from it instead of the C stack,
+	which matters on fibers with small stacks. GORBN_ARENA_DEEP bytes are
+	enough for any gor_bignum call.
+
+	The same arena can serve ecurva.h: push ecMax_deep(ec, m) bytes once
+	and pass the result as the stack argument of ec* functions.
+
+	An arena is not synchronized, every thread should have its own one.
+*/
+#ifndef GORBN_ARENA_ALIGN
+#define GORBN_ARENA_ALIGN 64
+#endif
+
+#define GORBN_DIV_SCRATCH_DIGITS (GORBN_SZARR * 12)
+#define GORBN_ARENA_DEEP (GORBN_DIV_SCRATCH_DIGITS * GORBN_SZWORD + GORBN_ARENA_ALIGN)
+
+typedef struct gorbn_arena {
+	uint8_t* mem;
+	size_t size;
+	size_t used;
+	size_t peak; /* Max used since init, to tune the size */
+} gorbn_arena;
+
 /* Custom macro for getting absolute value of the signed integer*/
 #define GORBN_ABS(val) (((val) >= 0) ? (val) : (-(val)))
 
@@ -146,12 +367,6 @@ typedef struct gorec_curve {
 #define GORBN_DEF extern
 #endif
 
-#define GOREC_PT_ADD(name) void name(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv)
-typedef GOREC_PT_ADD(gorec_pt_add_type);
-
-#define GOREC_PT_DOUBLE(name) void name(gorec_point* r, gorec_point* a, gorec_curve* crv)
-typedef GOREC_PT_DOUBLE(gorec_pt_double_type);
-
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -213,6 +428,27 @@ extern "C" {
 	GORBN_DEF void gorbn_add_mod(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_t* m);
 	GORBN_DEF void gorbn_mul_mod(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_t* m);
 
+	/* Montgomery arithmetic (inputs must be reduced modulo ctx->m) */
+	GORBN_DEF void gorbn_mont_init(gorbn_mont_ctx* ctx, gorbn_t* m);
+	GORBN_DEF void gorbn_mont_mul(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_mont_ctx* ctx); /* r = a * b * R^-1 mod m */
+	GORBN_DEF void gorbn_mont_sqr(gorbn_t* r, gorbn_t* a, gorbn_mont_ctx* ctx); /* r = a * a * R^-1 mod m */
+	GORBN_DEF void gorbn_to_mont(gorbn_t* r, gorbn_t* a, gorbn_mont_ctx* ctx); /* r = a * R mod m */
+	GORBN_DEF void gorbn_from_mont(gorbn_t* r, gorbn_t* a, gorbn_mont_ctx* ctx); /* r = a * R^-1 mod m */
+
+	/* Fast reduction modulo pseudo-Mersenne (Crandall) prime m = 2^(n * GORBN_SZWORD_BITS) - c */
+	GORBN_DEF int gorbn_is_crand(gorbn_t* m, int n, gorbn_t* c);
+	GORBN_DEF void gorbn_red_crand(gorbn_t* r, gorbn_t* a, int n, gorbn_t c); /* r = a mod m, a has 2 * n digits */
+
+	GORBN_DEF void gorbn_cswap(gorbn_t* a, gorbn_t* b, int swap); /* constant-time swap when swap = 1 */
+
+	/* Scratch arena */
+	GORBN_DEF void gorbn_arena_init(gorbn_arena* arena, void* mem, size_t size);
+	GORBN_DEF void* gorbn_arena_push(gorbn_arena* arena, size_t size); /* aligned to GORBN_ARENA_ALIGN, 0 if it does not fit */
+	GORBN_DEF size_t gorbn_arena_mark(gorbn_arena* arena);
+	GORBN_DEF void gorbn_arena_pop(gorbn_arena* arena, size_t mark); /* frees everything pushed after mark */
+	GORBN_DEF void gorbn_arena_reset(gorbn_arena* arena);
+	GORBN_DEF gorbn_arena* gorbn_arena_bind(gorbn_arena* arena); /* scratch for the calling thread, 0 to unbind. Returns previous */
+
 	/* Bitwise operations: */
 	GORBN_DEF void gorbn_and(gorbn_t* r, gorbn_t* a, gorbn_t* b); /* r = a & b */
 	GORBN_DEF void gorbn_or(gorbn_t* r, gorbn_t* a, gorbn_t* b); /* r = a | b */
@@ -230,6 +466,20 @@ extern "C" {
 
 	/* Eliptic curve algorithms */
 	GORBN_DEF void gorec_load_stb128(gorec_curve* crv);
+	GORBN_DEF void gorec_curve_prepare(gorec_curve* crv); /* Must be called after a, b, p, q are set */
+
+	/*
+		Jacobian point arithmetic. Coordinates are in the internal field
+		representation of the curve (see gorec_curve::field_kind).
+		Mixed versions need b to be affine (Z = 1).
+	*/
+	GORBN_DEF void gorec_pt_double_jacobian(gorec_point* r, gorec_point* a, gorec_curve* crv);
+	GORBN_DEF void gorec_pt_double_jacobian_a3(gorec_point* r, gorec_point* a, gorec_curve* crv); /* A = -3 only */
+	GORBN_DEF void gorec_pt_add_jacobian(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv);
+	GORBN_DEF void gorec_pt_add_mixed(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv);
+	GORBN_DEF void gorec_pt_sub_mixed(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv);
+
+	GORBN_DEF void gorec_pt_normalize_batch(gorec_point* points, int n, gorec_curve* crv); /* Jacobian -> affine, shared inversion */
 
 	GORBN_DEF void gorec_pt_mul(
 		gorec_point* p_result,
@@ -249,6 +499,87 @@ extern "C" {
 		gorbn_t *p_scalar,
 		gorec_curve* crv);
 
+	GORBN_DEF void gorec_pt_mul_double(
+		gorec_point* p_result,
+		gorbn_t* k1, gorec_point* p1,
+		gorbn_t* k2, gorec_point* p2,
+		gorec_curve* crv); /* r = k1 * P1 + k2 * P2 */
+
+	/*
+		Independent multiplications results[i] = scalars[i] * points[i] spread
+		across nthreads threads. scalars holds n numbers of GORBN_SZARR digits
+		one after another. Results are the same as of gorec_pt_mul_wnaf_jacobian().
+	*/
+	GORBN_DEF void gorec_pt_mul_batch(
+		gorec_point* results,
+		gorec_point* points,
+		gorbn_t* scalars,
+		int n,
+		gorec_curve* crv,
+		int nthreads);
+
+	/*
+		Stops and joins the pool threads of gorec_pt_mul_batch(), for example
+		before unloading a library. No batch may run during this. The next
+		batch starts them again.
+	*/
+	GORBN_DEF void gorec_pt_mul_batch_shutdown(void);
+
+	/*
+		4-way field arithmetic, only when crv->x4.enabled. Inputs of load must
+		be below p, lane is 0..GOREC_X4_LANES-1. r may alias the inputs.
+	*/
+	GORBN_DEF int gorec_x4_simd(void); /* GOREC_X4_SIMD_* used on this CPU */
+	GORBN_DEF void gorec_fe_x4_load(gorec_fe_x4* r, int lane, gorbn_t* a);
+	GORBN_DEF void gorec_fe_x4_store(gorbn_t* r, gorec_fe_x4* a, int lane, gorec_curve* crv);
+	GORBN_DEF void gorec_fe_x4_add(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_curve* crv);
+	GORBN_DEF void gorec_fe_x4_sub(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_curve* crv);
+	GORBN_DEF void gorec_fe_x4_mul(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_curve* crv);
+
+	/*
+		Four independent multiplications results[i] = scalars[i] * points[i]
+		running the ladder of gorec_pt_mul_monty() in lockstep on the 4-way
+		field layer. Falls back to gorec_pt_mul_monty() per point if the
+		curve does not suit the layer. Same requirements and results as the
+		single version, scalars holds 4 numbers of GORBN_SZARR digits.
+	*/
+	GORBN_DEF void gorec_pt_mul_x4(
+		gorec_point* results,
+		gorec_point* points,
+		gorbn_t* scalars,
+		gorec_curve* crv);
+
+	/* Fixed-base multiplication by generator crv->g using precomputed table */
+	GORBN_DEF void gorec_base_table_build(gorec_base_table* table, gorec_curve* crv);
+	GORBN_DEF void gorec_pt_table_build(gorec_base_table* table, gorec_point* p, gorec_curve* crv); /* same for any affine p */
+	GORBN_DEF void gorec_pt_mul_base(
+		gorec_point* p_result,
+		gorbn_t *p_scalar,
+		gorec_base_table* table,
+		gorec_curve* crv);
+
+	/*
+		Table cache. init returns the number of entries that fit into mem, 0 if
+		none. Cached multiplications take p in normal affine form, anything
+		else, a first miss, or no free entry, goes the uncached way
+		(gorec_pt_mul_wnaf_jacobian, gorec_pt_mul_double) with the same results.
+	*/
+	GORBN_DEF int gorec_table_cache_init(gorec_table_cache* cache, void* mem, size_t size, gorec_curve* crv);
+	GORBN_DEF void gorec_table_cache_clear(gorec_table_cache* cache); /* no thread may use the cache during this */
+	GORBN_DEF void gorec_table_cache_get_stats(gorec_table_cache* cache, gorec_table_cache_stats* stats);
+
+	GORBN_DEF void gorec_pt_mul_cached(
+		gorec_point* p_result,
+		gorec_point* p_point,
+		gorbn_t* p_scalar,
+		gorec_table_cache* cache);
+
+	GORBN_DEF void gorec_pt_mul_double_cached(
+		gorec_point* p_result,
+		gorbn_t* k1, gorec_point* p1,
+		gorbn_t* k2, gorec_point* p2,
+		gorec_table_cache* cache); /* r = k1 * P1 + k2 * P2 */
+
 #ifdef __cplusplus
 }
 #endif
@@ -258,6 +589,57 @@ extern "C" {
 #if defined(GOR_BIGNUM_IMPLEMENTATION) && !defined(GOR_BIGNUM_IMPLEMENTATION_DONE)
 #define GOR_BIGNUM_IMPLEMENTATION_DONE
 
+#ifndef GOR_BIGNUM_NO_THREADS
+#ifdef _WIN32
+#include <windows.h>
+#define _GOREC_ATOMIC_FETCH_INC(ptr) (InterlockedIncrement(ptr) - 1)
+#define _GOREC_ATOMIC_DEC(ptr) InterlockedDecrement(ptr)
+#define _GOREC_ATOMIC_INC64(ptr) InterlockedIncrement64((volatile LONG64*)(ptr))
+#define _GOREC_ATOMIC_CAS(ptr, old_val, new_val) (InterlockedCompareExchange(ptr, new_val, old_val) == (old_val))
+#define _GOREC_SPIN_LOCK(ptr) while (InterlockedExchange(ptr, 1)) { YieldProcessor(); }
+#define _GOREC_SPIN_UNLOCK(ptr) InterlockedExchange(ptr, 0)
+#else
+#include <pthread.h>
+#define _GOREC_ATOMIC_FETCH_INC(ptr) __sync_fetch_and_add(ptr, 1)
+#define _GOREC_ATOMIC_DEC(ptr) __sync_fetch_and_sub(ptr, 1)
+#define _GOREC_ATOMIC_INC64(ptr) __sync_fetch_and_add(ptr, 1)
+#define _GOREC_ATOMIC_CAS(ptr, old_val, new_val) __sync_bool_compare_and_swap(ptr, old_val, new_val)
+#define _GOREC_SPIN_LOCK(ptr) while (__sync_lock_test_and_set(ptr, 1)) {}
+#define _GOREC_SPIN_UNLOCK(ptr) __sync_lock_release(ptr)
+#endif
+#else
+#define _GOREC_ATOMIC_DEC(ptr) ((*(ptr))--)
+#define _GOREC_ATOMIC_INC64(ptr) ((*(ptr))++)
+#define _GOREC_ATOMIC_CAS(ptr, old_val, new_val) ((*(ptr) == (old_val)) ? (*(ptr) = (new_val), 1) : 0)
+#define _GOREC_SPIN_LOCK(ptr)
+#define _GOREC_SPIN_UNLOCK(ptr)
+#endif
+
+#if !defined(GOR_BIGNUM_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define _GOREC_X4_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define _GOREC_TARGET_AVX2
+#else
+#define _GOREC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifndef GORBN_THREAD_LOCAL
+#ifdef _MSC_VER
+#define GORBN_THREAD_LOCAL __declspec(thread)
+#else
+#define GORBN_THREAD_LOCAL __thread
+#endif
+#endif
+
+#ifdef _MSC_VER
+#define _GORBN_NOINLINE __declspec(noinline)
+#else
+#define _GORBN_NOINLINE __attribute__((noinline))
+#endif
+
 void _gorbn_mem_copy(void* to, void* from, size_t byte_count) {
 	uint8_t* _to = (uint8_t*)to;
 	uint8_t* _from = (uint8_t*)from;
@@ -292,7 +674,7 @@ static int _gorbn_get_ndigits(gorbn_t* a, int digit_count_alloc) {
 
 static int _gorbn_get_nbits(gorbn_t* a, int digit_count_alloc) {
 	int i;
-	int digit;
+	gorbn_t digit;
 
 	int num_digits = _gorbn_get_ndigits(a, digit_count_alloc);
 	if (num_digits == 0) {
@@ -309,7 +691,7 @@ static int _gorbn_get_nbits(gorbn_t* a, int digit_count_alloc) {
 
 static int _gorbn_testbit(gorbn_t* a, int bitnum) {
 
-	int Result = (a[bitnum / GORBN_SZWORD_BITS] & (1 << (bitnum % GORBN_SZWORD_BITS)));
+	int Result = ((a[bitnum / GORBN_SZWORD_BITS] >> (bitnum % GORBN_SZWORD_BITS)) & 1);
 
 	return(Result);
 }
@@ -387,8 +769,11 @@ void gorbn_from_uint(gorbn_t* n, gorbn_utmp_t i){
 	n[0] = i;
 	n[1] = i >> 16;
 #elif (GORBN_SZWORD == 4)
-	n->number[0] = i;
-	n->number[1] = i >> 32;
+	n[0] = i;
+	n[1] = i >> 32;
+#elif (GORBN_SZWORD == 8)
+	n[0] = (gorbn_t)i;
+	n[1] = (gorbn_t)(i >> 64);
 #endif
 }
 
@@ -409,6 +794,9 @@ void gorbn_from_int(gorbn_t* n, gorbn_stmp_t i){
 #elif (GORBN_SZWORD == 4)
 	n[0] = i;
 	n[1] = i >> 32;
+#elif (GORBN_SZWORD == 8)
+	n[0] = (gorbn_t)i;
+	n[1] = (gorbn_t)(i >> 64);
 #endif
 }
 
@@ -493,7 +881,7 @@ void gorbn_lshift_words(gorbn_t* a, int nwords) {
 void gorbn_rshift_words(gorbn_t* a, int nwords) {
 	int i;
 	if (nwords > 0) {
-		for (i = 0; i < nwords; i++) {
+		for (i = 0; i < GORBN_SZARR - nwords; i++) {
 			a[i] = a[i + nwords];
 		}
 
@@ -503,6 +891,41 @@ void gorbn_rshift_words(gorbn_t* a, int nwords) {
 	}
 }
 
+/* r = a when flag = 1, r unchanged when flag = 0. No branches on flag */
+static void _gorbn_cmov(gorbn_t* r, gorbn_t* a, int flag) {
+	gorbn_t mask = (gorbn_t)(0 - (gorbn_t)flag);
+	int i;
+
+	for (i = 0; i < GORBN_SZARR; i++) {
+		r[i] ^= (r[i] ^ a[i]) & mask;
+	}
+}
+
+/* 1 when a == b, 0 otherwise. Does not exit early */
+static int _gorbn_ct_is_equal(gorbn_t* a, gorbn_t* b) {
+	gorbn_utmp_t acc = 0;
+	int i;
+
+	for (i = 0; i < GORBN_SZARR; i++) {
+		acc |= (gorbn_t)(a[i] ^ b[i]);
+	}
+
+	return((int)(((acc - 1) >> GORBN_SZWORD_BITS) & 1));
+}
+
+/* Swapping a and b when swap = 1. No branches on swap */
+void gorbn_cswap(gorbn_t* a, gorbn_t* b, int swap) {
+	gorbn_t mask = (gorbn_t)(0 - (gorbn_t)swap);
+	gorbn_t t;
+	int i;
+
+	for (i = 0; i < GORBN_SZARR; i++) {
+		t = (a[i] ^ b[i]) & mask;
+		a[i] ^= t;
+		b[i] ^= t;
+	}
+}
+
 //NOTE(dima): Computes r = a + b, returning carry.
 int gorbn_add(gorbn_t* r, gorbn_t* a, gorbn_t* b) {
 	int i;
@@ -510,7 +933,7 @@ int gorbn_add(gorbn_t* r, gorbn_t* a, gorbn_t* b) {
 
 	for (i = 0; i < GORBN_SZARR; i++) {
 #if 1
-		gorbn_utmp_t sum = a[i] + b[i] + carry;
+		gorbn_utmp_t sum = (gorbn_utmp_t)a[i] + b[i] + carry;
 		carry = (sum > GORBN_MAX_VAL);
 		r[i] = (sum & GORBN_MAX_VAL);
 #else
@@ -562,16 +985,17 @@ void gorbn_mul_word(gorbn_t* r, gorbn_t* a, gorbn_t w) {
 	r[GORBN_SZARR] = c;
 }
 
+/*
+	NOTE(dima): mul and sqr always run over all GORBN_SZARR digits so that
+	their timing does not depend on leading zero digits of the operands
+*/
 void gorbn_mul(gorbn_t* r, gorbn_t* a, gorbn_t* b) {
 	int i, j;
-	int a_ndigits;
-	int b_ndigits;
+	int a_ndigits = GORBN_SZARR;
+	int b_ndigits = GORBN_SZARR;
 
 	_gorbn_zero_number(r, GORBN_SZARR * 2);
 
-	a_ndigits = _gorbn_get_ndigits(a, GORBN_SZARR);
-	b_ndigits = _gorbn_get_ndigits(b, GORBN_SZARR);
-
 	for (i = 0; i < b_ndigits; i++) {
 		gorbn_utmp_t uv;
 		gorbn_utmp_t c = 0;
@@ -591,19 +1015,16 @@ void gorbn_mul(gorbn_t* r, gorbn_t* a, gorbn_t* b) {
 
 void gorbn_sqr(gorbn_t* r, gorbn_t* a) {
 	int i, j;
-	int a_ndigits;
-	int b_ndigits;
+	int a_ndigits = GORBN_SZARR;
 
 	gorbn_utmp_t carry = 0;
 	gorbn_utmp_t carry1;
 
 	_gorbn_zero_number(r, GORBN_SZARR * 2);
 
-	a_ndigits = _gorbn_get_ndigits(a, GORBN_SZARR);
-
 	for (i = 0; i < a_ndigits; i++) {
 		for (j = i + 1; j < a_ndigits; j++) {
-			gorbn_utmp_t tmp_mul = a[i] * a[j];
+			gorbn_utmp_t tmp_mul = (gorbn_utmp_t)a[i] * a[j];
 			tmp_mul += carry;
 			tmp_mul += r[i + j];
 			r[i + j] = (gorbn_t)tmp_mul;
@@ -620,7 +1041,7 @@ void gorbn_sqr(gorbn_t* r, gorbn_t* a) {
 	}
 
 	for (i = 0; i < a_ndigits; i++) {
-		gorbn_utmp_t tmp_mul = a[i] * a[i];
+		gorbn_utmp_t tmp_mul = (gorbn_utmp_t)a[i] * a[i];
 		tmp_mul += carry;
 		tmp_mul += r[i + i];
 		r[i + i] = (gorbn_t)tmp_mul;
@@ -683,25 +1104,76 @@ void gorbn_mod_word(
 }
 
 
+static GORBN_THREAD_LOCAL gorbn_arena* _gorbn_thread_arena = 0;
+
+void gorbn_arena_init(gorbn_arena* arena, void* mem, size_t size) {
+	arena->mem = (uint8_t*)mem;
+	arena->size = size;
+	arena->used = 0;
+	arena->peak = 0;
+}
+
+void* gorbn_arena_push(gorbn_arena* arena, size_t size) {
+	void* result = 0;
+
+	//NOTE(dima): Aligning the address, not the offset, memory can come unaligned
+	size_t addr = (size_t)(arena->mem + arena->used);
+	size_t pad = (GORBN_ARENA_ALIGN - (addr & (GORBN_ARENA_ALIGN - 1))) & (GORBN_ARENA_ALIGN - 1);
+
+	if (pad <= arena->size - arena->used &&
+		size <= arena->size - arena->used - pad)
+	{
+		result = arena->mem + arena->used + pad;
+		arena->used += pad + size;
+
+		if (arena->used > arena->peak) {
+			arena->peak = arena->used;
+		}
+	}
+
+	return(result);
+}
+
+size_t gorbn_arena_mark(gorbn_arena* arena) {
+	return(arena->used);
+}
+
+void gorbn_arena_pop(gorbn_arena* arena, size_t mark) {
+	arena->used = mark;
+}
+
+void gorbn_arena_reset(gorbn_arena* arena) {
+	arena->used = 0;
+}
+
+gorbn_arena* gorbn_arena_bind(gorbn_arena* arena) {
+	gorbn_arena* result = _gorbn_thread_arena;
+	_gorbn_thread_arena = arena;
+
+	return(result);
+}
+
 /*
 	NOTE(Dima):
 		q - the quotient output param. Can be NULL.
 		r - the remainder output param. Can be NULL.
 		x - the divident input param.
 		y - the divisor input param.
+		scratch - GORBN_DIV_SCRATCH_DIGITS digits of temporary memory.
 */
-void gorbn_div(
+static void _gorbn_div_scratch(
 	gorbn_t* q,
 	gorbn_t* r,
 	gorbn_t* x, int x_digit_count_alloc,
-	gorbn_t* y, int y_digit_count_alloc)
+	gorbn_t* y, int y_digit_count_alloc,
+	gorbn_t* scratch)
 {
 	gorbn_utmp_t c_pred, r_pred;
 
-	gorbn_t a_norm[GORBN_SZARR * 4];
-	gorbn_t b_norm[GORBN_SZARR * 4];
-	gorbn_t q_buf[GORBN_SZARR * 2];
-	gorbn_t r_buf[GORBN_SZARR * 2];
+	gorbn_t* a_norm = scratch;
+	gorbn_t* b_norm = a_norm + GORBN_SZARR * 4;
+	gorbn_t* q_buf = b_norm + GORBN_SZARR * 4;
+	gorbn_t* r_buf = q_buf + GORBN_SZARR * 2;
 
 	gorbn_init(a_norm, GORBN_SZARR * 4);
 	gorbn_init(b_norm, GORBN_SZARR * 4);
@@ -718,10 +1190,12 @@ void gorbn_div(
 	int i, j;
 	gorbn_utmp_t mod_bn = (gorbn_utmp_t)GORBN_MAX_VAL + 1;
 	gorbn_utmp_t p = 0;
+	gorbn_utmp_t rem = 0;
 	gorbn_stmp_t carry = 0;
 	gorbn_stmp_t t;
 
-	int begin_cmp_res = gorbn_cmp(x, y);
+	//NOTE(dima): gorbn_cmp only sees GORBN_SZARR digits, a longer x is never equal
+	int begin_cmp_res = (a_ndig <= GORBN_SZARR) ? gorbn_cmp(x, y) : GORBN_CMP_LARGER;
 	if (begin_cmp_res == GORBN_CMP_EQUAL) {
 		//NOTE(DIMA): If divisor is equal to divident than return 1
 		q_buf[0] = 1;
@@ -730,17 +1204,34 @@ void gorbn_div(
 		//NOTE(DIMA): If divisor is small number (== 1 word)
 		
 		for (j = a_ndig - 1; j >= 0; j--) {
-			q_buf[j] = (gorbn_t)((carry * mod_bn + x[j]) / y[0]);
-			carry = (carry * mod_bn + x[j]) - q_buf[j] * y[0];
+			gorbn_utmp_t cur = (rem << GORBN_SZWORD_BITS) | x[j];
+			q_buf[j] = (gorbn_t)(cur / y[0]);
+			rem = cur % y[0];
 		}
 
-		r_buf[0] = (gorbn_t)carry;
+		r_buf[0] = (gorbn_t)rem;
 	}
 	else {
+		//NOTE(dima): Normalize so that the top bit of the divisor is set,
+		//            then the estimate below is corrected at most twice
+		int norm_val = 0;
+		while (norm_val < GORBN_SZWORD_BITS_MINUS_ONE &&
+			!((gorbn_t)(b_norm[b_ndig - 1] << norm_val) >> GORBN_SZWORD_BITS_MINUS_ONE))
+		{
+			norm_val++;
+		}
 
-		//int b_nbits = _gorbn_get_nbits(y, y_digit_count_alloc);
-		//int norm_val = (GORBN_SZWORD_BITS - b_nbits & GORBN_SZWORD_BITS_MINUS_ONE) & GORBN_SZWORD_BITS_MINUS_ONE;
-		//gorbn_mul_pow2(a_norm, x, norm_val);
+		if (norm_val) {
+			for (i = b_ndig - 1; i > 0; i--) {
+				b_norm[i] = (gorbn_t)((b_norm[i] << norm_val) | (b_norm[i - 1] >> (GORBN_SZWORD_BITS - norm_val)));
+			}
+			b_norm[0] = (gorbn_t)(b_norm[0] << norm_val);
+
+			for (i = a_ndig; i > 0; i--) {
+				a_norm[i] = (gorbn_t)((a_norm[i] << norm_val) | (a_norm[i - 1] >> (GORBN_SZWORD_BITS - norm_val)));
+			}
+			a_norm[0] = (gorbn_t)(a_norm[0] << norm_val);
+		}
 
 		for (j = a_ndig - b_ndig; j >= 0; j--) {
 			int j_plus_b_ndig = j + b_ndig;
@@ -781,7 +1272,7 @@ void gorbn_div(
 				q_buf[j]--;
 				carry = 0;
 				for (i = 0; i < b_ndig; i++) {
-					t = a_norm[i + j] + b_norm[i] + carry;
+					t = (gorbn_stmp_t)a_norm[i + j] + b_norm[i] + carry;
 					a_norm[i + j] = (gorbn_t)t;
 					carry = t >> GORBN_SZWORD_BITS;
 				}
@@ -793,7 +1284,11 @@ void gorbn_div(
 			int asdfg = 1;
 		}
 
-		gorbn_copy(r_buf, a_norm);
+		//NOTE(dima): The remainder is in the low b_ndig digits, shifted back
+		for (i = 0; i < b_ndig - 1; i++) {
+			r_buf[i] = (gorbn_t)((a_norm[i] >> norm_val) | (norm_val ? (a_norm[i + 1] << (GORBN_SZWORD_BITS - norm_val)) : 0));
+		}
+		r_buf[b_ndig - 1] = (gorbn_t)(a_norm[b_ndig - 1] >> norm_val);
 	}
 
 	if (q) {
@@ -805,6 +1300,52 @@ void gorbn_div(
 	}
 }
 
+//NOTE(dima): Kept out of line so that the buffer is not in gorbn_div frame
+static _GORBN_NOINLINE void _gorbn_div_stack(
+	gorbn_t* q,
+	gorbn_t* r,
+	gorbn_t* x, int x_digit_count_alloc,
+	gorbn_t* y, int y_digit_count_alloc)
+{
+	gorbn_t scratch[GORBN_DIV_SCRATCH_DIGITS];
+
+	_gorbn_div_scratch(q, r, x, x_digit_count_alloc, y, y_digit_count_alloc, scratch);
+}
+
+/*
+	NOTE(Dima):
+		q - the quotient output param. Can be NULL.
+		r - the remainder output param. Can be NULL.
+		x - the divident input param.
+		y - the divisor input param.
+
+		Temporaries come from the arena bound to the calling thread,
+		or from the C stack if there is none or it is full.
+*/
+void gorbn_div(
+	gorbn_t* q,
+	gorbn_t* r,
+	gorbn_t* x, int x_digit_count_alloc,
+	gorbn_t* y, int y_digit_count_alloc)
+{
+	gorbn_arena* arena = _gorbn_thread_arena;
+	gorbn_t* scratch = 0;
+	size_t mark = 0;
+
+	if (arena) {
+		mark = gorbn_arena_mark(arena);
+		scratch = (gorbn_t*)gorbn_arena_push(arena, sizeof(gorbn_t) * GORBN_DIV_SCRATCH_DIGITS);
+	}
+
+	if (scratch) {
+		_gorbn_div_scratch(q, r, x, x_digit_count_alloc, y, y_digit_count_alloc, scratch);
+		gorbn_arena_pop(arena, mark);
+	}
+	else {
+		_gorbn_div_stack(q, r, x, x_digit_count_alloc, y, y_digit_count_alloc);
+	}
+}
+
 #if 0
 void gorbn_div1420(
 	gorbn_t* q,
@@ -862,7 +1403,7 @@ void gorbn_mod_pow2(gorbn_t* r, gorbn_t* a, int k) {
 	}
 
 	for (j = 0; j < nbits_rest; j++) {
-		last_word_mask |= (1 << i);
+		last_word_mask |= ((gorbn_t)1 << j);
 	}
 	
 	r_buf[i] = a[i] & last_word_mask;
@@ -870,18 +1411,33 @@ void gorbn_mod_pow2(gorbn_t* r, gorbn_t* a, int k) {
 	gorbn_copy(r, r_buf);
 }
 
+/*
+	NOTE(dima): Modular add/sub do not branch on the values,
+	the reduced result is picked with a mask
+*/
 void gorbn_add_mod(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_t* m) {
+	gorbn_t t[GORBN_SZARR];
+
 	int carry = gorbn_add(r, a, b);
-	if (carry || gorbn_cmp(r, m) >= 0) {
-		gorbn_sub(r, r, m);
-	}
+	int borrow = gorbn_sub(t, r, m);
+
+	/* r = t when a + b >= m */
+	_gorbn_cmov(r, t, carry | (borrow ^ 1));
 }
 
 void gorbn_sub_mod(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_t* m) {
+	gorbn_t t[GORBN_SZARR];
+	gorbn_t mask;
+	int i;
+
 	int borrow = gorbn_sub(r, a, b);
-	if (borrow) {
-		gorbn_add(r, r, m);
+
+	/* r = r + m when a < b */
+	mask = (gorbn_t)(0 - (gorbn_t)borrow);
+	for (i = 0; i < GORBN_SZARR; i++) {
+		t[i] = m[i] & mask;
 	}
+	gorbn_add(r, r, t);
 }
 
 void gorbn_mul_mod(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_t* m) {
@@ -906,85 +1462,279 @@ void gorbn_sqr_mod(gorbn_t* r, gorbn_t* a, gorbn_t* m) {
 	gorbn_div(0, r, mul_res, GORBN_SZARR * 2, m, GORBN_SZARR);
 }
 
-/* Getting inverse by modulo*/
-void gorbn_inv_mod(gorbn_t* result, gorbn_t *a, gorbn_t* m) {
-	gorbn_t u[GORBN_SZARR]; 
-	gorbn_t v[GORBN_SZARR];
-	gorbn_t r[GORBN_SZARR];
-	gorbn_t s[GORBN_SZARR];
+/*
+	NOTE(dima): Modular inversion by Bernstein-Yang divsteps (safegcd), in the
+	half-delta form used by libsecp256k1. Numbers are kept in signed radix
+	2^_GORBN_DS_BITS with _GORBN_DS_BITS divsteps per outer step done on the
+	low words only, the whole numbers are then updated by the resulting 2x2
+	matrix. 590 divsteps are always enough for 256-bit odd moduli, so the outer
+	loop runs a fixed number of times and nothing branches on the values.
+	Without 128-bit integers the same code runs on 30-bit digits.
+*/
+#if defined(__SIZEOF_INT128__)
+#define _GORBN_DS_BITS 62
+#define _GORBN_DS_DIGITS 5
+#define _GORBN_DS_ROUNDS 10
+typedef long long _gorbn_ds_t;
+typedef unsigned long long _gorbn_ds_u;
+typedef __int128 _gorbn_ds_wide;
+#else
+#define _GORBN_DS_BITS 30
+#define _GORBN_DS_DIGITS 9
+#define _GORBN_DS_ROUNDS 20
+typedef int _gorbn_ds_t;
+typedef unsigned int _gorbn_ds_u;
+typedef long long _gorbn_ds_wide;
+#endif
 
-	gorbn_copy(u, m);
-	gorbn_copy(v, a);
-	gorbn_init(r, GORBN_SZARR);
-	gorbn_init(s, GORBN_SZARR);
-	s[0] = 1;
-
-	while (!gorbn_is_zero(v)) {
-		if (GORBN_EVEN(u)) {
-			if (GORBN_EVEN(r)) {
-				gorbn_rshift_one_bit(u);
-				gorbn_rshift_one_bit(r);
-			}
-			else {
-				gorbn_rshift_one_bit(u);
-				int carry = gorbn_add(r, r, m);
-				gorbn_rshift_one_bit(r);
-				if (carry) {
-					r[GORBN_SZARR - 1] |= GORBN_HIGH_BIT_SET;
-				}
-			}
-		}
-		else if (GORBN_EVEN(v)) {
-			if (GORBN_EVEN(s)) {
-				gorbn_rshift_one_bit(v);
-				gorbn_rshift_one_bit(s);
-			}
-			else {
-				gorbn_rshift_one_bit(v);
-				int carry = gorbn_add(s, s, m);
-				gorbn_rshift_one_bit(s);
-				if (carry) {
-					s[GORBN_SZARR - 1] |= GORBN_HIGH_BIT_SET;
-				}
+#define _GORBN_DS_MASK ((_gorbn_ds_t)(((_gorbn_ds_u)1 << _GORBN_DS_BITS) - 1))
+#define _GORBN_DS_SIGN(x) ((x) >> (sizeof(_gorbn_ds_t) * 8 - 1))
+
+typedef struct _gorbn_ds_matrix {
+	_gorbn_ds_t u, v, q, r;
+} _gorbn_ds_matrix;
+
+static void _gorbn_ds_from_bn(_gorbn_ds_t* r, gorbn_t* a) {
+	int i;
+
+	for (i = 0; i < _GORBN_DS_DIGITS; i++) {
+		_gorbn_ds_u digit = 0;
+		int pos = i * _GORBN_DS_BITS;
+		int got = 0;
+
+		while (got < _GORBN_DS_BITS && pos < GORBN_SZARR_BITS_TOTAL) {
+			int bit = pos & GORBN_SZWORD_BITS_MINUS_ONE;
+			int take = GORBN_SZWORD_BITS - bit;
+			if (take > _GORBN_DS_BITS - got) {
+				take = _GORBN_DS_BITS - got;
 			}
+
+			_gorbn_ds_u bits = (_gorbn_ds_u)(a[pos / GORBN_SZWORD_BITS] >> bit);
+			digit |= (bits & (((_gorbn_ds_u)1 << take) - 1)) << got;
+
+			got += take;
+			pos += take;
 		}
-		else {
-			if (gorbn_cmp(u, v) > 0) {
-				gorbn_sub(u, u, v);
-				int borrow = gorbn_sub(r, r, s);
-				if (borrow) {
-					gorbn_add(r, r, m);
-				}
-			}
-			else {
-				gorbn_sub(v, v, u);
-				int borrow = gorbn_sub(s, s, r);
-				if (borrow) {
-					gorbn_add(s, s, m);
-				}
+
+		r[i] = (_gorbn_ds_t)digit;
+	}
+}
+
+/* a must be normalized: all digits non-negative and below 2^256 in total */
+static void _gorbn_ds_to_bn(gorbn_t* r, _gorbn_ds_t* a) {
+	int i;
+
+	for (i = 0; i < GORBN_SZARR; i++) {
+		gorbn_t word = 0;
+		int pos = i * GORBN_SZWORD_BITS;
+		int got = 0;
+
+		while (got < GORBN_SZWORD_BITS) {
+			int bit = pos % _GORBN_DS_BITS;
+			int take = _GORBN_DS_BITS - bit;
+			if (take > GORBN_SZWORD_BITS - got) {
+				take = GORBN_SZWORD_BITS - got;
 			}
+
+			_gorbn_ds_u bits = (_gorbn_ds_u)a[pos / _GORBN_DS_BITS] >> bit;
+			word |= (gorbn_t)((gorbn_utmp_t)(bits & (((_gorbn_ds_u)1 << take) - 1)) << got);
+
+			got += take;
+			pos += take;
 		}
+
+		r[i] = word;
 	}
+}
+
+/*
+	_GORBN_DS_BITS divsteps on the low digits of f and g. Returns new zeta,
+	the matrix is such that t * [f, g] = 2^_GORBN_DS_BITS * [f', g']
+*/
+static _gorbn_ds_t _gorbn_ds_divsteps(_gorbn_ds_t zeta, _gorbn_ds_u f, _gorbn_ds_u g, _gorbn_ds_matrix* t) {
+	//NOTE(dima): Kept unsigned, so that shifts of negative values are defined
+	_gorbn_ds_u u = 1, v = 0, q = 0, r = 1;
+	int i;
 
-	if (gorbn_cmp(r, m) > 0) {
-		gorbn_sub(r, r, m);
+	for (i = 0; i < _GORBN_DS_BITS; i++) {
+		/* mask_neg: zeta < 0, mask_odd: g is odd */
+		_gorbn_ds_u mask_neg = (_gorbn_ds_u)_GORBN_DS_SIGN(zeta);
+		_gorbn_ds_u mask_odd = (_gorbn_ds_u)0 - (g & 1);
+
+		/* g += +-f, q += +-u, r += +-v when g is odd */
+		g += ((f ^ mask_neg) - mask_neg) & mask_odd;
+		q += ((u ^ mask_neg) - mask_neg) & mask_odd;
+		r += ((v ^ mask_neg) - mask_neg) & mask_odd;
+
+		/* Swap step: zeta -> -zeta - 2 and f += g only when both masks are set */
+		mask_neg &= mask_odd;
+		zeta = (zeta ^ (_gorbn_ds_t)mask_neg) - 1;
+		f += g & mask_neg;
+		u += q & mask_neg;
+		v += r & mask_neg;
+
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
 	}
 
-	gorbn_copy(result, r);
-}
+	t->u = (_gorbn_ds_t)u;
+	t->v = (_gorbn_ds_t)v;
+	t->q = (_gorbn_ds_t)q;
+	t->r = (_gorbn_ds_t)r;
 
-/* logical AND */
-void gorbn_and(gorbn_t* r, gorbn_t* a, gorbn_t* b, int digit_count)
-{
-	int walk_count = digit_count;
+	return(zeta);
+}
 
+/* [f, g] = t * [f, g] / 2^_GORBN_DS_BITS, the division is exact */
+static void _gorbn_ds_update_fg(_gorbn_ds_t* f, _gorbn_ds_t* g, _gorbn_ds_matrix* t) {
+	_gorbn_ds_wide cf = (_gorbn_ds_wide)t->u * f[0] + (_gorbn_ds_wide)t->v * g[0];
+	_gorbn_ds_wide cg = (_gorbn_ds_wide)t->q * f[0] + (_gorbn_ds_wide)t->r * g[0];
 	int i;
-	for (i = 0; i < walk_count; i++) {
-		r[i] = a[i] & b[i];
+
+	cf >>= _GORBN_DS_BITS;
+	cg >>= _GORBN_DS_BITS;
+
+	for (i = 1; i < _GORBN_DS_DIGITS; i++) {
+		cf += (_gorbn_ds_wide)t->u * f[i] + (_gorbn_ds_wide)t->v * g[i];
+		cg += (_gorbn_ds_wide)t->q * f[i] + (_gorbn_ds_wide)t->r * g[i];
+
+		f[i - 1] = (_gorbn_ds_t)cf & _GORBN_DS_MASK;
+		g[i - 1] = (_gorbn_ds_t)cg & _GORBN_DS_MASK;
+		cf >>= _GORBN_DS_BITS;
+		cg >>= _GORBN_DS_BITS;
 	}
+
+	f[_GORBN_DS_DIGITS - 1] = (_gorbn_ds_t)cf;
+	g[_GORBN_DS_DIGITS - 1] = (_gorbn_ds_t)cg;
 }
 
-/* logical OR */
+/*
+	[d, e] = (t * [d, e] + m * [md, me]) / 2^_GORBN_DS_BITS where md, me are
+	picked to make the division exact. Keeps d, e in range (-2m, m)
+*/
+static void _gorbn_ds_update_de(
+	_gorbn_ds_t* d, _gorbn_ds_t* e,
+	_gorbn_ds_matrix* t,
+	_gorbn_ds_t* m, _gorbn_ds_u m_inv)
+{
+	_gorbn_ds_t sd = _GORBN_DS_SIGN(d[_GORBN_DS_DIGITS - 1]);
+	_gorbn_ds_t se = _GORBN_DS_SIGN(e[_GORBN_DS_DIGITS - 1]);
+	_gorbn_ds_t md = (t->u & sd) + (t->v & se);
+	_gorbn_ds_t me = (t->q & sd) + (t->r & se);
+	int i;
+
+	_gorbn_ds_wide cd = (_gorbn_ds_wide)t->u * d[0] + (_gorbn_ds_wide)t->v * e[0];
+	_gorbn_ds_wide ce = (_gorbn_ds_wide)t->q * d[0] + (_gorbn_ds_wide)t->r * e[0];
+
+	md -= (_gorbn_ds_t)((m_inv * (_gorbn_ds_u)cd + (_gorbn_ds_u)md) & (_gorbn_ds_u)_GORBN_DS_MASK);
+	me -= (_gorbn_ds_t)((m_inv * (_gorbn_ds_u)ce + (_gorbn_ds_u)me) & (_gorbn_ds_u)_GORBN_DS_MASK);
+
+	cd += (_gorbn_ds_wide)m[0] * md;
+	ce += (_gorbn_ds_wide)m[0] * me;
+	cd >>= _GORBN_DS_BITS;
+	ce >>= _GORBN_DS_BITS;
+
+	for (i = 1; i < _GORBN_DS_DIGITS; i++) {
+		cd += (_gorbn_ds_wide)t->u * d[i] + (_gorbn_ds_wide)t->v * e[i] + (_gorbn_ds_wide)m[i] * md;
+		ce += (_gorbn_ds_wide)t->q * d[i] + (_gorbn_ds_wide)t->r * e[i] + (_gorbn_ds_wide)m[i] * me;
+
+		d[i - 1] = (_gorbn_ds_t)cd & _GORBN_DS_MASK;
+		e[i - 1] = (_gorbn_ds_t)ce & _GORBN_DS_MASK;
+		cd >>= _GORBN_DS_BITS;
+		ce >>= _GORBN_DS_BITS;
+	}
+
+	d[_GORBN_DS_DIGITS - 1] = (_gorbn_ds_t)cd;
+	e[_GORBN_DS_DIGITS - 1] = (_gorbn_ds_t)ce;
+}
+
+static void _gorbn_ds_carry(_gorbn_ds_t* a) {
+	int i;
+
+	for (i = 0; i < _GORBN_DS_DIGITS - 1; i++) {
+		a[i + 1] += a[i] >> _GORBN_DS_BITS;
+		a[i] &= _GORBN_DS_MASK;
+	}
+}
+
+/* d = d * sign(f) mod m, from range (-2m, m) to [0, m) */
+static void _gorbn_ds_normalize(_gorbn_ds_t* d, _gorbn_ds_t f_top, _gorbn_ds_t* m) {
+	_gorbn_ds_t add = _GORBN_DS_SIGN(d[_GORBN_DS_DIGITS - 1]);
+	_gorbn_ds_t neg = _GORBN_DS_SIGN(f_top);
+	int i;
+
+	for (i = 0; i < _GORBN_DS_DIGITS; i++) {
+		d[i] += m[i] & add;
+		d[i] = (d[i] ^ neg) - neg;
+	}
+	_gorbn_ds_carry(d);
+
+	add = _GORBN_DS_SIGN(d[_GORBN_DS_DIGITS - 1]);
+	for (i = 0; i < _GORBN_DS_DIGITS; i++) {
+		d[i] += m[i] & add;
+	}
+	_gorbn_ds_carry(d);
+}
+
+/*
+	Getting inverse by modulo. m must be odd and coprime with a, a must be
+	below 2 * m. Gives 0 for a = 0. Constant time
+*/
+void gorbn_inv_mod(gorbn_t* result, gorbn_t *a, gorbn_t* m) {
+	_gorbn_ds_t f[_GORBN_DS_DIGITS];
+	_gorbn_ds_t g[_GORBN_DS_DIGITS];
+	_gorbn_ds_t d[_GORBN_DS_DIGITS];
+	_gorbn_ds_t e[_GORBN_DS_DIGITS];
+	_gorbn_ds_t md[_GORBN_DS_DIGITS];
+	gorbn_t a_red[GORBN_SZARR];
+	_gorbn_ds_matrix t;
+	_gorbn_ds_t zeta = -1;
+	int i;
+
+	//NOTE(dima): a - m when it does not borrow
+	int borrow = gorbn_sub(a_red, a, m);
+	_gorbn_cmov(a_red, a, borrow);
+
+	_gorbn_ds_from_bn(md, m);
+	_gorbn_ds_from_bn(f, m);
+	_gorbn_ds_from_bn(g, a_red);
+
+	for (i = 0; i < _GORBN_DS_DIGITS; i++) {
+		d[i] = 0;
+		e[i] = 0;
+	}
+	e[0] = 1;
+
+	/* m ^ -1 mod 2 ^ _GORBN_DS_BITS by Newton iteration, each step doubles correct bits */
+	_gorbn_ds_u m_inv = (_gorbn_ds_u)md[0];
+	for (i = 0; i < 5; i++) {
+		m_inv *= 2 - (_gorbn_ds_u)md[0] * m_inv;
+	}
+
+	for (i = 0; i < _GORBN_DS_ROUNDS; i++) {
+		zeta = _gorbn_ds_divsteps(zeta, (_gorbn_ds_u)f[0], (_gorbn_ds_u)g[0], &t);
+		_gorbn_ds_update_de(d, e, &t, md, m_inv);
+		_gorbn_ds_update_fg(f, g, &t);
+	}
+
+	//NOTE(dima): Now g = 0 and f = +-gcd(a, m), d = a ^ -1 * f
+	_gorbn_ds_normalize(d, f[_GORBN_DS_DIGITS - 1], md);
+	_gorbn_ds_to_bn(result, d);
+}
+
+/* logical AND */
+void gorbn_and(gorbn_t* r, gorbn_t* a, gorbn_t* b, int digit_count)
+{
+	int walk_count = digit_count;
+
+	int i;
+	for (i = 0; i < walk_count; i++) {
+		r[i] = a[i] & b[i];
+	}
+}
+
+/* logical OR */
 void gorbn_or(gorbn_t* r, gorbn_t* a, gorbn_t* b, int digit_count) {
 	int walk_count = digit_count;
 
@@ -1013,6 +1763,9 @@ void gorbn_lshift(gorbn_t* r, gorbn_t* a, int nbits) {
 	int bit_offset = nbits & GORBN_SZWORD_BITS_MINUS_ONE;
 
 	gorbn_lshift_words(r, words_count);
+	if (bit_offset == 0) {
+		return;
+	}
 	for (i = (GORBN_SZARR - 1); i > 0; --i) {
 		r[i] = (r[i] << bit_offset) | (r[i - 1] >> (GORBN_SZWORD_BITS - bit_offset));
 	}
@@ -1028,6 +1781,9 @@ void gorbn_rshift(gorbn_t* r, gorbn_t* b, int nbits) {
 	int bit_offset = nbits & GORBN_SZWORD_BITS_MINUS_ONE;
 
 	gorbn_rshift_words(r, words_count);
+	if (bit_offset == 0) {
+		return;
+	}
 	for (i = 0; i < GORBN_SZARR - 1; i++) {
 		r[i] = (r[i] >> bit_offset) | (r[i + 1] << (GORBN_SZWORD_BITS - bit_offset));
 	}
@@ -1073,10 +1829,10 @@ int gorbn_cmp_word(
 		}
 	}
 
-	if (a[i] > w) {
+	if (a[0] > w) {
 		return(GORBN_CMP_LARGER);
 	}
-	else if (a[i] < w) {
+	else if (a[0] < w) {
 		return(GORBN_CMP_SMALLER);
 	}
 	else {
@@ -1084,612 +1840,2538 @@ int gorbn_cmp_word(
 	}
 }
 
-/* Loading standard belarussian parameters*/
-void gorec_load_stb128(gorec_curve* crv) {
-	unsigned char lwo_bign_std_curve128_p[32] = {
-		0x43, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-	};
+/*
+	NOTE(dima): Montgomery arithmetic.
 
-	unsigned char lwo_bign_std_curve128_a[32] = {
-		0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-	};
+	Numbers are kept in the form aR mod m, where R = 2 ^ GORBN_SZARR_BITS_TOTAL.
+	Multiplication is done with word-by-word (CIOS) reduction, so no
+	division is needed after the precomputation in gorbn_mont_init().
+*/
+void gorbn_mont_init(gorbn_mont_ctx* ctx, gorbn_t* m) {
+	int i;
+	gorbn_utmp_t inv;
 
-	unsigned char lwo_bign_std_curve128_b[32] = {
-		0xF1, 0x03, 0x9C, 0xD6, 0x6B, 0x7D, 0x2E, 0xB2,
-		0x53, 0x92, 0x8B, 0x97, 0x69, 0x50, 0xF5, 0x4C,
-		0xBE, 0xFB, 0xD8, 0xE4, 0xAB, 0x3A, 0xC1, 0xD2,
-		0xED, 0xA8, 0xF3, 0x15, 0x15, 0x6C, 0xCE, 0x77,
-	};
+	gorbn_copy(ctx->m, m);
 
-	unsigned char lwo_bign_std_curve128_q[32] = {
-		0x07, 0x66, 0x3D, 0x26, 0x99, 0xBF, 0x5A, 0x7E,
-		0xFC, 0x4D, 0xFB, 0x0D, 0xD6, 0x8E, 0x5C, 0xD9,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-	};
+	/*NOTE(dima): Newton iteration for m^-1 mod 2^w. Each step doubles correct bits count*/
+	inv = 1;
+	for (i = 0; i < 7; i++) {
+		inv = (inv * (2 - (gorbn_utmp_t)m[0] * inv)) & GORBN_MAX_VAL;
+	}
+	ctx->m_inv = (gorbn_t)((0 - inv) & GORBN_MAX_VAL);
 
-	unsigned char lwo_bign_std_curve128_yG[32] = {
-		0x93, 0x6A, 0x51, 0x04, 0x18, 0xCF, 0x29, 0x1E,
-		0x52, 0xF6, 0x08, 0xC4, 0x66, 0x39, 0x91, 0x78,
-		0x5D, 0x83, 0xD6, 0x51, 0xA3, 0xC9, 0xE4, 0x5C,
-		0x9F, 0xD6, 0x16, 0xFB, 0x3C, 0xFC, 0xF7, 0x6B,
-	};
+	/*NOTE(dima): R mod m and R^2 mod m by repeated doubling of 1*/
+	gorbn_init(ctx->one, GORBN_SZARR);
+	ctx->one[0] = 1;
+	for (i = 0; i < GORBN_SZARR_BITS_TOTAL; i++) {
+		gorbn_add_mod(ctx->one, ctx->one, ctx->one, m);
+	}
 
-	unsigned char lwo_bign_std_curve128_xG[32] = {
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	};
+	gorbn_copy(ctx->r2, ctx->one);
+	for (i = 0; i < GORBN_SZARR_BITS_TOTAL; i++) {
+		gorbn_add_mod(ctx->r2, ctx->r2, ctx->r2, m);
+	}
+}
 
-	gorbn_from_data(crv->a, (void*)lwo_bign_std_curve128_a, sizeof(lwo_bign_std_curve128_a));
-	gorbn_from_data(crv->b, (void*)lwo_bign_std_curve128_b, sizeof(lwo_bign_std_curve128_b));
-	gorbn_from_data(crv->p, (void*)lwo_bign_std_curve128_p, sizeof(lwo_bign_std_curve128_p));
-	gorbn_from_data(crv->q, (void*)lwo_bign_std_curve128_q, sizeof(lwo_bign_std_curve128_q));
+/* Final conditional subtraction: r = t mod m, where t < 2m and top_carry is t's extra word */
+static void _gorbn_mont_final_sub(gorbn_t* r, gorbn_t* t, gorbn_t top_carry, gorbn_mont_ctx* ctx) {
+	gorbn_t d[GORBN_SZARR];
+	int borrow = gorbn_sub(d, t, ctx->m);
 
-	gorbn_from_data(crv->g.x, (void*)lwo_bign_std_curve128_xG, sizeof(lwo_bign_std_curve128_xG));
-	gorbn_from_data(crv->g.y, (void*)lwo_bign_std_curve128_yG, sizeof(lwo_bign_std_curve128_yG));
-	gorbn_from_int(crv->g.z, 1);
-	crv->g.is_inf = 0;
+	/* r = t - m when t >= m, selected without branches */
+	gorbn_copy(r, t);
+	_gorbn_cmov(r, d, (top_carry != 0) | (borrow ^ 1));
 }
 
-/* point clearing */
-void gorec_pt_clear(gorec_point* p) {
-	gorbn_init(p->x, GORBN_SZARR);
-	gorbn_init(p->y, GORBN_SZARR);
-	gorbn_from_int(p->z, 1);
-	p->is_inf = 1;
-}
+void gorbn_mont_mul(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorbn_mont_ctx* ctx) {
+	gorbn_t t[GORBN_SZARR + 2];
+	gorbn_utmp_t uv;
+	gorbn_utmp_t c;
+	gorbn_t u;
+	int i, j;
 
-/* point copying */
-void gorec_pt_copy(gorec_point* r, gorec_point* p) {
-	gorbn_copy(r->x, p->x);
-	gorbn_copy(r->y, p->y);
-	gorbn_copy(r->z, p->z);
-	r->is_inf = p->is_inf;
-}
+	_gorbn_zero_number(t, GORBN_SZARR + 2);
 
-/* Point addition in affine coordinates */
-void gorec_pt_add(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv) {
-	if (a->is_inf) {
-		gorec_pt_copy(r, b);
-		return;
+	for (i = 0; i < GORBN_SZARR; i++) {
+		/* t = t + a * b[i] */
+		c = 0;
+		for (j = 0; j < GORBN_SZARR; j++) {
+			uv = (gorbn_utmp_t)t[j] + (gorbn_utmp_t)a[j] * (gorbn_utmp_t)b[i] + c;
+			t[j] = (gorbn_t)uv;
+			c = uv >> GORBN_SZWORD_BITS;
+		}
+		uv = (gorbn_utmp_t)t[GORBN_SZARR] + c;
+		t[GORBN_SZARR] = (gorbn_t)uv;
+		t[GORBN_SZARR + 1] = (gorbn_t)(uv >> GORBN_SZWORD_BITS);
+
+		/* t = (t + u * m) / 2^w */
+		u = (gorbn_t)(((gorbn_utmp_t)t[0] * ctx->m_inv) & GORBN_MAX_VAL);
+		uv = (gorbn_utmp_t)t[0] + (gorbn_utmp_t)u * (gorbn_utmp_t)ctx->m[0];
+		c = uv >> GORBN_SZWORD_BITS;
+		for (j = 1; j < GORBN_SZARR; j++) {
+			uv = (gorbn_utmp_t)t[j] + (gorbn_utmp_t)u * (gorbn_utmp_t)ctx->m[j] + c;
+			t[j - 1] = (gorbn_t)uv;
+			c = uv >> GORBN_SZWORD_BITS;
+		}
+		uv = (gorbn_utmp_t)t[GORBN_SZARR] + c;
+		t[GORBN_SZARR - 1] = (gorbn_t)uv;
+		t[GORBN_SZARR] = (gorbn_t)(t[GORBN_SZARR + 1] + (uv >> GORBN_SZWORD_BITS));
 	}
 
-	if (b->is_inf) {
-		gorec_pt_copy(r, a);
-		return;
-	}
+	_gorbn_mont_final_sub(r, t, t[GORBN_SZARR], ctx);
+}
 
-	gorbn_t lambda[GORBN_SZARR];
-	gorbn_t tmp[GORBN_SZARR];
+/* Montgomery reduction of double-width t: r = t * R^-1 mod m. t is destroyed */
+static void _gorbn_mont_redc(gorbn_t* r, gorbn_t* t, gorbn_mont_ctx* ctx) {
+	gorbn_utmp_t uv;
+	gorbn_utmp_t c;
+	gorbn_t u;
+	gorbn_t top_carry = 0;
+	int i, j;
 
-	gorbn_t res_x[GORBN_SZARR];
-	gorbn_t res_y[GORBN_SZARR];
+	for (i = 0; i < GORBN_SZARR; i++) {
+		u = (gorbn_t)(((gorbn_utmp_t)t[i] * ctx->m_inv) & GORBN_MAX_VAL);
 
-	gorbn_init(lambda, GORBN_SZARR);
-	gorbn_init(tmp, GORBN_SZARR);
+		c = 0;
+		for (j = 0; j < GORBN_SZARR; j++) {
+			uv = (gorbn_utmp_t)t[i + j] + (gorbn_utmp_t)u * (gorbn_utmp_t)ctx->m[j] + c;
+			t[i + j] = (gorbn_t)uv;
+			c = uv >> GORBN_SZWORD_BITS;
+		}
 
-	/*lambda = (y2 - y1)/(x2 - x1)*/
-	gorbn_sub_mod(lambda, b->y, a->y, crv->p);
-	gorbn_sub_mod(tmp, b->x, a->x, crv->p);
-	gorbn_inv_mod(tmp, tmp, crv->p);
-	gorbn_mul_mod(lambda, lambda, tmp, crv->p);
+		/* carry out of t[i + n] is delayed to the next step */
+		uv = (gorbn_utmp_t)t[i + GORBN_SZARR] + c + top_carry;
+		t[i + GORBN_SZARR] = (gorbn_t)uv;
+		top_carry = (gorbn_t)(uv >> GORBN_SZWORD_BITS);
+	}
 
-	/*x3 = lambda*lambda - x1 - x2*/
-	gorbn_sqr_mod(res_x, lambda, crv->p);
-	gorbn_sub_mod(res_x, res_x, a->x, crv->p);
-	gorbn_sub_mod(res_x, res_x, b->x, crv->p);
+	_gorbn_mont_final_sub(r, t + GORBN_SZARR, top_carry, ctx);
+}
 
-	/*y3 = lambda * (x1 - x3) - y1 */
-	gorbn_sub_mod(res_y, a->x, res_x, crv->p);
-	gorbn_mul_mod(res_y, lambda, res_y, crv->p);
-	gorbn_sub_mod(res_y, res_y, a->y, crv->p);
+void gorbn_mont_sqr(gorbn_t* r, gorbn_t* a, gorbn_mont_ctx* ctx) {
+	gorbn_t t[GORBN_SZARR * 2];
 
-	gorbn_copy(r->x, res_x);
-	gorbn_copy(r->y, res_y);
+	gorbn_sqr(t, a);
+	_gorbn_mont_redc(r, t, ctx);
 }
 
-/* Point doubling in affine coordinates */
-void gorec_pt_double(gorec_point* r, gorec_point* a, gorec_curve* crv) {
-	if (!a->is_inf) {
-		gorbn_t res_x[GORBN_SZARR];
-		gorbn_t res_y[GORBN_SZARR];
-		
-		gorbn_t lambda[GORBN_SZARR];
-		gorbn_t tmp[GORBN_SZARR];
+void gorbn_to_mont(gorbn_t* r, gorbn_t* a, gorbn_mont_ctx* ctx) {
+	gorbn_mont_mul(r, a, ctx->r2, ctx);
+}
 
-		gorbn_init(lambda, GORBN_SZARR);
-		gorbn_init(tmp, GORBN_SZARR);
+void gorbn_from_mont(gorbn_t* r, gorbn_t* a, gorbn_mont_ctx* ctx) {
+	gorbn_t t[GORBN_SZARR * 2];
 
-		/*lambda = (3x1x1 + a)/(2y1) */
-		gorbn_sqr_mod(lambda, a->x, crv->p);
-		tmp[0] = 3;
-		gorbn_mul_mod(lambda, lambda, tmp, crv->p);
-		gorbn_add_mod(lambda, lambda, crv->a, crv->p);
-		tmp[0] = 2;
-		gorbn_mul_mod(tmp, tmp, a->y, crv->p);
-		gorbn_inv_mod(tmp, tmp, crv->p);
-		gorbn_mul_mod(lambda, lambda, tmp, crv->p);
+	_gorbn_zero_number(t, GORBN_SZARR * 2);
+	gorbn_copy_internal(t, a, GORBN_SZARR);
+	_gorbn_mont_redc(r, t, ctx);
+}
 
-		/*x3 = lambda*lambda - x1 - x2*/
-		gorbn_sqr_mod(res_x, lambda, crv->p);
-		gorbn_sub_mod(res_x, res_x, a->x, crv->p);
-		gorbn_sub_mod(res_x, res_x, a->x, crv->p);
+/*
+	NOTE(dima): Reduction modulo pseudo-Mersenne (Crandall) prime m = B^n - c,
+	where B = 2 ^ GORBN_SZWORD_BITS and c < B. Since B^n = c (mod m) the high
+	half is multiplied by c and folded back into the low half.
 
-		/*y3 = lambda * (x1 - x3) - y1 */
-		gorbn_sub_mod(res_y, a->x, res_x, crv->p);
-		gorbn_mul_mod(res_y, lambda, res_y, crv->p);
-		gorbn_sub_mod(res_y, res_y, a->y, crv->p);
+	n is a parameter so the same code serves bign 128/192/256 levels
+	(p = 2^256 - 189, 2^384 - 317, 2^512 - 569).
+*/
+int gorbn_is_crand(gorbn_t* m, int n, gorbn_t* c) {
+	int i;
 
-		gorbn_copy(r->x, res_x);
-		gorbn_copy(r->y, res_y);
+	if (n < 2 || m[0] == 0) {
+		return(0);
 	}
+
+	for (i = 1; i < n; i++) {
+		if (m[i] != GORBN_MAX_VAL) {
+			return(0);
+		}
+	}
+
+	if (c) {
+		*c = (gorbn_t)(0 - m[0]);
+	}
+
+	return(1);
 }
 
-/* Point doubling in Jacobian coordinates */
-void gorec_pt_double_jacobian(gorec_point* r, gorec_point* a, gorec_curve* crv) {
-	gorbn_t S[GORBN_SZARR];
-	gorbn_t M[GORBN_SZARR];
-	gorbn_t TMP[GORBN_SZARR];
-	gorbn_t YSQ[GORBN_SZARR];
+void gorbn_red_crand(gorbn_t* r, gorbn_t* a, int n, gorbn_t c) {
+	gorbn_utmp_t uv;
+	gorbn_utmp_t carry;
+	int i;
+	int pass;
+
+	/* r = a_lo + c * a_hi, carry is the (n+1)-th word (<= c) */
+	carry = 0;
+	for (i = 0; i < n; i++) {
+		uv = (gorbn_utmp_t)a[n + i] * c + a[i] + carry;
+		r[i] = (gorbn_t)uv;
+		carry = uv >> GORBN_SZWORD_BITS;
+	}
 
-	gorec_point rp;
-	gorec_pt_clear(&rp);
+	/* r = r + c * carry. Runs twice: the second pass folds a possible wrap-around */
+	for (pass = 0; pass < 2; pass++) {
+		uv = carry * c + r[0];
+		r[0] = (gorbn_t)uv;
+		carry = uv >> GORBN_SZWORD_BITS;
+		for (i = 1; i < n; i++) {
+			uv = (gorbn_utmp_t)r[i] + carry;
+			r[i] = (gorbn_t)uv;
+			carry = uv >> GORBN_SZWORD_BITS;
+		}
+	}
 
-	if (a->is_inf) {
-		return;
+	/*
+		r < B^n <= 2m, so at most one subtraction of m. r - m = r + c - B^n,
+		so r >= m exactly when r + c carries out. Picked with a mask.
+	*/
+	gorbn_t mask;
+
+	uv = (gorbn_utmp_t)r[0] + c;
+	carry = uv >> GORBN_SZWORD_BITS;
+	for (i = 1; i < n; i++) {
+		uv = (gorbn_utmp_t)r[i] + carry;
+		carry = uv >> GORBN_SZWORD_BITS;
 	}
 
-	// S = 4*X*Y^2
-	gorbn_sqr_mod(YSQ, a->y, crv->p);
-	gorbn_mul_mod(S, a->x, YSQ, crv->p);
-	gorbn_mulword_mod(S, S, 4, crv->p);
+	mask = (gorbn_t)(0 - (gorbn_t)carry);
+	uv = (gorbn_utmp_t)r[0] + (c & mask);
+	r[0] = (gorbn_t)uv;
+	carry = uv >> GORBN_SZWORD_BITS;
+	for (i = 1; i < n; i++) {
+		uv = (gorbn_utmp_t)r[i] + carry;
+		r[i] = (gorbn_t)uv;
+		carry = uv >> GORBN_SZWORD_BITS;
+	}
+}
 
-	// M = 3*X^2 + a*Z^4
-	gorbn_sqr_mod(M, a->x, crv->p);
-	gorbn_mulword_mod(M, M, 3, crv->p);
-	gorbn_sqr_mod(TMP, a->z, crv->p);
-	gorbn_sqr_mod(TMP, TMP, crv->p);
-	gorbn_mul_mod(TMP, TMP, crv->a, crv->p);
-	gorbn_add_mod(M, M, TMP, crv->p);
+/*
+	4-way field layer. Value of lane j is sum(l[i][j] * 2^(26 * i)), i < 10.
+	2^256 = c (mod p), so 2^260 = 16 * c: carries out of the top limb and
+	the upper half of products are folded back with one multiplication.
+
+	Outputs of add, sub and mul have limbs below 2^26 (limb 1 may be a bit
+	over), inputs of mul must have limbs below 2^27. Then the 10 products of
+	a column sum up to less than 2^58 and every value that is multiplied
+	fits 32 bits, which is what _mm256_mul_epu32 takes.
+*/
+#define _GOREC_X4_MASK (((uint64_t)1 << GOREC_X4_LIMB_BITS) - 1)
 
-	// X' = M^2 - 2*S
-	gorbn_sqr_mod(rp.x, M, crv->p);
-	gorbn_mulword_mod(TMP, S, 2, crv->p);
-	gorbn_sub_mod(rp.x, rp.x, TMP, crv->p);
+static void _gorec_x4_prepare(gorec_x4_ctx* ctx, gorec_curve* crv) {
+	int i;
 
-	// Y' = M*(S - X') - 8 * Y ^ 4
-	gorbn_sub_mod(rp.y, S, rp.x, crv->p);
-	gorbn_mul_mod(rp.y, M, rp.y, crv->p);
-	gorbn_sqr_mod(TMP, YSQ, crv->p);
-	gorbn_mulword_mod(TMP, TMP, 8, crv->p);
-	gorbn_sub_mod(rp.y, rp.y, TMP, crv->p);
-	
-	// Z' = 2*Y*Z
-	gorbn_mul_mod(rp.z, a->y, a->z, crv->p);
-	gorbn_mulword_mod(rp.z, rp.z, 2, crv->p);
+	ctx->enabled = (crv->field_kind == GOREC_FIELD_CRAND &&
+		GORBN_SZARR_BITS_TOTAL == 256 &&
+		(uint64_t)crv->crand_c < ((uint64_t)1 << 16));
 
-	rp.is_inf = 0;
-	gorec_pt_copy(r, &rp);
+	ctx->fold = (uint64_t)crv->crand_c << 4;
+
+	gorec_fe_x4 p;
+	gorec_fe_x4_load(&p, 0, crv->p);
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		ctx->p32[i] = p.l[i][0] << 5;
+	}
 }
 
-/*Point addition in Jacobian projective coordinates*/
-void gorec_pt_add_jacobian(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv){
-	gorbn_t U1[GORBN_SZARR];
-	gorbn_t U2[GORBN_SZARR];
-	gorbn_t S1[GORBN_SZARR];
-	gorbn_t S2[GORBN_SZARR];
-	gorbn_t TMP[GORBN_SZARR];
-	gorbn_t H[GORBN_SZARR];
-	gorbn_t R[GORBN_SZARR];
+void gorec_fe_x4_load(gorec_fe_x4* r, int lane, gorbn_t* a) {
+	int i, j;
 
-	if (a->is_inf) {
-		gorec_pt_copy(r, b);
-		return;
-	}
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		uint64_t limb = 0;
+
+		for (j = 0; j < GOREC_X4_LIMB_BITS; j++) {
+			int bit = i * GOREC_X4_LIMB_BITS + j;
+
+			if (bit < GORBN_SZARR_BITS_TOTAL) {
+				limb |= (uint64_t)_gorbn_testbit(a, bit) << j;
+			}
+		}
+
+		r->l[i][lane] = limb;
+	}
+}
+
+void gorec_fe_x4_store(gorbn_t* r, gorec_fe_x4* a, int lane, gorec_curve* crv) {
+	uint64_t t[GOREC_X4_LIMBS];
+	uint64_t c = (uint64_t)crv->crand_c;
+	int i, pass;
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		t[i] = a->l[i][lane];
+	}
+
+	//NOTE(dima): Canonical limbs first, then bits from 256 up are folded as c * 2^-256
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < GOREC_X4_LIMBS - 1; i++) {
+			t[i + 1] += t[i] >> GOREC_X4_LIMB_BITS;
+			t[i] &= _GOREC_X4_MASK;
+		}
+		t[0] += (t[GOREC_X4_LIMBS - 1] >> 22) * c;
+		t[GOREC_X4_LIMBS - 1] &= ((uint64_t)1 << 22) - 1;
+	}
+	for (i = 0; i < GOREC_X4_LIMBS - 1; i++) {
+		t[i + 1] += t[i] >> GOREC_X4_LIMB_BITS;
+		t[i] &= _GOREC_X4_MASK;
+	}
+
+	gorbn_init(r, GORBN_SZARR);
+	for (i = 0; i < GORBN_SZARR_BITS_TOTAL; i++) {
+		gorbn_t bit = (gorbn_t)((t[i / GOREC_X4_LIMB_BITS] >> (i % GOREC_X4_LIMB_BITS)) & 1);
+		r[i / GORBN_SZWORD_BITS] |= (gorbn_t)(bit << (i % GORBN_SZWORD_BITS));
+	}
+
+	//NOTE(dima): Now r < 2^256 < 2p
+	gorbn_t rp[GORBN_SZARR];
+	int borrow = gorbn_sub(rp, r, crv->p);
+	_gorbn_cmov(r, rp, !borrow);
+}
+
+static void _gorec_x4_carry_generic(uint64_t* t, uint64_t fold) {
+	int i;
+
+	for (i = 0; i < GOREC_X4_LIMBS - 1; i++) {
+		t[i + 1] += t[i] >> GOREC_X4_LIMB_BITS;
+		t[i] &= _GOREC_X4_MASK;
+	}
+
+	uint64_t top = t[GOREC_X4_LIMBS - 1] >> GOREC_X4_LIMB_BITS;
+	t[GOREC_X4_LIMBS - 1] &= _GOREC_X4_MASK;
+	t[0] += top * fold;
+	t[1] += t[0] >> GOREC_X4_LIMB_BITS;
+	t[0] &= _GOREC_X4_MASK;
+}
+
+static void _gorec_fe_x4_add_generic(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx) {
+	uint64_t t[GOREC_X4_LIMBS];
+	int i, lane;
+
+	for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			t[i] = a->l[i][lane] + b->l[i][lane];
+		}
+
+		_gorec_x4_carry_generic(t, ctx->fold);
+
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			r->l[i][lane] = t[i];
+		}
+	}
+}
+
+static void _gorec_fe_x4_sub_generic(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx) {
+	uint64_t t[GOREC_X4_LIMBS];
+	int i, lane;
+
+	for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+		//NOTE(dima): a + 32p - b, no limb goes below zero
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			t[i] = a->l[i][lane] + ctx->p32[i] - b->l[i][lane];
+		}
+
+		_gorec_x4_carry_generic(t, ctx->fold);
+
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			r->l[i][lane] = t[i];
+		}
+	}
+}
+
+static void _gorec_fe_x4_mul_generic(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx) {
+	uint64_t t[GOREC_X4_LIMBS * 2];
+	int i, j, lane;
+
+	for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+		for (i = 0; i < GOREC_X4_LIMBS * 2; i++) {
+			t[i] = 0;
+		}
+
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			for (j = 0; j < GOREC_X4_LIMBS; j++) {
+				t[i + j] += a->l[i][lane] * b->l[j][lane];
+			}
+		}
+
+		//NOTE(dima): Upper half to 26-bit limbs, t[19] < 2^29 as t[18] is a single product
+		for (i = GOREC_X4_LIMBS - 1; i < GOREC_X4_LIMBS * 2 - 2; i++) {
+			t[i + 1] += t[i] >> GOREC_X4_LIMB_BITS;
+			t[i] &= _GOREC_X4_MASK;
+		}
+		t[GOREC_X4_LIMBS * 2 - 1] = t[GOREC_X4_LIMBS * 2 - 2] >> GOREC_X4_LIMB_BITS;
+		t[GOREC_X4_LIMBS * 2 - 2] &= _GOREC_X4_MASK;
+
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			t[i] += t[i + GOREC_X4_LIMBS] * ctx->fold;
+		}
+
+		_gorec_x4_carry_generic(t, ctx->fold);
+
+		for (i = 0; i < GOREC_X4_LIMBS; i++) {
+			r->l[i][lane] = t[i];
+		}
+	}
+}
+
+#ifdef _GOREC_X4_AVX2
+/*
+	Same as the generic versions, every __m256i holds one limb of all lanes.
+*/
+#define _GOREC_X4_LOAD(ptr) _mm256_loadu_si256((__m256i*)(ptr))
+#define _GOREC_X4_STORE(ptr, v) _mm256_storeu_si256((__m256i*)(ptr), v)
+
+static _GOREC_TARGET_AVX2 void _gorec_x4_carry_avx2(__m256i* t, __m256i fold) {
+	__m256i mask = _mm256_set1_epi64x((long long)_GOREC_X4_MASK);
+	int i;
+
+	for (i = 0; i < GOREC_X4_LIMBS - 1; i++) {
+		t[i + 1] = _mm256_add_epi64(t[i + 1], _mm256_srli_epi64(t[i], GOREC_X4_LIMB_BITS));
+		t[i] = _mm256_and_si256(t[i], mask);
+	}
+
+	__m256i top = _mm256_srli_epi64(t[GOREC_X4_LIMBS - 1], GOREC_X4_LIMB_BITS);
+	t[GOREC_X4_LIMBS - 1] = _mm256_and_si256(t[GOREC_X4_LIMBS - 1], mask);
+	t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(top, fold));
+	t[1] = _mm256_add_epi64(t[1], _mm256_srli_epi64(t[0], GOREC_X4_LIMB_BITS));
+	t[0] = _mm256_and_si256(t[0], mask);
+}
+
+static _GOREC_TARGET_AVX2 void _gorec_fe_x4_add_avx2(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx) {
+	__m256i t[GOREC_X4_LIMBS];
+	int i;
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		t[i] = _mm256_add_epi64(_GOREC_X4_LOAD(a->l[i]), _GOREC_X4_LOAD(b->l[i]));
+	}
+
+	_gorec_x4_carry_avx2(t, _mm256_set1_epi64x((long long)ctx->fold));
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		_GOREC_X4_STORE(r->l[i], t[i]);
+	}
+}
+
+static _GOREC_TARGET_AVX2 void _gorec_fe_x4_sub_avx2(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx) {
+	__m256i t[GOREC_X4_LIMBS];
+	int i;
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		t[i] = _mm256_add_epi64(_GOREC_X4_LOAD(a->l[i]), _mm256_set1_epi64x((long long)ctx->p32[i]));
+		t[i] = _mm256_sub_epi64(t[i], _GOREC_X4_LOAD(b->l[i]));
+	}
+
+	_gorec_x4_carry_avx2(t, _mm256_set1_epi64x((long long)ctx->fold));
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		_GOREC_X4_STORE(r->l[i], t[i]);
+	}
+}
+
+static _GOREC_TARGET_AVX2 void _gorec_fe_x4_mul_avx2(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx) {
+	__m256i A[GOREC_X4_LIMBS];
+	__m256i B[GOREC_X4_LIMBS];
+	__m256i t[GOREC_X4_LIMBS * 2];
+	__m256i mask = _mm256_set1_epi64x((long long)_GOREC_X4_MASK);
+	__m256i fold = _mm256_set1_epi64x((long long)ctx->fold);
+	int i, j;
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		A[i] = _GOREC_X4_LOAD(a->l[i]);
+		B[i] = _GOREC_X4_LOAD(b->l[i]);
+	}
+
+	for (i = 0; i < GOREC_X4_LIMBS * 2; i++) {
+		t[i] = _mm256_setzero_si256();
+	}
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		for (j = 0; j < GOREC_X4_LIMBS; j++) {
+			t[i + j] = _mm256_add_epi64(t[i + j], _mm256_mul_epu32(A[i], B[j]));
+		}
+	}
+
+	for (i = GOREC_X4_LIMBS - 1; i < GOREC_X4_LIMBS * 2 - 2; i++) {
+		t[i + 1] = _mm256_add_epi64(t[i + 1], _mm256_srli_epi64(t[i], GOREC_X4_LIMB_BITS));
+		t[i] = _mm256_and_si256(t[i], mask);
+	}
+	t[GOREC_X4_LIMBS * 2 - 1] = _mm256_srli_epi64(t[GOREC_X4_LIMBS * 2 - 2], GOREC_X4_LIMB_BITS);
+	t[GOREC_X4_LIMBS * 2 - 2] = _mm256_and_si256(t[GOREC_X4_LIMBS * 2 - 2], mask);
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		t[i] = _mm256_add_epi64(t[i], _mm256_mul_epu32(t[i + GOREC_X4_LIMBS], fold));
+	}
+
+	_gorec_x4_carry_avx2(t, fold);
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		_GOREC_X4_STORE(r->l[i], t[i]);
+	}
+}
+
+static int _gorec_x4_cpu_has_avx2(void) {
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return(0);
+	}
+
+	//NOTE(dima): OS must save YMM registers (OSXSAVE and XCR0 bits 1, 2)
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) {
+		return(0);
+	}
+
+	__cpuidex(info, 7, 0);
+	return((info[1] & (1 << 5)) != 0);
+#else
+	__builtin_cpu_init();
+	return(__builtin_cpu_supports("avx2") != 0);
+#endif
+}
+#endif
+
+#define GOREC_FE_X4_OP(name) void name(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_x4_ctx* ctx)
+typedef GOREC_FE_X4_OP(gorec_fe_x4_op_type);
+
+typedef struct _gorec_x4_funcs {
+	int simd;
+	gorec_fe_x4_op_type* add;
+	gorec_fe_x4_op_type* sub;
+	gorec_fe_x4_op_type* mul;
+} _gorec_x4_funcs;
+
+static _gorec_x4_funcs _gorec_x4_generic = {
+	GOREC_X4_SIMD_NONE,
+	_gorec_fe_x4_add_generic,
+	_gorec_fe_x4_sub_generic,
+	_gorec_fe_x4_mul_generic,
+};
+
+#ifdef _GOREC_X4_AVX2
+static _gorec_x4_funcs _gorec_x4_avx2 = {
+	GOREC_X4_SIMD_AVX2,
+	_gorec_fe_x4_add_avx2,
+	_gorec_fe_x4_sub_avx2,
+	_gorec_fe_x4_mul_avx2,
+};
+#endif
+
+/*
+	NOTE(dima): Picked on first use. Threads racing here all write the same
+	pointer, so there is no need for a lock.
+*/
+static _gorec_x4_funcs* volatile _gorec_x4_funcs_picked = 0;
+
+static _gorec_x4_funcs* _gorec_x4_get_funcs(void) {
+	_gorec_x4_funcs* result = _gorec_x4_funcs_picked;
+
+	if (!result) {
+		result = &_gorec_x4_generic;
+#ifdef _GOREC_X4_AVX2
+		if (_gorec_x4_cpu_has_avx2()) {
+			result = &_gorec_x4_avx2;
+		}
+#endif
+		_gorec_x4_funcs_picked = result;
+	}
+
+	return(result);
+}
+
+int gorec_x4_simd(void) {
+	return(_gorec_x4_get_funcs()->simd);
+}
+
+void gorec_fe_x4_add(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_curve* crv) {
+	_gorec_x4_get_funcs()->add(r, a, b, &crv->x4);
+}
+
+void gorec_fe_x4_sub(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_curve* crv) {
+	_gorec_x4_get_funcs()->sub(r, a, b, &crv->x4);
+}
+
+void gorec_fe_x4_mul(gorec_fe_x4* r, gorec_fe_x4* a, gorec_fe_x4* b, gorec_curve* crv) {
+	_gorec_x4_get_funcs()->mul(r, a, b, &crv->x4);
+}
+
+/* Loading standard belarussian parameters*/
+void gorec_load_stb128(gorec_curve* crv) {
+	unsigned char lwo_bign_std_curve128_p[32] = {
+		0x43, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	};
+
+	unsigned char lwo_bign_std_curve128_a[32] = {
+		0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	};
+
+	unsigned char lwo_bign_std_curve128_b[32] = {
+		0xF1, 0x03, 0x9C, 0xD6, 0x6B, 0x7D, 0x2E, 0xB2,
+		0x53, 0x92, 0x8B, 0x97, 0x69, 0x50, 0xF5, 0x4C,
+		0xBE, 0xFB, 0xD8, 0xE4, 0xAB, 0x3A, 0xC1, 0xD2,
+		0xED, 0xA8, 0xF3, 0x15, 0x15, 0x6C, 0xCE, 0x77,
+	};
+
+	unsigned char lwo_bign_std_curve128_q[32] = {
+		0x07, 0x66, 0x3D, 0x26, 0x99, 0xBF, 0x5A, 0x7E,
+		0xFC, 0x4D, 0xFB, 0x0D, 0xD6, 0x8E, 0x5C, 0xD9,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	};
+
+	unsigned char lwo_bign_std_curve128_yG[32] = {
+		0x93, 0x6A, 0x51, 0x04, 0x18, 0xCF, 0x29, 0x1E,
+		0x52, 0xF6, 0x08, 0xC4, 0x66, 0x39, 0x91, 0x78,
+		0x5D, 0x83, 0xD6, 0x51, 0xA3, 0xC9, 0xE4, 0x5C,
+		0x9F, 0xD6, 0x16, 0xFB, 0x3C, 0xFC, 0xF7, 0x6B,
+	};
+
+	unsigned char lwo_bign_std_curve128_xG[32] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+
+	gorbn_from_data(crv->a, (void*)lwo_bign_std_curve128_a, sizeof(lwo_bign_std_curve128_a));
+	gorbn_from_data(crv->b, (void*)lwo_bign_std_curve128_b, sizeof(lwo_bign_std_curve128_b));
+	gorbn_from_data(crv->p, (void*)lwo_bign_std_curve128_p, sizeof(lwo_bign_std_curve128_p));
+	gorbn_from_data(crv->q, (void*)lwo_bign_std_curve128_q, sizeof(lwo_bign_std_curve128_q));
+
+	gorbn_from_data(crv->g.x, (void*)lwo_bign_std_curve128_xG, sizeof(lwo_bign_std_curve128_xG));
+	gorbn_from_data(crv->g.y, (void*)lwo_bign_std_curve128_yG, sizeof(lwo_bign_std_curve128_yG));
+	gorbn_from_int(crv->g.z, 1);
+	crv->g.is_inf = 0;
+
+	gorec_curve_prepare(crv);
+}
+
+/* Precomputing per-curve constants used by the point arithmetic */
+void gorec_curve_prepare(gorec_curve* crv) {
+	gorbn_mont_init(&crv->mont, crv->p);
+
+	//NOTE(dima): Pseudo-Mersenne p is reduced directly, no need for Montgomery form
+	if (gorbn_is_crand(crv->p, GORBN_SZARR, &crv->crand_c)) {
+		crv->field_kind = GOREC_FIELD_CRAND;
+		gorbn_copy(crv->a_repr, crv->a);
+	}
+	else {
+		crv->field_kind = GOREC_FIELD_MONT;
+		crv->crand_c = 0;
+		gorbn_to_mont(crv->a_repr, crv->a, &crv->mont);
+	}
+
+	//NOTE(dima): A = -3 allows cheaper doubling (bign curves are all like that)
+	gorbn_t minus3[GORBN_SZARR];
+	gorbn_from_int(minus3, 3);
+	gorbn_sub(minus3, crv->p, minus3);
+	crv->a_is_minus3 = (gorbn_cmp(crv->a, minus3) == GORBN_CMP_EQUAL);
+	crv->pt_double = crv->a_is_minus3 ? gorec_pt_double_jacobian_a3 : gorec_pt_double_jacobian;
+
+	_gorec_x4_prepare(&crv->x4, crv);
+}
+
+/* point clearing */
+void gorec_pt_clear(gorec_point* p) {
+	gorbn_init(p->x, GORBN_SZARR);
+	gorbn_init(p->y, GORBN_SZARR);
+	gorbn_from_int(p->z, 1);
+	p->is_inf = 1;
+}
+
+/* point copying */
+void gorec_pt_copy(gorec_point* r, gorec_point* p) {
+	gorbn_copy(r->x, p->x);
+	gorbn_copy(r->y, p->y);
+	gorbn_copy(r->z, p->z);
+	r->is_inf = p->is_inf;
+}
+
+/* Point addition in affine coordinates */
+void gorec_pt_add(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv) {
+	if (a->is_inf) {
+		gorec_pt_copy(r, b);
+		return;
+	}
 
 	if (b->is_inf) {
 		gorec_pt_copy(r, a);
 		return;
 	}
 
-	// U1 = X1*Z2^2
-	// U2 = X2*Z1^2
-	// S1 = Y1*Z2^3
-	// S2 = Y2*Z1^3
-	gorbn_sqr_mod(TMP, b->z, crv->p);
-	gorbn_mul_mod(U1, a->x, TMP, crv->p);
-	gorbn_mul_mod(S1, TMP, a->y, crv->p);
-	gorbn_mul_mod(S1, S1, b->z, crv->p);
-	gorbn_sqr_mod(TMP, a->z, crv->p);
-	gorbn_mul_mod(U2, TMP, b->x, crv->p);
-	gorbn_mul_mod(S2, TMP, b->y, crv->p);
-	gorbn_mul_mod(S2, S2, a->z, crv->p);
+	gorbn_t lambda[GORBN_SZARR];
+	gorbn_t tmp[GORBN_SZARR];
+
+	gorbn_t res_x[GORBN_SZARR];
+	gorbn_t res_y[GORBN_SZARR];
+
+	gorbn_init(lambda, GORBN_SZARR);
+	gorbn_init(tmp, GORBN_SZARR);
+
+	/*lambda = (y2 - y1)/(x2 - x1)*/
+	gorbn_sub_mod(lambda, b->y, a->y, crv->p);
+	gorbn_sub_mod(tmp, b->x, a->x, crv->p);
+	gorbn_inv_mod(tmp, tmp, crv->p);
+	gorbn_mul_mod(lambda, lambda, tmp, crv->p);
+
+	/*x3 = lambda*lambda - x1 - x2*/
+	gorbn_sqr_mod(res_x, lambda, crv->p);
+	gorbn_sub_mod(res_x, res_x, a->x, crv->p);
+	gorbn_sub_mod(res_x, res_x, b->x, crv->p);
+
+	/*y3 = lambda * (x1 - x3) - y1 */
+	gorbn_sub_mod(res_y, a->x, res_x, crv->p);
+	gorbn_mul_mod(res_y, lambda, res_y, crv->p);
+	gorbn_sub_mod(res_y, res_y, a->y, crv->p);
+
+	gorbn_copy(r->x, res_x);
+	gorbn_copy(r->y, res_y);
+}
+
+/* Point doubling in affine coordinates */
+void gorec_pt_double(gorec_point* r, gorec_point* a, gorec_curve* crv) {
+	if (!a->is_inf) {
+		gorbn_t res_x[GORBN_SZARR];
+		gorbn_t res_y[GORBN_SZARR];
+		
+		gorbn_t lambda[GORBN_SZARR];
+		gorbn_t tmp[GORBN_SZARR];
+
+		gorbn_init(lambda, GORBN_SZARR);
+		gorbn_init(tmp, GORBN_SZARR);
+
+		/*lambda = (3x1x1 + a)/(2y1) */
+		gorbn_sqr_mod(lambda, a->x, crv->p);
+		tmp[0] = 3;
+		gorbn_mul_mod(lambda, lambda, tmp, crv->p);
+		gorbn_add_mod(lambda, lambda, crv->a, crv->p);
+		tmp[0] = 2;
+		gorbn_mul_mod(tmp, tmp, a->y, crv->p);
+		gorbn_inv_mod(tmp, tmp, crv->p);
+		gorbn_mul_mod(lambda, lambda, tmp, crv->p);
+
+		/*x3 = lambda*lambda - x1 - x2*/
+		gorbn_sqr_mod(res_x, lambda, crv->p);
+		gorbn_sub_mod(res_x, res_x, a->x, crv->p);
+		gorbn_sub_mod(res_x, res_x, a->x, crv->p);
+
+		/*y3 = lambda * (x1 - x3) - y1 */
+		gorbn_sub_mod(res_y, a->x, res_x, crv->p);
+		gorbn_mul_mod(res_y, lambda, res_y, crv->p);
+		gorbn_sub_mod(res_y, res_y, a->y, crv->p);
+
+		gorbn_copy(r->x, res_x);
+		gorbn_copy(r->y, res_y);
+	}
+}
+
+/*
+	NOTE(dima): Field operations for the Jacobian point arithmetic.
+
+	Coordinates are kept in the internal representation for the whole
+	scalar multiplication: Montgomery form for general p, or normal form
+	with fast folding reduction when p is pseudo-Mersenne (GOREC_FIELD_CRAND).
+	Conversion is done only once when entering and leaving the main loop.
+	Addition and subtraction are the same in both representations, so
+	gorbn_add_mod/gorbn_sub_mod are used.
+*/
+static inline void _gorec_fe_mul(gorbn_t* r, gorbn_t* a, gorbn_t* b, gorec_curve* crv) {
+	if (crv->field_kind == GOREC_FIELD_CRAND) {
+		gorbn_t t[GORBN_SZARR * 2];
+		gorbn_mul(t, a, b);
+		gorbn_red_crand(r, t, GORBN_SZARR, crv->crand_c);
+	}
+	else {
+		gorbn_mont_mul(r, a, b, &crv->mont);
+	}
+}
+
+static inline void _gorec_fe_sqr(gorbn_t* r, gorbn_t* a, gorec_curve* crv) {
+	if (crv->field_kind == GOREC_FIELD_CRAND) {
+		gorbn_t t[GORBN_SZARR * 2];
+		gorbn_sqr(t, a);
+		gorbn_red_crand(r, t, GORBN_SZARR, crv->crand_c);
+	}
+	else {
+		gorbn_mont_sqr(r, a, &crv->mont);
+	}
+}
+
+static void _gorec_pt_enter(gorec_point* r, gorec_point* p, gorec_curve* crv) {
+	gorec_pt_copy(r, p);
+	if (!p->is_inf && crv->field_kind == GOREC_FIELD_MONT) {
+		gorbn_to_mont(r->x, p->x, &crv->mont);
+		gorbn_to_mont(r->y, p->y, &crv->mont);
+		gorbn_to_mont(r->z, p->z, &crv->mont);
+	}
+}
+
+static void _gorec_pt_leave(gorec_point* r, gorec_point* p, gorec_curve* crv) {
+	gorec_pt_copy(r, p);
+	if (!p->is_inf && crv->field_kind == GOREC_FIELD_MONT) {
+		gorbn_from_mont(r->x, p->x, &crv->mont);
+		gorbn_from_mont(r->y, p->y, &crv->mont);
+		gorbn_from_mont(r->z, p->z, &crv->mont);
+	}
+}
+
+/* Point doubling in Jacobian coordinates. Coordinates are in the internal representation */
+void gorec_pt_double_jacobian(gorec_point* r, gorec_point* a, gorec_curve* crv) {
+	gorbn_t S[GORBN_SZARR];
+	gorbn_t M[GORBN_SZARR];
+	gorbn_t TMP[GORBN_SZARR];
+	gorbn_t YSQ[GORBN_SZARR];
+
+	gorec_point rp;
+
+	if (a->is_inf) {
+		gorec_pt_copy(r, a);
+		return;
+	}
+
+	// S = 4*X*Y^2
+	_gorec_fe_sqr(YSQ, a->y, crv);
+	_gorec_fe_mul(S, a->x, YSQ, crv);
+	gorbn_add_mod(S, S, S, crv->p);
+	gorbn_add_mod(S, S, S, crv->p);
+
+	// M = 3*X^2 + a*Z^4
+	_gorec_fe_sqr(M, a->x, crv);
+	gorbn_add_mod(TMP, M, M, crv->p);
+	gorbn_add_mod(M, M, TMP, crv->p);
+	_gorec_fe_sqr(TMP, a->z, crv);
+	_gorec_fe_sqr(TMP, TMP, crv);
+	_gorec_fe_mul(TMP, TMP, crv->a_repr, crv);
+	gorbn_add_mod(M, M, TMP, crv->p);
+
+	// X' = M^2 - 2*S
+	_gorec_fe_sqr(rp.x, M, crv);
+	gorbn_add_mod(TMP, S, S, crv->p);
+	gorbn_sub_mod(rp.x, rp.x, TMP, crv->p);
+
+	// Y' = M*(S - X') - 8 * Y ^ 4
+	gorbn_sub_mod(rp.y, S, rp.x, crv->p);
+	_gorec_fe_mul(rp.y, M, rp.y, crv);
+	_gorec_fe_sqr(TMP, YSQ, crv);
+	gorbn_add_mod(TMP, TMP, TMP, crv->p);
+	gorbn_add_mod(TMP, TMP, TMP, crv->p);
+	gorbn_add_mod(TMP, TMP, TMP, crv->p);
+	gorbn_sub_mod(rp.y, rp.y, TMP, crv->p);
+	
+	// Z' = 2*Y*Z
+	_gorec_fe_mul(rp.z, a->y, a->z, crv);
+	gorbn_add_mod(rp.z, rp.z, rp.z, crv->p);
+
+	rp.is_inf = 0;
+	gorec_pt_copy(r, &rp);
+}
+
+/*
+	Point doubling in Jacobian coordinates for curves with A = -3.
+	M = 3*X^2 - 3*Z^4 = 3*(X - Z^2)*(X + Z^2) saves two squarings.
+*/
+void gorec_pt_double_jacobian_a3(gorec_point* r, gorec_point* a, gorec_curve* crv) {
+	gorbn_t S[GORBN_SZARR];
+	gorbn_t M[GORBN_SZARR];
+	gorbn_t TMP[GORBN_SZARR];
+	gorbn_t YSQ[GORBN_SZARR];
+
+	gorec_point rp;
+
+	if (a->is_inf) {
+		gorec_pt_copy(r, a);
+		return;
+	}
+
+	// S = 4*X*Y^2
+	_gorec_fe_sqr(YSQ, a->y, crv);
+	_gorec_fe_mul(S, a->x, YSQ, crv);
+	gorbn_add_mod(S, S, S, crv->p);
+	gorbn_add_mod(S, S, S, crv->p);
+
+	// M = 3*(X - Z^2)*(X + Z^2)
+	_gorec_fe_sqr(TMP, a->z, crv);
+	gorbn_sub_mod(M, a->x, TMP, crv->p);
+	gorbn_add_mod(TMP, a->x, TMP, crv->p);
+	_gorec_fe_mul(M, M, TMP, crv);
+	gorbn_add_mod(TMP, M, M, crv->p);
+	gorbn_add_mod(M, M, TMP, crv->p);
+
+	// X' = M^2 - 2*S
+	_gorec_fe_sqr(rp.x, M, crv);
+	gorbn_add_mod(TMP, S, S, crv->p);
+	gorbn_sub_mod(rp.x, rp.x, TMP, crv->p);
+
+	// Y' = M*(S - X') - 8 * Y ^ 4
+	gorbn_sub_mod(rp.y, S, rp.x, crv->p);
+	_gorec_fe_mul(rp.y, M, rp.y, crv);
+	_gorec_fe_sqr(TMP, YSQ, crv);
+	gorbn_add_mod(TMP, TMP, TMP, crv->p);
+	gorbn_add_mod(TMP, TMP, TMP, crv->p);
+	gorbn_add_mod(TMP, TMP, TMP, crv->p);
+	gorbn_sub_mod(rp.y, rp.y, TMP, crv->p);
+
+	// Z' = 2*Y*Z
+	_gorec_fe_mul(rp.z, a->y, a->z, crv);
+	gorbn_add_mod(rp.z, rp.z, rp.z, crv->p);
+
+	rp.is_inf = 0;
+	gorec_pt_copy(r, &rp);
+}
+
+/*
+	Common tail of Jacobian additions, r->z must be already set.
+	H = U2 - U1
+	R = S2 - S1
+	X3 = R^2 - H^3 - 2*U1*H^2
+	Y3 = R*(U1*H^2 - X3) - S1*H^3
+*/
+static void _gorec_pt_add_finish(
+	gorec_point* r,
+	gorbn_t* U1, gorbn_t* S1, gorbn_t* S2,
+	gorbn_t* H,
+	gorec_curve* crv)
+{
+	gorbn_t R[GORBN_SZARR];
+	gorbn_t HH[GORBN_SZARR];
+	gorbn_t HHH[GORBN_SZARR];
+	gorbn_t V[GORBN_SZARR];
+
+	gorbn_sub_mod(R, S2, S1, crv->p);
+
+	_gorec_fe_sqr(HH, H, crv);
+	_gorec_fe_mul(HHH, HH, H, crv);
+	_gorec_fe_mul(V, HH, U1, crv);
+
+	_gorec_fe_sqr(r->x, R, crv);
+	gorbn_sub_mod(r->x, r->x, HHH, crv->p);
+	gorbn_sub_mod(r->x, r->x, V, crv->p);
+	gorbn_sub_mod(r->x, r->x, V, crv->p);
+
+	gorbn_sub_mod(V, V, r->x, crv->p);
+	_gorec_fe_mul(V, V, R, crv);
+	_gorec_fe_mul(HHH, HHH, S1, crv);
+	gorbn_sub_mod(r->y, V, HHH, crv->p);
+
+	r->is_inf = 0;
+}
+
+/*Point addition in Jacobian projective coordinates. Coordinates are in the internal representation*/
+void gorec_pt_add_jacobian(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv){
+	gorbn_t U1[GORBN_SZARR];
+	gorbn_t U2[GORBN_SZARR];
+	gorbn_t S1[GORBN_SZARR];
+	gorbn_t S2[GORBN_SZARR];
+	gorbn_t TMP[GORBN_SZARR];
+	gorbn_t H[GORBN_SZARR];
+
+	if (a->is_inf) {
+		gorec_pt_copy(r, b);
+		return;
+	}
+
+	if (b->is_inf) {
+		gorec_pt_copy(r, a);
+		return;
+	}
+
+	// U1 = X1*Z2^2
+	// U2 = X2*Z1^2
+	// S1 = Y1*Z2^3
+	// S2 = Y2*Z1^3
+	_gorec_fe_sqr(TMP, b->z, crv);
+	_gorec_fe_mul(U1, a->x, TMP, crv);
+	_gorec_fe_mul(S1, TMP, a->y, crv);
+	_gorec_fe_mul(S1, S1, b->z, crv);
+	_gorec_fe_sqr(TMP, a->z, crv);
+	_gorec_fe_mul(U2, TMP, b->x, crv);
+	_gorec_fe_mul(S2, TMP, b->y, crv);
+	_gorec_fe_mul(S2, S2, a->z, crv);
+
+	if (gorbn_cmp(U1, U2) == GORBN_CMP_EQUAL) {
+		if (gorbn_cmp(S1, S2) != GORBN_CMP_EQUAL) {
+			//NOTE(dima): Return POINT_AT_INFINITY
+			gorec_pt_clear(r);
+			return;
+		}
+		else {
+			//NOTE(dima):
+			return crv->pt_double(r, a, crv);
+		}
+	}
+
+	// Z3 = H*Z1*Z2, computed first because r may alias a or b
+	gorbn_sub_mod(H, U2, U1, crv->p);
+	_gorec_fe_mul(TMP, a->z, b->z, crv);
+	_gorec_fe_mul(r->z, TMP, H, crv);
+
+	_gorec_pt_add_finish(r, U1, S1, S2, H, crv);
+}
+
+/*
+	Mixed point addition: a in Jacobian coordinates, b affine (Z2 = 1).
+	U1 = X1, S1 = Y1, Z3 = H*Z1. Coordinates are in the internal representation.
+*/
+void gorec_pt_add_mixed(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv) {
+	gorbn_t U2[GORBN_SZARR];
+	gorbn_t S2[GORBN_SZARR];
+	gorbn_t TMP[GORBN_SZARR];
+	gorbn_t H[GORBN_SZARR];
+
+	if (a->is_inf) {
+		gorec_pt_copy(r, b);
+		return;
+	}
+
+	if (b->is_inf) {
+		gorec_pt_copy(r, a);
+		return;
+	}
+
+	// U2 = X2*Z1^2
+	// S2 = Y2*Z1^3
+	_gorec_fe_sqr(TMP, a->z, crv);
+	_gorec_fe_mul(U2, TMP, b->x, crv);
+	_gorec_fe_mul(S2, TMP, b->y, crv);
+	_gorec_fe_mul(S2, S2, a->z, crv);
+
+	if (gorbn_cmp(a->x, U2) == GORBN_CMP_EQUAL) {
+		if (gorbn_cmp(a->y, S2) != GORBN_CMP_EQUAL) {
+			//NOTE(dima): Return POINT_AT_INFINITY
+			gorec_pt_clear(r);
+			return;
+		}
+		else {
+			return crv->pt_double(r, a, crv);
+		}
+	}
+
+	gorec_point rp;
+
+	// Z3 = H*Z1
+	gorbn_sub_mod(H, U2, a->x, crv->p);
+	_gorec_fe_mul(rp.z, a->z, H, crv);
+
+	_gorec_pt_add_finish(&rp, a->x, a->y, S2, H, crv);
+	gorec_pt_copy(r, &rp);
+}
+
+/*Point subtraction in Jacobian projective coordinates*/
+void gorec_pt_sub_jacobian(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv) {
+	gorbn_t SaveY[GORBN_SZARR];
+
+	//NOTE(dima): Save b->y for later reassigning
+	gorbn_copy(SaveY, b->y);
+
+	//NOTE(dima): 0 - b->y
+	gorbn_init(b->y, GORBN_SZARR);
+
+	gorbn_sub_mod(b->y, b->y, SaveY, crv->p);
+
+	//NOTE(dima): Adding initial A and negated B
+	gorec_pt_add_jacobian(r, a, b, crv);
+
+	//NOTE(dima): Returning old saved b->y value
+	gorbn_copy(b->y, SaveY);
+}
+
+/*
+	Mixed point subtraction, b affine. b is negated in a local copy and never
+	written, so it can point into a table shared between threads.
+*/
+void gorec_pt_sub_mixed(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv) {
+	gorec_point neg;
+
+	gorec_pt_copy(&neg, b);
+
+	//NOTE(dima): 0 - b->y
+	gorbn_init(neg.y, GORBN_SZARR);
+	gorbn_sub_mod(neg.y, neg.y, b->y, crv->p);
+
+	gorec_pt_add_mixed(r, a, &neg, crv);
+}
+
+/* r = a ^ -1 in the internal field representation */
+static void _gorec_fe_inv(gorbn_t* r, gorbn_t* a, gorec_curve* crv) {
+	gorbn_inv_mod(r, a, crv->p);
+
+	if (crv->field_kind == GOREC_FIELD_MONT) {
+		//NOTE(dima): (a * R) ^ -1 = a ^ -1 * R ^ -1, two multiplications by R ^ 2 give a ^ -1 * R
+		gorbn_mont_mul(r, r, crv->mont.r2, &crv->mont);
+		gorbn_mont_mul(r, r, crv->mont.r2, &crv->mont);
+	}
+}
+
+/*
+	Converting Jacobian points (X, Y, Z) to affine (X / Z^2, Y / Z^3, 1).
+	Coordinates are in the internal representation.
+
+	Montgomery's simultaneous inversion trick is used: one inversion
+	of the product of all Z's and 3(n-1) multiplications to recover every
+	single Z ^ -1. Prefix products live on the stack, so points are
+	processed in chunks of GOREC_NORMALIZE_BATCH_CHUNK.
+*/
+static void _gorec_pt_to_affine_batch(gorec_point* points, int n, gorec_curve* crv) {
+	gorbn_t prefix[GOREC_NORMALIZE_BATCH_CHUNK][GORBN_SZARR];
+	int indices[GOREC_NORMALIZE_BATCH_CHUNK];
+
+	gorbn_t inv[GORBN_SZARR];
+	gorbn_t zinv[GORBN_SZARR];
+	gorbn_t zinv2[GORBN_SZARR];
+
+	int ChunkStart;
+	int i;
+
+	for (ChunkStart = 0; ChunkStart < n; ChunkStart += GOREC_NORMALIZE_BATCH_CHUNK) {
+		int ChunkEnd = GORBN_MIN(ChunkStart + GOREC_NORMALIZE_BATCH_CHUNK, n);
+		int count = 0;
+
+		//NOTE(dima): prefix[j] = Z_0 * Z_1 * ... * Z_j, points at infinity are skipped
+		for (i = ChunkStart; i < ChunkEnd; i++) {
+			if (points[i].is_inf) {
+				continue;
+			}
+
+			if (count == 0) {
+				gorbn_copy(prefix[0], points[i].z);
+			}
+			else {
+				_gorec_fe_mul(prefix[count], prefix[count - 1], points[i].z, crv);
+			}
+			indices[count++] = i;
+		}
+
+		if (count == 0) {
+			continue;
+		}
+
+		_gorec_fe_inv(inv, prefix[count - 1], crv);
+
+		for (i = count - 1; i >= 0; i--) {
+			gorec_point* pt = &points[indices[i]];
+
+			if (i > 0) {
+				_gorec_fe_mul(zinv, inv, prefix[i - 1], crv);
+				_gorec_fe_mul(inv, inv, pt->z, crv);
+			}
+			else {
+				gorbn_copy(zinv, inv);
+			}
+
+			_gorec_fe_sqr(zinv2, zinv, crv);
+			_gorec_fe_mul(pt->x, pt->x, zinv2, crv);
+			_gorec_fe_mul(zinv2, zinv2, zinv, crv);
+			_gorec_fe_mul(pt->y, pt->y, zinv2, crv);
+
+			if (crv->field_kind == GOREC_FIELD_MONT) {
+				gorbn_copy(pt->z, crv->mont.one);
+			}
+			else {
+				gorbn_from_int(pt->z, 1);
+			}
+		}
+	}
+}
+
+/*
+	Batch normalization of Jacobian points in the normal representation
+	to affine form with one field inversion per chunk
+*/
+void gorec_pt_normalize_batch(gorec_point* points, int n, gorec_curve* crv) {
+	int i;
+
+	for (i = 0; i < n; i++) {
+		_gorec_pt_enter(&points[i], &points[i], crv);
+	}
+
+	_gorec_pt_to_affine_batch(points, n, crv);
+
+	for (i = 0; i < n; i++) {
+		_gorec_pt_leave(&points[i], &points[i], crv);
+	}
+}
+
+//NOTE(dima): window width w should not be greater than 7 (<=7)
+
+static void gorec_compute_naf(char* NAF, int* NAFLength, gorbn_t k[GORBN_SZARR], int w) {
+	gorbn_t kk[GORBN_SZARR];
+	gorbn_t temp[GORBN_SZARR];
+	int i;
+
+	gorbn_copy(kk, k);
+	gorbn_init(temp, GORBN_SZARR);
+
+	int two_pow_w = 1 << w;
+	int half_pow_w = two_pow_w >> 1;
+
+	i = 0;
+	while (!gorbn_is_zero(kk)) {
+		int ExitOnTheEndOfIteration = 0;
+		if (gorbn_is_one(kk)) {
+			ExitOnTheEndOfIteration = 1;
+		}
+
+		if (!GORBN_EVEN(kk)) {
+			int word_mod_res = kk[0] & (two_pow_w - 1);
+
+			if (word_mod_res >= half_pow_w) {
+				NAF[i] = word_mod_res - two_pow_w;
+			}
+			else {
+				NAF[i] = word_mod_res;
+			}
+
+			if (NAF[i] > 0) {
+				gorbn_from_int(temp, NAF[i]);
+				int borrow = gorbn_sub(kk, kk, temp);
+
+				if (borrow) {
+					ExitOnTheEndOfIteration = 1;
+				}
+			}
+			else {
+				gorbn_from_int(temp, -NAF[i]);
+				gorbn_add(kk, kk, temp);
+
+				if (ExitOnTheEndOfIteration) {
+					ExitOnTheEndOfIteration = 0;
+				}
+			}
+		}
+		else {
+			NAF[i] = 0;
+		}
+
+		i++;
+		gorbn_rshift_one_bit(kk);
+
+		if (ExitOnTheEndOfIteration) {
+			break;
+		}
+	}
+
+	*NAFLength = i;
+}
+
+#define GOREC_WINDOW_W 4
+#define GOREC_PRECOMPUTE_ARRAYS_COUNT (1 << (GOREC_WINDOW_W - 2))
+
+/*
+	Precomputing odd multiples P, 3P, 5P, ... for wNAF in the internal
+	field representation
+*/
+static void _gorec_wnaf_precompute(
+	gorec_point PrecomputePoints[GOREC_PRECOMPUTE_ARRAYS_COUNT],
+	gorec_point* p_point,
+	gorec_curve* crv)
+{
+	int PrecomputeIndex;
+
+	gorec_point point;
+	gorec_point twice;
+
+	//NOTE(dima): Converting point to the internal field representation
+	_gorec_pt_enter(&point, p_point, crv);
+	gorec_pt_copy(&PrecomputePoints[0], &point);
+	crv->pt_double(&twice, &point, crv);
+
+	for (PrecomputeIndex = 1;
+		PrecomputeIndex < GOREC_PRECOMPUTE_ARRAYS_COUNT;
+		PrecomputeIndex++)
+	{
+		//NOTE(dima): Incrementing by 2P to save odd'ness
+		gorec_pt_add_jacobian(
+			&PrecomputePoints[PrecomputeIndex],
+			&PrecomputePoints[PrecomputeIndex - 1],
+			&twice, crv);
+	}
+}
+
+/*
+	wNAF multiplication without the exit from Jacobian coordinates.
+	Result stays in the internal field representation.
+*/
+static void _gorec_pt_mul_wnaf_internal(
+	gorec_point* p_result,
+	gorec_point *p_point,
+	gorbn_t *p_scalar,
+	gorec_curve* crv)
+{
+	int i;
+
+	//NOTE(dima): I think that this is the maximum possible size of this thing
+	char NAF[GORBN_SZARR_BITS_TOTAL + 1];
+	int NAFLength;
+
+	int w = GOREC_WINDOW_W;
+	gorec_point PrecomputePoints[GOREC_PRECOMPUTE_ARRAYS_COUNT];
+
+	gorec_point result;
+
+	//NOTE(dima): Step1 - Computing Non-Adjacent Form (NAF)
+	gorec_compute_naf(NAF, &NAFLength, p_scalar, w);
+
+	//NOTE(dima): Step2 - Precomputing points and making them affine
+	_gorec_wnaf_precompute(PrecomputePoints, p_point, crv);
+	_gorec_pt_to_affine_batch(PrecomputePoints, GOREC_PRECOMPUTE_ARRAYS_COUNT, crv);
+
+	gorec_pt_clear(&result);
+	//NOTE(dima): Step 3 - Compute result using precomputed values
+	for (i = NAFLength - 1; i >= 0; i--) {
+		crv->pt_double(&result, &result, crv);
+		if (NAF[i] != 0) {
+			if (NAF[i] > 0) {
+				gorec_pt_add_mixed(&result, &result, &PrecomputePoints[NAF[i] >> 1], crv);
+			}
+			else {
+				gorec_pt_sub_mixed(&result, &result, &PrecomputePoints[(-NAF[i]) >> 1], crv);
+			}
+		}
+	}
+
+	gorec_pt_copy(p_result, &result);
+}
+
+void gorec_pt_mul_wnaf_jacobian(
+	gorec_point* p_result,
+	gorec_point *p_point,
+	gorbn_t *p_scalar,
+	gorec_curve* crv) 
+{
+	gorec_point result;
+
+	_gorec_pt_mul_wnaf_internal(&result, p_point, p_scalar, crv);
+
+	//NOTE(dima): Exit from Jacobian coordinates
+	_gorec_pt_to_affine_batch(&result, 1, crv);
+	_gorec_pt_leave(&result, &result, crv);
+
+	gorec_pt_copy(p_result, &result);
+}
+
+/*
+	Simultaneous double-scalar multiplication r = k1 * P1 + k2 * P2
+	(Shamir/Straus trick). Both wNAFs are processed interleaved with
+	one shared doubling chain and one exit from Jacobian coordinates.
+	Used for signature verification (u1 * G + u2 * Q).
+*/
+void gorec_pt_mul_double(
+	gorec_point* p_result,
+	gorbn_t* k1, gorec_point* p1,
+	gorbn_t* k2, gorec_point* p2,
+	gorec_curve* crv)
+{
+	int i;
+
+	char NAF1[GORBN_SZARR_BITS_TOTAL + 1];
+	char NAF2[GORBN_SZARR_BITS_TOTAL + 1];
+	int NAFLength1;
+	int NAFLength2;
+
+	int w = GOREC_WINDOW_W;
+	gorec_point PrecomputePoints[2][GOREC_PRECOMPUTE_ARRAYS_COUNT];
+	gorec_point* PrecomputePoints1 = PrecomputePoints[0];
+	gorec_point* PrecomputePoints2 = PrecomputePoints[1];
+
+	gorec_point result;
+
+	gorec_compute_naf(NAF1, &NAFLength1, k1, w);
+	gorec_compute_naf(NAF2, &NAFLength2, k2, w);
+
+	_gorec_wnaf_precompute(PrecomputePoints1, p1, crv);
+	_gorec_wnaf_precompute(PrecomputePoints2, p2, crv);
+	_gorec_pt_to_affine_batch(&PrecomputePoints[0][0], 2 * GOREC_PRECOMPUTE_ARRAYS_COUNT, crv);
+
+	gorec_pt_clear(&result);
+	for (i = GORBN_MAX(NAFLength1, NAFLength2) - 1; i >= 0; i--) {
+		crv->pt_double(&result, &result, crv);
+
+		if (i < NAFLength1 && NAF1[i] != 0) {
+			if (NAF1[i] > 0) {
+				gorec_pt_add_mixed(&result, &result, &PrecomputePoints1[NAF1[i] >> 1], crv);
+			}
+			else {
+				gorec_pt_sub_mixed(&result, &result, &PrecomputePoints1[(-NAF1[i]) >> 1], crv);
+			}
+		}
+
+		if (i < NAFLength2 && NAF2[i] != 0) {
+			if (NAF2[i] > 0) {
+				gorec_pt_add_mixed(&result, &result, &PrecomputePoints2[NAF2[i] >> 1], crv);
+			}
+			else {
+				gorec_pt_sub_mixed(&result, &result, &PrecomputePoints2[(-NAF2[i]) >> 1], crv);
+			}
+		}
+	}
+
+	//NOTE(dima): Exit from Jacobian coordinates
+	_gorec_pt_to_affine_batch(&result, 1, crv);
+	_gorec_pt_leave(&result, &result, crv);
+
+	gorec_pt_copy(p_result, &result);
+}
+
+/*
+	Умножение точки эллиптической кривой на скаляр
+
+	p_result - указатель на результат - точку эллиптической кривой
+	p_point - указатель на точку, которую будем умножать
+	p_scalar - указатель на скалял, на который будем умножать p_point
+	crv - указатель на структуру с параметрами эллиптической кривой
+*/
+
+void gorec_pt_mul(
+	gorec_point* p_result,
+	gorec_point *p_point,
+	gorbn_t *p_scalar,
+	gorec_curve* crv)
+{
+	int i;
+	int t = _gorbn_get_nbits(p_scalar, GORBN_SZARR);
+
+	gorec_pt_clear(p_result);
+
+	for (i = t - 1; i >= 0; i--) {
+		gorec_pt_double(p_result, p_result, crv);
+
+		if (_gorbn_testbit(p_scalar, i)) {
+			gorec_pt_add(p_result, p_result, p_point, crv);
+		}
+	}
+}
+
+void gorec_pt_mul_jacobian(
+	gorec_point* r,
+	gorec_point* p,
+	gorbn_t* s,
+	gorec_curve* crv)
+{
+	int i;
+	int t = _gorbn_get_nbits(s, GORBN_SZARR);
+
+	gorec_point point;
+	gorec_point result;
+
+	//NOTE(dima): Affine input point allows mixed additions
+	gorec_pt_add_type* pt_add = gorbn_is_one(p->z) ? gorec_pt_add_mixed : gorec_pt_add_jacobian;
+
+	gorec_pt_clear(&result);
+	_gorec_pt_enter(&point, p, crv);
+
+	for (i = t - 1; i >= 0; i--) {
+		crv->pt_double(&result, &result, crv);
+
+		if (_gorbn_testbit(s, i)) {
+			pt_add(&result, &result, &point, crv);
+		}
+	}
+
+	//NOTE(dima): Exit from Jacobian coordinates
+	_gorec_pt_to_affine_batch(&result, 1, crv);
+	_gorec_pt_leave(&result, &result, crv);
+
+	gorec_pt_copy(r, &result);
+}
+
+/*
+	Building fixed-base table for generator crv->g.
+	Needs to be done once per curve (after gorec_curve_prepare()).
+*/
+void gorec_base_table_build(gorec_base_table* table, gorec_curve* crv) {
+	gorec_pt_table_build(table, &crv->g, crv);
+}
+
+/* Building fixed-base table for any affine point p, used by gorec_pt_mul_base() the same way */
+void gorec_pt_table_build(gorec_base_table* table, gorec_point* p, gorec_curve* crv) {
+	int WindowIndex;
+	int PointIndex;
+
+	gorec_point base;
+
+	_gorec_pt_enter(&base, p, crv);
+
+	for (WindowIndex = 0;
+		WindowIndex < GOREC_BASE_WINDOWS_COUNT;
+		WindowIndex++)
+	{
+		gorec_point* window = table->points[WindowIndex];
+
+		//NOTE(dima): base = 2^(GOREC_BASE_W * WindowIndex) * G
+		gorec_pt_copy(&window[0], &base);
+		for (PointIndex = 1;
+			PointIndex < GOREC_BASE_POINTS_PER_WINDOW;
+			PointIndex++)
+		{
+			gorec_pt_add_jacobian(&window[PointIndex], &window[PointIndex - 1], &window[0], crv);
+		}
+
+		//NOTE(dima): Next base is 2^GOREC_BASE_W * base = 2 * (2^(GOREC_BASE_W-1) * base)
+		crv->pt_double(&base, &window[GOREC_BASE_POINTS_PER_WINDOW - 1], crv);
+	}
+
+	//NOTE(dima): Storing affine points so that Z = 1 for cheaper additions
+	_gorec_pt_to_affine_batch(&table->points[0][0], GOREC_BASE_WINDOWS_COUNT * GOREC_BASE_POINTS_PER_WINDOW, crv);
+}
+
+/*
+	Fixed-base multiplication without the exit from Jacobian coordinates.
+	Result stays in the internal field representation.
+*/
+static void _gorec_pt_mul_base_internal(
+	gorec_point* p_result,
+	gorbn_t *p_scalar,
+	gorec_base_table* table,
+	gorec_curve* crv)
+{
+	int WindowIndex;
+	int carry = 0;
+
+	int digit_mask = (1 << GOREC_BASE_W) - 1;
+	int half = 1 << (GOREC_BASE_W - 1);
+
+	gorec_point result;
+
+	gorec_pt_clear(&result);
+
+	for (WindowIndex = 0;
+		WindowIndex < GOREC_BASE_WINDOWS_COUNT;
+		WindowIndex++)
+	{
+		int bit_index = WindowIndex * GOREC_BASE_W;
+		int digit = carry;
+
+		if (bit_index < GORBN_SZARR_BITS_TOTAL) {
+			//NOTE(dima): GORBN_SZWORD_BITS is a multiple of GOREC_BASE_W so digit never crosses words
+			digit += (int)((p_scalar[bit_index / GORBN_SZWORD_BITS] >> (bit_index % GORBN_SZWORD_BITS)) & digit_mask);
+		}
+
+		carry = 0;
+		if (digit > half) {
+			digit -= (1 << GOREC_BASE_W);
+			carry = 1;
+		}
+
+		if (digit > 0) {
+			gorec_pt_add_mixed(&result, &result, &table->points[WindowIndex][digit - 1], crv);
+		}
+		else if (digit < 0) {
+			gorec_pt_sub_mixed(&result, &result, &table->points[WindowIndex][-digit - 1], crv);
+		}
+	}
+
+	gorec_pt_copy(p_result, &result);
+}
+
+/*
+	Fixed-base scalar multiplication r = k * G.
+
+	Scalar is recoded to signed digits d_i in [-2^(w-1), 2^(w-1)], so that
+	k = sum(d_i * 2^(w*i)). Every digit selects one point from its window,
+	so only additions are needed - no doublings at all.
+*/
+void gorec_pt_mul_base(
+	gorec_point* p_result,
+	gorbn_t *p_scalar,
+	gorec_base_table* table,
+	gorec_curve* crv)
+{
+	gorec_point result;
+
+	_gorec_pt_mul_base_internal(&result, p_scalar, table, crv);
+
+	//NOTE(dima): Exit from Jacobian coordinates
+	_gorec_pt_to_affine_batch(&result, 1, crv);
+	_gorec_pt_leave(&result, &result, crv);
+
+	gorec_pt_copy(p_result, &result);
+}
+
+/*
+	Co-Z addition (XYcZ-ADD). P = (X1, Y1), Q = (X2, Y2) share the same Z.
+	Output: P -> P' (same point, new Z), Q -> P + Q, both with the new Z.
+	New Z = Z * (X2 - X1).
+*/
+static void _gorec_xycz_add(gorbn_t* X1, gorbn_t* Y1, gorbn_t* X2, gorbn_t* Y2, gorbn_t* Z, gorec_curve* crv) {
+	gorbn_t T[GORBN_SZARR];
+
+	gorbn_sub_mod(T, X2, X1, crv->p);
+	_gorec_fe_mul(Z, Z, T, crv);
+	_gorec_fe_sqr(T, T, crv); /* A = (X2 - X1)^2 */
+	_gorec_fe_mul(X1, X1, T, crv); /* B = X1 * A */
+	_gorec_fe_mul(X2, X2, T, crv); /* C = X2 * A */
+	gorbn_sub_mod(Y2, Y2, Y1, crv->p);
+	_gorec_fe_sqr(T, Y2, crv); /* D = (Y2 - Y1)^2 */
+
+	gorbn_sub_mod(T, T, X1, crv->p);
+	gorbn_sub_mod(T, T, X2, crv->p); /* X3 = D - B - C */
+	gorbn_sub_mod(X2, X2, X1, crv->p);
+	_gorec_fe_mul(Y1, Y1, X2, crv); /* Y1' = Y1 * (C - B) */
+	gorbn_sub_mod(X2, X1, T, crv->p);
+	_gorec_fe_mul(Y2, Y2, X2, crv);
+	gorbn_sub_mod(Y2, Y2, Y1, crv->p); /* Y3 = (Y2 - Y1) * (B - X3) - Y1' */
+
+	gorbn_copy(X2, T);
+}
+
+/*
+	Conjugate co-Z addition (XYcZ-ADDC).
+	Output: P -> P - Q, Q -> P + Q, both with the same new Z = Z * (X2 - X1).
+*/
+static void _gorec_xycz_addc(gorbn_t* X1, gorbn_t* Y1, gorbn_t* X2, gorbn_t* Y2, gorbn_t* Z, gorec_curve* crv) {
+	gorbn_t T5[GORBN_SZARR];
+	gorbn_t T6[GORBN_SZARR];
+	gorbn_t T7[GORBN_SZARR];
+
+	gorbn_sub_mod(T5, X2, X1, crv->p);
+	_gorec_fe_mul(Z, Z, T5, crv);
+	_gorec_fe_sqr(T5, T5, crv); /* A = (X2 - X1)^2 */
+	_gorec_fe_mul(X1, X1, T5, crv); /* B = X1 * A */
+	_gorec_fe_mul(X2, X2, T5, crv); /* C = X2 * A */
+	gorbn_add_mod(T5, Y2, Y1, crv->p);
+	gorbn_sub_mod(Y2, Y2, Y1, crv->p);
+
+	gorbn_sub_mod(T6, X2, X1, crv->p);
+	_gorec_fe_mul(Y1, Y1, T6, crv); /* E = Y1 * (C - B) */
+	gorbn_add_mod(T6, X1, X2, crv->p);
+	_gorec_fe_sqr(X2, Y2, crv);
+	gorbn_sub_mod(X2, X2, T6, crv->p); /* X3 = (Y2 - Y1)^2 - (B + C) */
+
+	gorbn_sub_mod(T7, X1, X2, crv->p);
+	_gorec_fe_mul(Y2, Y2, T7, crv);
+	gorbn_sub_mod(Y2, Y2, Y1, crv->p); /* Y3 = (Y2 - Y1) * (B - X3) - E */
+
+	_gorec_fe_sqr(T7, T5, crv);
+	gorbn_sub_mod(T7, T7, T6, crv->p); /* X3' = (Y2 + Y1)^2 - (B + C) */
+	gorbn_sub_mod(T6, T7, X1, crv->p);
+	_gorec_fe_mul(T6, T6, T5, crv);
+	gorbn_sub_mod(Y1, T6, Y1, crv->p); /* Y3' = (Y2 + Y1) * (X3' - B) - E */
+
+	gorbn_copy(X1, T7);
+}
+
+/* (X, Y) -> (X * Z^2, Y * Z^3) */
+static void _gorec_apply_z(gorbn_t* X, gorbn_t* Y, gorbn_t* Z, gorec_curve* crv) {
+	gorbn_t T[GORBN_SZARR];
+
+	_gorec_fe_sqr(T, Z, crv);
+	_gorec_fe_mul(X, X, T, crv);
+	_gorec_fe_mul(T, T, Z, crv);
+	_gorec_fe_mul(Y, Y, T, crv);
+}
+
+/*
+	Ladder state. k is k + q or k + 2q, whichever carries into bit 256.
+	point is the input and dbl is 2 * point, both are needed at the end for
+	the exceptional scalars.
+*/
+typedef struct _gorec_ladder {
+	gorbn_t X0[GORBN_SZARR];
+	gorbn_t Y0[GORBN_SZARR];
+	gorbn_t X1[GORBN_SZARR];
+	gorbn_t Y1[GORBN_SZARR];
+	gorbn_t Z[GORBN_SZARR];
+	gorbn_t k[GORBN_SZARR];
+
+	gorec_point point;
+	gorec_point dbl;
+} _gorec_ladder;
+
+static void _gorec_ladder_begin(
+	_gorec_ladder* l,
+	gorec_point* p_point,
+	gorbn_t* p_scalar,
+	gorec_curve* crv)
+{
+	gorbn_t kq[GORBN_SZARR];
+	int carry;
+
+	//NOTE(dima): k' = k + q if it carries out, otherwise k + 2q. Bit 256 of k' is always 1
+	carry = gorbn_add(kq, p_scalar, crv->q);
+	gorbn_add(l->k, kq, crv->q);
+	_gorbn_cmov(l->k, kq, carry);
+
+	//NOTE(dima): R0 = P, R1 = 2P with the same Z
+	_gorec_pt_enter(&l->point, p_point, crv);
+	crv->pt_double(&l->dbl, &l->point, crv);
+	gorbn_copy(l->X1, l->dbl.x);
+	gorbn_copy(l->Y1, l->dbl.y);
+	gorbn_copy(l->X0, l->point.x);
+	gorbn_copy(l->Y0, l->point.y);
+	_gorec_apply_z(l->X0, l->Y0, l->dbl.z, crv);
+	gorbn_copy(l->Z, l->dbl.z);
+}
+
+/* R0 = (X0, Y0, Z) must already be k * P, with the final swap done */
+static void _gorec_ladder_end(
+	gorec_point* p_result,
+	_gorec_ladder* l,
+	gorbn_t* p_scalar,
+	gorec_curve* crv)
+{
+	gorbn_t TMP[GORBN_SZARR];
+	gorbn_t ONE[GORBN_SZARR];
+
+	int k_is_0, k_is_1, k_is_m1, k_is_m2;
+
+	//NOTE(dima): Exceptional scalars: 0 -> O, 1 -> P, q - 1 -> -P, q - 2 -> -2P
+	gorbn_init(TMP, GORBN_SZARR);
+	k_is_0 = _gorbn_ct_is_equal(p_scalar, TMP);
+	gorbn_from_int(ONE, 1);
+	k_is_1 = _gorbn_ct_is_equal(p_scalar, ONE);
+	gorbn_sub(TMP, crv->q, ONE);
+	k_is_m1 = _gorbn_ct_is_equal(p_scalar, TMP);
+	gorbn_sub(TMP, TMP, ONE);
+	k_is_m2 = _gorbn_ct_is_equal(p_scalar, TMP);
+
+	_gorbn_cmov(l->X0, l->point.x, k_is_1 | k_is_m1 | k_is_0);
+	_gorbn_cmov(l->Y0, l->point.y, k_is_1 | k_is_m1 | k_is_0);
+	_gorbn_cmov(l->Z, l->point.z, k_is_1 | k_is_m1 | k_is_0);
+	_gorbn_cmov(l->X0, l->dbl.x, k_is_m2);
+	_gorbn_cmov(l->Y0, l->dbl.y, k_is_m2);
+	_gorbn_cmov(l->Z, l->dbl.z, k_is_m2);
+
+	gorbn_init(TMP, GORBN_SZARR);
+	gorbn_sub_mod(TMP, TMP, l->Y0, crv->p);
+	_gorbn_cmov(l->Y0, TMP, k_is_m1 | k_is_m2);
+
+	//NOTE(dima): Exit from Jacobian coordinates
+	_gorec_fe_inv(l->Z, l->Z, crv);
+	_gorec_apply_z(l->X0, l->Y0, l->Z, crv);
+
+	gorbn_copy(p_result->x, l->X0);
+	gorbn_copy(p_result->y, l->Y0);
+	gorbn_copy(p_result->z, l->point.z);
+	p_result->is_inf = 0;
+	_gorec_pt_leave(p_result, p_result, crv);
+
+	gorbn_init(TMP, GORBN_SZARR);
+	_gorbn_cmov(p_result->x, TMP, k_is_0);
+	_gorbn_cmov(p_result->y, TMP, k_is_0);
+	p_result->is_inf = k_is_0;
+}
+
+/*
+	Montgomery ladder with co-Z formulas (Goundar, Joye, Miyaji).
+
+	Every step is the same sequence of field operations: conditional swap,
+	XYcZ-ADDC, XYcZ-ADD. Points are selected with gorbn_cswap() masks, never
+	with branches or secret dependent indices. The common Z costs one extra
+	multiplication per addition (the usual x/y-only Z recovery divides by
+	x of the input point, and the bign generator has x = 0).
+
+	The scalar is replaced by k + q or k + 2q, whichever is exactly 257 bits
+	long, so the number of steps does not depend on k either.
+
+	For k = 0, 1, q - 2, q - 1 the ladder hits the point at infinity in the
+	last steps, these results are substituted with masks before the exit.
+
+	p_point must be affine and not at infinity, k should be in [0, q - 1].
+*/
+void gorec_pt_mul_monty(
+	gorec_point* p_result,
+	gorec_point *p_point,
+	gorbn_t *p_scalar,
+	gorec_curve* crv)
+{
+	_gorec_ladder l;
+
+	int swap = 0;
+	int bit;
+	int i;
+
+	_gorec_ladder_begin(&l, p_point, p_scalar, crv);
+
+	for (i = GORBN_SZARR_BITS_TOTAL - 1; i >= 0; i--) {
+		bit = _gorbn_testbit(l.k, i);
+
+		//NOTE(dima): After the swap R0 = R[bit], R1 = R[1 - bit]
+		gorbn_cswap(l.X0, l.X1, swap ^ bit);
+		gorbn_cswap(l.Y0, l.Y1, swap ^ bit);
+		swap = bit;
+
+		_gorec_xycz_addc(l.X0, l.Y0, l.X1, l.Y1, l.Z, crv);
+		_gorec_xycz_add(l.X1, l.Y1, l.X0, l.Y0, l.Z, crv);
+	}
+
+	gorbn_cswap(l.X0, l.X1, swap);
+	gorbn_cswap(l.Y0, l.Y1, swap);
+
+	_gorec_ladder_end(p_result, &l, p_scalar, crv);
+}
+
+/* Swaps lanes of a and b where mask is all ones */
+static void _gorec_fe_x4_cswap(gorec_fe_x4* a, gorec_fe_x4* b, uint64_t* mask) {
+	int i, lane;
+
+	for (i = 0; i < GOREC_X4_LIMBS; i++) {
+		for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+			uint64_t t = (a->l[i][lane] ^ b->l[i][lane]) & mask[lane];
+			a->l[i][lane] ^= t;
+			b->l[i][lane] ^= t;
+		}
+	}
+}
+
+/* _gorec_xycz_add() on four lanes */
+static void _gorec_xycz_add_x4(
+	gorec_fe_x4* X1, gorec_fe_x4* Y1,
+	gorec_fe_x4* X2, gorec_fe_x4* Y2,
+	gorec_fe_x4* Z,
+	_gorec_x4_funcs* f, gorec_x4_ctx* ctx)
+{
+	gorec_fe_x4 T;
+
+	f->sub(&T, X2, X1, ctx);
+	f->mul(Z, Z, &T, ctx);
+	f->mul(&T, &T, &T, ctx);
+	f->mul(X1, X1, &T, ctx);
+	f->mul(X2, X2, &T, ctx);
+	f->sub(Y2, Y2, Y1, ctx);
+	f->mul(&T, Y2, Y2, ctx);
+
+	f->sub(&T, &T, X1, ctx);
+	f->sub(&T, &T, X2, ctx);
+	f->sub(X2, X2, X1, ctx);
+	f->mul(Y1, Y1, X2, ctx);
+	f->sub(X2, X1, &T, ctx);
+	f->mul(Y2, Y2, X2, ctx);
+	f->sub(Y2, Y2, Y1, ctx);
+
+	*X2 = T;
+}
+
+/* _gorec_xycz_addc() on four lanes */
+static void _gorec_xycz_addc_x4(
+	gorec_fe_x4* X1, gorec_fe_x4* Y1,
+	gorec_fe_x4* X2, gorec_fe_x4* Y2,
+	gorec_fe_x4* Z,
+	_gorec_x4_funcs* f, gorec_x4_ctx* ctx)
+{
+	gorec_fe_x4 T5;
+	gorec_fe_x4 T6;
+	gorec_fe_x4 T7;
+
+	f->sub(&T5, X2, X1, ctx);
+	f->mul(Z, Z, &T5, ctx);
+	f->mul(&T5, &T5, &T5, ctx);
+	f->mul(X1, X1, &T5, ctx);
+	f->mul(X2, X2, &T5, ctx);
+	f->add(&T5, Y2, Y1, ctx);
+	f->sub(Y2, Y2, Y1, ctx);
+
+	f->sub(&T6, X2, X1, ctx);
+	f->mul(Y1, Y1, &T6, ctx);
+	f->add(&T6, X1, X2, ctx);
+	f->mul(X2, Y2, Y2, ctx);
+	f->sub(X2, X2, &T6, ctx);
+
+	f->sub(&T7, X1, X2, ctx);
+	f->mul(Y2, Y2, &T7, ctx);
+	f->sub(Y2, Y2, Y1, ctx);
+
+	f->mul(&T7, &T5, &T5, ctx);
+	f->sub(&T7, &T7, &T6, ctx);
+	f->sub(&T6, &T7, X1, ctx);
+	f->mul(&T6, &T6, &T5, ctx);
+	f->sub(Y1, &T6, Y1, ctx);
+
+	*X1 = T7;
+}
+
+/*
+	The ladder of gorec_pt_mul_monty() for four points at once. Setup and
+	exit are done per lane with the usual code, the 256 steps in between
+	run on the 4-way field layer. Lanes take different swap masks, but the
+	sequence of operations is the same for all of them.
+*/
+void gorec_pt_mul_x4(
+	gorec_point* results,
+	gorec_point* points,
+	gorbn_t* scalars,
+	gorec_curve* crv)
+{
+	_gorec_ladder l[GOREC_X4_LANES];
+
+	gorec_fe_x4 X0, Y0, X1, Y1, Z;
+
+	uint64_t swap[GOREC_X4_LANES];
+	uint64_t mask[GOREC_X4_LANES];
+	int lane;
+	int i;
+
+	if (!crv->x4.enabled) {
+		for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+			gorec_pt_mul_monty(&results[lane], &points[lane], scalars + lane * GORBN_SZARR, crv);
+		}
+		return;
+	}
+
+	_gorec_x4_funcs* f = _gorec_x4_get_funcs();
+
+	//NOTE(dima): Field representation of the curve is the normal one, so ladder values are loaded as is
+	for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+		_gorec_ladder_begin(&l[lane], &points[lane], scalars + lane * GORBN_SZARR, crv);
+
+		gorec_fe_x4_load(&X0, lane, l[lane].X0);
+		gorec_fe_x4_load(&Y0, lane, l[lane].Y0);
+		gorec_fe_x4_load(&X1, lane, l[lane].X1);
+		gorec_fe_x4_load(&Y1, lane, l[lane].Y1);
+		gorec_fe_x4_load(&Z, lane, l[lane].Z);
+
+		swap[lane] = 0;
+	}
+
+	for (i = GORBN_SZARR_BITS_TOTAL - 1; i >= 0; i--) {
+		for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+			uint64_t bit = (uint64_t)_gorbn_testbit(l[lane].k, i);
+
+			mask[lane] = 0 - (swap[lane] ^ bit);
+			swap[lane] = bit;
+		}
+
+		_gorec_fe_x4_cswap(&X0, &X1, mask);
+		_gorec_fe_x4_cswap(&Y0, &Y1, mask);
+
+		_gorec_xycz_addc_x4(&X0, &Y0, &X1, &Y1, &Z, f, &crv->x4);
+		_gorec_xycz_add_x4(&X1, &Y1, &X0, &Y0, &Z, f, &crv->x4);
+	}
+
+	for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+		mask[lane] = 0 - swap[lane];
+	}
+	_gorec_fe_x4_cswap(&X0, &X1, mask);
+	_gorec_fe_x4_cswap(&Y0, &Y1, mask);
+
+	for (lane = 0; lane < GOREC_X4_LANES; lane++) {
+		gorec_fe_x4_store(l[lane].X0, &X0, lane, crv);
+		gorec_fe_x4_store(l[lane].Y0, &Y0, lane, crv);
+		gorec_fe_x4_store(l[lane].Z, &Z, lane, crv);
+
+		_gorec_ladder_end(&results[lane], &l[lane], scalars + lane * GORBN_SZARR, crv);
+	}
+}
+
+
+/*
+	Batch scalar multiplication.
+
+	Chunks of GOREC_BATCH_CHUNK points are initially split evenly between
+	workers. Every worker takes chunks from its own range first and then
+	steals from the ranges of others. Taking a chunk is a single atomic
+	increment, there are no locks. All temporaries live on the worker
+	stacks. Each point is computed by the same code as in the serial call,
+	so the results do not depend on the thread count or scheduling.
+*/
+typedef struct _gorec_batch_range {
+	volatile long next; /* next chunk to take, may go past end */
+	long end;
+
+	//NOTE(dima): Keeping ranges on separate cache lines
+	char pad[64 - sizeof(long) * 2];
+} _gorec_batch_range;
+
+typedef struct _gorec_batch_job {
+	gorec_point* results;
+	gorec_point* points;
+	gorbn_t* scalars;
+	int n;
+	gorec_curve* crv;
+
+	int nthreads;
+	_gorec_batch_range ranges[GOREC_BATCH_MAX_THREADS];
+} _gorec_batch_job;
+
+typedef struct _gorec_batch_worker {
+	_gorec_batch_job* job;
+	int index;
+} _gorec_batch_worker;
+
+static long _gorec_batch_take(_gorec_batch_range* range) {
+#ifndef GOR_BIGNUM_NO_THREADS
+	long chunk = _GOREC_ATOMIC_FETCH_INC(&range->next);
+#else
+	long chunk = range->next++;
+#endif
+
+	return((chunk < range->end) ? chunk : -1);
+}
+
+static void _gorec_batch_do_chunk(_gorec_batch_job* job, long chunk) {
+	int start = (int)chunk * GOREC_BATCH_CHUNK;
+	int end = GORBN_MIN(start + GOREC_BATCH_CHUNK, job->n);
+	int i;
+
+	for (i = start; i < end; i++) {
+		_gorec_pt_mul_wnaf_internal(
+			&job->results[i],
+			&job->points[i],
+			job->scalars + (size_t)i * GORBN_SZARR,
+			job->crv);
+	}
+
+	//NOTE(dima): Exit from Jacobian coordinates, one inversion per chunk
+	_gorec_pt_to_affine_batch(&job->results[start], end - start, job->crv);
+	for (i = start; i < end; i++) {
+		_gorec_pt_leave(&job->results[i], &job->results[i], job->crv);
+	}
+}
+
+static void _gorec_batch_work(_gorec_batch_worker* worker) {
+	_gorec_batch_job* job = worker->job;
+	int VictimIndex;
+	long chunk;
+
+	//NOTE(dima): Own range first, then stealing from the others
+	for (VictimIndex = 0; VictimIndex < job->nthreads; VictimIndex++) {
+		_gorec_batch_range* range = &job->ranges[(worker->index + VictimIndex) % job->nthreads];
+
+		while ((chunk = _gorec_batch_take(range)) >= 0) {
+			_gorec_batch_do_chunk(job, chunk);
+		}
+	}
+}
+
+#ifndef GOR_BIGNUM_NO_THREADS
+/*
+	NOTE(dima): The pool. Worker i (1..started) sleeps on wake until the
+	generation changes, takes part in the batch if i < active, and the last
+	one to finish signals done. A worker can not miss a batch it is active
+	in: the next one starts only after every active worker has finished.
+	batch_lock makes batches from different threads take turns.
+*/
+typedef struct _gorec_batch_pool {
+#ifdef _WIN32
+	SRWLOCK batch_lock;
+	SRWLOCK lock;
+	CONDITION_VARIABLE wake;
+	CONDITION_VARIABLE done;
+	HANDLE threads[GOREC_BATCH_MAX_THREADS];
+#else
+	pthread_mutex_t batch_lock;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	pthread_t threads[GOREC_BATCH_MAX_THREADS];
+#endif
+
+	int started; /* Worker threads running, the calling thread is not one of them */
+	int shutdown;
+	long generation;
+	long seen[GOREC_BATCH_MAX_THREADS]; /* Last generation each worker woke up for */
+	int active; /* Threads in the current batch, including the calling one */
+	int pending; /* Workers of the current batch that did not finish yet */
+	_gorec_batch_job* job;
+} _gorec_batch_pool;
+
+#ifdef _WIN32
+static _gorec_batch_pool _gorec_pool = {
+	SRWLOCK_INIT, SRWLOCK_INIT,
+	CONDITION_VARIABLE_INIT, CONDITION_VARIABLE_INIT,
+	{ 0 }, 0, 0, 0, { 0 }, 0, 0, 0
+};
+
+#define _GOREC_POOL_LOCK(ptr) AcquireSRWLockExclusive(ptr)
+#define _GOREC_POOL_UNLOCK(ptr) ReleaseSRWLockExclusive(ptr)
+#define _GOREC_POOL_WAIT(cond, lock) SleepConditionVariableSRW(cond, lock, INFINITE, 0)
+#define _GOREC_POOL_SIGNAL(cond) WakeConditionVariable(cond)
+#define _GOREC_POOL_BROADCAST(cond) WakeAllConditionVariable(cond)
+#else
+static _gorec_batch_pool _gorec_pool = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	{ 0 }, 0, 0, 0, { 0 }, 0, 0, 0
+};
+
+#define _GOREC_POOL_LOCK(ptr) pthread_mutex_lock(ptr)
+#define _GOREC_POOL_UNLOCK(ptr) pthread_mutex_unlock(ptr)
+#define _GOREC_POOL_WAIT(cond, lock) pthread_cond_wait(cond, lock)
+#define _GOREC_POOL_SIGNAL(cond) pthread_cond_signal(cond)
+#define _GOREC_POOL_BROADCAST(cond) pthread_cond_broadcast(cond)
+#endif
 
-	if (gorbn_cmp(U1, U2) == GORBN_CMP_EQUAL) {
-		if (gorbn_cmp(S1, S2) != GORBN_CMP_EQUAL) {
-			//NOTE(dima): Return POINT_AT_INFINITY
-			int a = 1;
+static void _gorec_batch_pool_loop(int index) {
+	_gorec_batch_pool* pool = &_gorec_pool;
+	_gorec_batch_worker worker;
+
+	_GOREC_POOL_LOCK(&pool->lock);
+
+	for (;;) {
+		while (!pool->shutdown && pool->generation == pool->seen[index]) {
+			_GOREC_POOL_WAIT(&pool->wake, &pool->lock);
 		}
-		else {
-			//NOTE(dima):
-			return gorec_pt_double_jacobian(r, a, crv);
+		if (pool->shutdown) {
+			break;
 		}
-	}
 
-	// H = U2 - U1
-	gorbn_sub_mod(H, U2, U1, crv->p);
+		pool->seen[index] = pool->generation;
+		if (index >= pool->active) {
+			continue;
+		}
 
-	// R = S2 - S1
-	gorbn_sub_mod(R, S2, S1, crv->p);
+		worker.job = pool->job;
+		worker.index = index;
+		_GOREC_POOL_UNLOCK(&pool->lock);
 
-	// X3 = R^2 - H^3 - 2*U1*H^2
-	gorbn_sqr_mod(r->x, R, crv->p);
-	gorbn_sqr_mod(U2, H, crv->p);
-	gorbn_mul_mod(U2, U2, H, crv->p);
-	gorbn_sub_mod(r->x, r->x, U2, crv->p);
-	gorbn_sqr_mod(TMP, H, crv->p);
-	gorbn_mul_mod(TMP, TMP, U1, crv->p);
-	gorbn_mulword_mod(TMP, TMP, 2, crv->p);
-	gorbn_sub_mod(r->x, r->x, TMP, crv->p);
-
-	// Y3 = R*(U1*H^2 - X3) - S1*H^3
-	gorbn_sqr_mod(TMP, H, crv->p);
-	gorbn_mul_mod(TMP, TMP, U1, crv->p);
-	gorbn_sub_mod(TMP, TMP, r->x, crv->p);
-	gorbn_mul_mod(TMP, TMP, R, crv->p);
-	gorbn_mul_mod(U2, U2, S1, crv->p);
-	gorbn_sub_mod(r->y, TMP, U2, crv->p);
-
-	// Z3 = H*Z1*Z2
-	gorbn_mul_mod(r->z, a->z, b->z, crv->p);
-	gorbn_mul_mod(r->z, r->z, H, crv->p);
-}
+		_gorec_batch_work(&worker);
 
-/*Point subtraction in Jacobian projective coordinates*/
-void gorec_pt_sub_jacobian(gorec_point* r, gorec_point* a, gorec_point* b, gorec_curve* crv) {
-	gorbn_t SaveY[GORBN_SZARR];
+		_GOREC_POOL_LOCK(&pool->lock);
+		if (--pool->pending == 0) {
+			_GOREC_POOL_SIGNAL(&pool->done);
+		}
+	}
 
-	//NOTE(dima): Save b->y for later reassigning
-	gorbn_copy(SaveY, b->y);
+	_GOREC_POOL_UNLOCK(&pool->lock);
+}
 
-	//NOTE(dima): 0 - b->y
-	gorbn_init(b->y, GORBN_SZARR);
+#ifdef _WIN32
+static DWORD WINAPI _gorec_batch_thread_proc(LPVOID param) {
+	_gorec_batch_pool_loop((int)(intptr_t)param);
+	return(0);
+}
+#else
+static void* _gorec_batch_thread_proc(void* param) {
+	_gorec_batch_pool_loop((int)(intptr_t)param);
+	return(0);
+}
+#endif
 
-	gorbn_sub_mod(b->y, b->y, SaveY, crv->p);
+/* Starts workers up to nthreads - 1, returns the thread count that can be used. Pool lock is held */
+static int _gorec_batch_pool_grow(_gorec_batch_pool* pool, int nthreads) {
+	while (pool->started < nthreads - 1) {
+		intptr_t index = pool->started + 1;
 
-	//NOTE(dima): Adding initial A and negated B
-	gorec_pt_add_jacobian(r, a, b, crv);
+		//NOTE(dima): The thread may get the lock only after the batch it was started for is published
+		pool->seen[index] = pool->generation;
 
-	//NOTE(dima): Returning old saved b->y value
-	gorbn_copy(b->y, SaveY);
-}
+#ifdef _WIN32
+		HANDLE thread = CreateThread(0, 0, _gorec_batch_thread_proc, (LPVOID)index, 0, 0);
+		if (!thread) {
+			break;
+		}
+		pool->threads[index] = thread;
+#else
+		if (pthread_create(&pool->threads[index], 0, _gorec_batch_thread_proc, (void*)index) != 0) {
+			break;
+		}
+#endif
+		pool->started++;
+	}
 
-//NOTE(dima): window width w should not be greater than 7 (<=7)
+	return(GORBN_MIN(nthreads, pool->started + 1));
+}
+#endif
 
-static void gorec_compute_naf(char* NAF, int* NAFLength, gorbn_t k[GORBN_SZARR], int w) {
-	gorbn_t kk[GORBN_SZARR];
-	gorbn_t temp[GORBN_SZARR];
-	int i;
+void gorec_pt_mul_batch(
+	gorec_point* results,
+	gorec_point* points,
+	gorbn_t* scalars,
+	int n,
+	gorec_curve* crv,
+	int nthreads)
+{
+	_gorec_batch_job job;
+	_gorec_batch_worker worker;
+	long chunks_count = (n + GOREC_BATCH_CHUNK - 1) / GOREC_BATCH_CHUNK;
 
-	gorbn_copy(kk, k);
-	gorbn_init(temp, GORBN_SZARR);
+	if (n <= 0) {
+		return;
+	}
 
-	int two_pow_w = 1 << w;
-	int half_pow_w = two_pow_w >> 1;
+#ifdef GOR_BIGNUM_NO_THREADS
+	nthreads = 1;
+#endif
+	nthreads = GORBN_CLAMP(nthreads, 1, GOREC_BATCH_MAX_THREADS);
+	if (nthreads > chunks_count) {
+		nthreads = (int)chunks_count;
+	}
 
-	i = 0;
-	while (!gorbn_is_zero(kk)) {
-		int ExitOnTheEndOfIteration = 0;
-		if (gorbn_is_one(kk)) {
-			ExitOnTheEndOfIteration = 1;
-		}
+	job.results = results;
+	job.points = points;
+	job.scalars = scalars;
+	job.n = n;
+	job.crv = crv;
 
-		if (!GORBN_EVEN(kk)) {
-			int word_mod_res = kk[0] & (two_pow_w - 1);
+	//NOTE(dima): Calling thread is worker 0
+	worker.job = &job;
+	worker.index = 0;
 
-			if (word_mod_res >= half_pow_w) {
-				NAF[i] = word_mod_res - two_pow_w;
-			}
-			else {
-				NAF[i] = word_mod_res;
-			}
+#ifndef GOR_BIGNUM_NO_THREADS
+	if (nthreads > 1) {
+		_gorec_batch_pool* pool = &_gorec_pool;
+		int ThreadIndex;
 
-			if (NAF[i] > 0) {
-				gorbn_from_int(temp, NAF[i]);
-				int borrow = gorbn_sub(kk, kk, temp);
+		_GOREC_POOL_LOCK(&pool->batch_lock);
+		_GOREC_POOL_LOCK(&pool->lock);
 
-				if (borrow) {
-					ExitOnTheEndOfIteration = 1;
-				}
-			}
-			else {
-				gorbn_from_int(temp, -NAF[i]);
-				gorbn_add(kk, kk, temp);
+		nthreads = _gorec_batch_pool_grow(pool, nthreads);
 
-				if (ExitOnTheEndOfIteration) {
-					ExitOnTheEndOfIteration = 0;
-				}
-			}
-		}
-		else {
-			NAF[i] = 0;
+		//NOTE(dima): Ranges are split only when the number of threads is final
+		job.nthreads = nthreads;
+		for (ThreadIndex = 0; ThreadIndex < nthreads; ThreadIndex++) {
+			job.ranges[ThreadIndex].next = chunks_count * ThreadIndex / nthreads;
+			job.ranges[ThreadIndex].end = chunks_count * (ThreadIndex + 1) / nthreads;
 		}
 
-		i++;
-		gorbn_rshift_one_bit(kk);
+		pool->job = &job;
+		pool->active = nthreads;
+		pool->pending = nthreads - 1;
+		pool->generation++;
+		_GOREC_POOL_BROADCAST(&pool->wake);
+		_GOREC_POOL_UNLOCK(&pool->lock);
 
-		if (ExitOnTheEndOfIteration) {
-			break;
+		_gorec_batch_work(&worker);
+
+		_GOREC_POOL_LOCK(&pool->lock);
+		while (pool->pending) {
+			_GOREC_POOL_WAIT(&pool->done, &pool->lock);
 		}
+		pool->job = 0;
+		_GOREC_POOL_UNLOCK(&pool->lock);
+		_GOREC_POOL_UNLOCK(&pool->batch_lock);
+
+		return;
 	}
+#endif
 
-	*NAFLength = i;
+	job.nthreads = 1;
+	job.ranges[0].next = 0;
+	job.ranges[0].end = chunks_count;
+	_gorec_batch_work(&worker);
 }
 
-#define GOREC_WINDOW_W 4
-#define GOREC_PRECOMPUTE_ARRAYS_COUNT (1 << (GOREC_WINDOW_W - 2))
-void gorec_pt_mul_wnaf_jacobian(
-	gorec_point* p_result,
-	gorec_point *p_point,
-	gorbn_t *p_scalar,
-	gorec_curve* crv) 
-{
-	int PrecomputeIndex;
+void gorec_pt_mul_batch_shutdown(void) {
+#ifndef GOR_BIGNUM_NO_THREADS
+	_gorec_batch_pool* pool = &_gorec_pool;
+	int ThreadIndex;
+
+	_GOREC_POOL_LOCK(&pool->lock);
+	pool->shutdown = 1;
+	_GOREC_POOL_BROADCAST(&pool->wake);
+	_GOREC_POOL_UNLOCK(&pool->lock);
+
+	for (ThreadIndex = 1; ThreadIndex <= pool->started; ThreadIndex++) {
+#ifdef _WIN32
+		WaitForSingleObject(pool->threads[ThreadIndex], INFINITE);
+		CloseHandle(pool->threads[ThreadIndex]);
+#else
+		pthread_join(pool->threads[ThreadIndex], 0);
+#endif
+	}
+
+	_GOREC_POOL_LOCK(&pool->lock);
+	pool->started = 0;
+	pool->shutdown = 0;
+	_GOREC_POOL_UNLOCK(&pool->lock);
+#endif
+}
+
+/*
+	NOTE(dima): Table cache. The lock guards the miss path: admission,
+	replacement, the clock and the miss counters. users is changed only
+	atomically. An entry is replaced only by the thread that moved its
+	users from 0 to -1, and a hit only counts once users went from n >= 0
+	to n + 1, so the key, the state and the table of a used entry never
+	change. A hit checks the key again after that, before it was a hint.
+*/
+int gorec_table_cache_init(gorec_table_cache* cache, void* mem, size_t size, gorec_curve* crv) {
+	uintptr_t at = (uintptr_t)mem;
+	uintptr_t aligned = (at + (GORBN_ARENA_ALIGN - 1)) & ~(uintptr_t)(GORBN_ARENA_ALIGN - 1);
+	size_t skip = (size_t)(aligned - at);
+
+	cache->crv = crv;
+	cache->entries = (gorec_table_cache_entry*)aligned;
+	cache->entries_count = (size > skip) ? (int)((size - skip) / sizeof(gorec_table_cache_entry)) : 0;
+	cache->sets_count = GORBN_MAX(cache->entries_count / GOREC_TABLE_CACHE_WAYS, 1);
+	cache->recent_count = GORBN_CLAMP(cache->entries_count * 2, 1, GOREC_TABLE_CACHE_RECENT);
+	cache->lock = 0;
+
+	gorec_table_cache_clear(cache);
+
+	return(cache->entries_count);
+}
+
+void gorec_table_cache_clear(gorec_table_cache* cache) {
 	int i;
 
-	//NOTE(dima): I think that this is the maximum possible size of this thing
-	char NAF[GORBN_SZARR_BITS_TOTAL + 1];
-	int NAFLength;
+	for (i = 0; i < cache->entries_count; i++) {
+		cache->entries[i].state = GOREC_TABLE_CACHE_FREE;
+		cache->entries[i].users = 0;
+		cache->entries[i].last_used = 0;
+		cache->entries[i].hash = 0;
+	}
 
-	int w = GOREC_WINDOW_W;
-	gorec_point PrecomputePoints[GOREC_PRECOMPUTE_ARRAYS_COUNT];
+	for (i = 0; i < GOREC_TABLE_CACHE_RECENT; i++) {
+		cache->recent[i] = 0;
+	}
+	cache->recent_next = 0;
 
-	gorec_point result;
-	gorbn_t temp_for_exit[GORBN_SZARR];
+	cache->clock = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+}
 
-	//NOTE(dima): Step1 - Computing Non-Adjacent Form (NAF)
-	gorec_compute_naf(NAF, &NAFLength, p_scalar, w);
+void gorec_table_cache_get_stats(gorec_table_cache* cache, gorec_table_cache_stats* stats) {
+	int i;
 
-	//NOTE(dima): Using p_result as temp variable
-	gorec_pt_copy(&result, p_point);
-	gorec_pt_copy(&PrecomputePoints[0], &result);
-	//NOTE(dima): Step2 - Precomputing points
-	for (PrecomputeIndex = 0;
-		PrecomputeIndex < GOREC_PRECOMPUTE_ARRAYS_COUNT;
-		PrecomputeIndex++)
-	{
-		if (PrecomputeIndex != 0) {
-			//NOTE(dima): Incrementing 2 times by p_point to save odd'ness
-			gorec_pt_add_jacobian(&result, &result, p_point, crv);
-			gorec_pt_add_jacobian(&result, &result, p_point, crv);
+	_GOREC_SPIN_LOCK(&cache->lock);
 
-			gorec_pt_copy(&PrecomputePoints[PrecomputeIndex], &result);
-		}
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->evictions = cache->evictions;
+	stats->entries_used = 0;
+	for (i = 0; i < cache->entries_count; i++) {
+		stats->entries_used += (cache->entries[i].state != GOREC_TABLE_CACHE_FREE);
 	}
 
-	gorec_pt_clear(&result);
-	//NOTE(dima): Step 3 - Compute result using precomputed values
-	for (i = NAFLength - 1; i >= 0; i--) {
-		gorec_pt_double_jacobian(&result, &result, crv);
-		if (NAF[i] != 0) {
-			if (NAF[i] > 0) {
-				gorec_pt_add_jacobian(&result, &result, &PrecomputePoints[NAF[i] >> 1], crv);
-			}
-			else {
-				gorec_pt_sub_jacobian(&result, &result, &PrecomputePoints[(-NAF[i]) >> 1], crv);
-			}
-		}
+	_GOREC_SPIN_UNLOCK(&cache->lock);
+
+	stats->entries_count = cache->entries_count;
+	stats->bytes = (size_t)cache->entries_count * sizeof(gorec_table_cache_entry);
+}
+
+//NOTE(dima): FNV-1a over the digits of x, never 0 as it marks empty recent slots
+static uint32_t _gorec_table_cache_hash(gorbn_t* x) {
+	uint64_t h = 0xCBF29CE484222325ull;
+	int i;
+
+	for (i = 0; i < GORBN_SZARR; i++) {
+		h = (h ^ (uint64_t)x[i]) * 0x100000001B3ull;
 	}
 
-	//NOTE(dima): Exit from Jacobian coordinates
-	gorbn_sqr_mod(temp_for_exit, result.z, crv->p);
-	gorbn_inv_mod(temp_for_exit, temp_for_exit, crv->p);
-	gorbn_mul_mod(result.x, temp_for_exit, result.x, crv->p);
+	h ^= h >> 32;
+	return((uint32_t)h ? (uint32_t)h : 1);
+}
 
-	gorbn_sqr_mod(temp_for_exit, result.z, crv->p);
-	gorbn_mul_mod(temp_for_exit, temp_for_exit, result.z, crv->p);
-	gorbn_inv_mod(temp_for_exit, temp_for_exit, crv->p);
-	gorbn_mul_mod(result.y, temp_for_exit, result.y, crv->p);
+//NOTE(dima): Adds a user unless the entry is being replaced
+static int _gorec_table_cache_pin(gorec_table_cache_entry* entry) {
+	long users = entry->users;
 
-	gorbn_from_int(result.z, 1);
+	while (users >= 0) {
+		if (_GOREC_ATOMIC_CAS(&entry->users, users, users + 1)) {
+			return(1);
+		}
+		users = entry->users;
+	}
 
-	gorec_pt_copy(p_result, &result);
+	return(0);
 }
 
 /*
-	Умножение точки эллиптической кривой на скаляр
-
-	p_result - указатель на результат - точку эллиптической кривой
-	p_point - указатель на точку, которую будем умножать
-	p_scalar - указатель на скалял, на который будем умножать p_point
-	crv - указатель на структуру с параметрами эллиптической кривой
+	Lock-free lookup of p among the entries from first to end. Returns the
+	pinned entry or 0. *busy is set if its table is being built right now.
 */
-
-void gorec_pt_mul(
-	gorec_point* p_result,
-	gorec_point *p_point,
-	gorbn_t *p_scalar,
-	gorec_curve* crv)
+static gorec_table_cache_entry* _gorec_table_cache_find(
+	gorec_table_cache* cache,
+	gorec_point* p, uint32_t hash,
+	int first, int end,
+	int* busy)
 {
 	int i;
-	int t = _gorbn_get_nbits(p_scalar, GORBN_SZARR);
 
-	gorec_pt_clear(p_result);
+	for (i = first; i < end; i++) {
+		gorec_table_cache_entry* entry = &cache->entries[i];
 
-	for (i = t - 1; i >= 0; i--) {
-		gorec_pt_double(p_result, p_result, crv);
+		if (entry->hash != hash || entry->state == GOREC_TABLE_CACHE_FREE) {
+			continue;
+		}
 
-		if (_gorbn_testbit(p_scalar, i)) {
-			gorec_pt_add(p_result, p_result, p_point, crv);
+		if (_gorec_table_cache_pin(entry)) {
+			if (entry->state == GOREC_TABLE_CACHE_READY &&
+				gorbn_cmp(entry->x, p->x) == GORBN_CMP_EQUAL &&
+				gorbn_cmp(entry->y, p->y) == GORBN_CMP_EQUAL)
+			{
+				//NOTE(dima): The clock only moves on misses, so a hot entry is rarely written
+				uint64_t clock = cache->clock;
+				if (entry->last_used != clock) {
+					entry->last_used = clock;
+				}
+				return(entry);
+			}
+
+			_GOREC_ATOMIC_DEC(&entry->users);
+		}
+		else if (entry->state == GOREC_TABLE_CACHE_BUILDING) {
+			*busy = 1;
 		}
 	}
+
+	return(0);
 }
 
-void gorec_pt_mul_jacobian(
-	gorec_point* r,
-	gorec_point* p,
-	gorbn_t* s,
-	gorec_curve* crv)
-{
+/*
+	Finding the table for p, building it on the second miss. Returns 0 if
+	p can not be a key, if it was not missed recently, if another thread is
+	building the same table right now, or if every entry of its set is in
+	use. Every returned entry must be released.
+*/
+static gorec_table_cache_entry* _gorec_table_cache_acquire(gorec_table_cache* cache, gorec_point* p) {
+	gorec_table_cache_entry* Result = 0;
+	gorec_table_cache_entry* victim = 0;
+	uint32_t hash;
+	int set, first, end;
+	int busy = 0;
 	int i;
-	int t = _gorbn_get_nbits(s, GORBN_SZARR);
 
-	gorec_point result;
-	gorbn_t temp[GORBN_SZARR];
-	gorec_pt_clear(&result);
+	if (p->is_inf || !gorbn_is_one(p->z) || cache->entries_count == 0) {
+		return(0);
+	}
 
-	for (i = t - 1; i >= 0; i--) {
-		gorec_pt_double_jacobian(&result, &result, crv);
+	hash = _gorec_table_cache_hash(p->x);
+	set = (int)(hash % (uint32_t)cache->sets_count);
+	first = (int)((int64_t)cache->entries_count * set / cache->sets_count);
+	end = (int)((int64_t)cache->entries_count * (set + 1) / cache->sets_count);
 
-		if (_gorbn_testbit(s, i)) {
-			gorec_pt_add_jacobian(&result, &result, p, crv);
+	Result = _gorec_table_cache_find(cache, p, hash, first, end, &busy);
+	if (Result) {
+		_GOREC_ATOMIC_INC64(&cache->hits);
+		return(Result);
+	}
+
+	_GOREC_SPIN_LOCK(&cache->lock);
+
+	cache->misses++;
+	cache->clock++;
+
+	//NOTE(dima): Another thread may have built it since, or be building it
+	busy = 0;
+	Result = _gorec_table_cache_find(cache, p, hash, first, end, &busy);
+	if (Result || busy) {
+		_GOREC_SPIN_UNLOCK(&cache->lock);
+		return(Result);
+	}
+
+	//NOTE(dima): Admission, the first miss is only remembered
+	for (i = 0; i < cache->recent_count; i++) {
+		if (cache->recent[i] == hash) {
+			break;
 		}
 	}
+	if (i == cache->recent_count) {
+		cache->recent[cache->recent_next] = hash;
+		cache->recent_next = (cache->recent_next + 1) % cache->recent_count;
 
-	//NOTE(dima): Exit from Jacobian coordinates
-	gorbn_sqr_mod(temp, result.z, crv->p);
-	gorbn_inv_mod(temp, temp, crv->p);
-	gorbn_mul_mod(result.x, temp, result.x, crv->p);
+		_GOREC_SPIN_UNLOCK(&cache->lock);
+		return(0);
+	}
+	cache->recent[i] = 0;
+
+	//NOTE(dima): Free entries go first, then the least recently used one. Claiming fails if a hit pinned it meanwhile
+	for (;;) {
+		victim = 0;
+		for (i = first; i < end; i++) {
+			gorec_table_cache_entry* entry = &cache->entries[i];
+
+			if (entry->users == 0 && entry->state != GOREC_TABLE_CACHE_BUILDING) {
+				if (!victim ||
+					(victim->state != GOREC_TABLE_CACHE_FREE &&
+					(entry->state == GOREC_TABLE_CACHE_FREE || entry->last_used < victim->last_used)))
+				{
+					victim = entry;
+				}
+			}
+		}
 
-	gorbn_sqr_mod(temp, result.z, crv->p);
-	gorbn_mul_mod(temp, temp, result.z, crv->p);
-	gorbn_inv_mod(temp, temp, crv->p);
-	gorbn_mul_mod(result.y, temp, result.y, crv->p);
+		if (!victim || _GOREC_ATOMIC_CAS(&victim->users, 0, -1)) {
+			break;
+		}
+	}
 
-	gorbn_from_int(result.z, 1);
+	if (victim) {
+		if (victim->state == GOREC_TABLE_CACHE_READY) {
+			cache->evictions++;
+		}
 
-	gorec_pt_copy(r, &result);
+		victim->state = GOREC_TABLE_CACHE_BUILDING;
+		gorbn_copy(victim->x, p->x);
+		gorbn_copy(victim->y, p->y);
+		victim->hash = hash;
+		victim->last_used = cache->clock;
+	}
+
+	_GOREC_SPIN_UNLOCK(&cache->lock);
+
+	if (victim) {
+		gorec_pt_table_build(&victim->table, p, cache->crv);
+
+		//NOTE(dima): Ready before it can be pinned, the builder is its first user
+		victim->state = GOREC_TABLE_CACHE_READY;
+		(void)_GOREC_ATOMIC_CAS(&victim->users, -1, 1);
+	}
+
+	return(victim);
 }
 
-void gorec_pt_mul_monty(
+static void _gorec_table_cache_release(gorec_table_cache* cache, gorec_table_cache_entry* entry) {
+	(void)cache;
+	_GOREC_ATOMIC_DEC(&entry->users);
+}
+
+void gorec_pt_mul_cached(
 	gorec_point* p_result,
-	gorec_point *p_point,
-	gorbn_t *p_scalar,
-	gorec_curve* crv)
+	gorec_point* p_point,
+	gorbn_t* p_scalar,
+	gorec_table_cache* cache)
 {
-	int t = _gorbn_get_nbits(p_scalar, GORBN_SZARR);
+	gorec_table_cache_entry* entry = _gorec_table_cache_acquire(cache, p_point);
 
-	gorbn_t X1[GORBN_SZARR];
-	gorbn_t Z1[GORBN_SZARR];
-	gorbn_t X2[GORBN_SZARR];
-	gorbn_t Z2[GORBN_SZARR];
-	gorbn_t T[GORBN_SZARR];
+	if (entry) {
+		gorec_pt_mul_base(p_result, p_scalar, &entry->table, cache->crv);
+		_gorec_table_cache_release(cache, entry);
+	}
+	else {
+		gorec_pt_mul_wnaf_jacobian(p_result, p_point, p_scalar, cache->crv);
+	}
+}
 
-	gorbn_t TMP[GORBN_SZARR];
-	gorbn_t TMP2[GORBN_SZARR];
+void gorec_pt_mul_double_cached(
+	gorec_point* p_result,
+	gorbn_t* k1, gorec_point* p1,
+	gorbn_t* k2, gorec_point* p2,
+	gorec_table_cache* cache)
+{
+	gorec_curve* crv = cache->crv;
+	gorec_table_cache_entry* entry1 = _gorec_table_cache_acquire(cache, p1);
+	gorec_table_cache_entry* entry2 = _gorec_table_cache_acquire(cache, p2);
 
-	gorbn_init(X1, GORBN_SZARR);
-	gorbn_init(X2, GORBN_SZARR);
-	gorbn_init(Z1, GORBN_SZARR);
-	gorbn_init(Z2, GORBN_SZARR);
-	gorbn_init(T, GORBN_SZARR);
-	gorbn_init(TMP, GORBN_SZARR);
-	gorbn_init(TMP2, GORBN_SZARR);
-
-	/*X1 <- x*/
-	gorbn_copy(X1, p_point->x);
-	/*Z1 <- 1*/
-	gorbn_from_int(Z1, 1);
-	/*X2 <- x^4 + b*/
-	gorbn_sqr_mod(X2, p_point->x, crv->p);
-	gorbn_sqr_mod(X2, X2, crv->p);
-	gorbn_add_mod(X2, X2, crv->b, crv->p);
-	/*Z2<-x^2*/
-	//gorbn_copy(X2, p_point->x, GORBN_SZARR);
-	gorbn_sqr_mod(Z2, p_point->x, crv->p);
-
-	for (int i = t - 2; i >= 0; i--) {
-		int bit_is_set = _gorbn_testbit(p_scalar, i);
-		if (bit_is_set) {
-			/*T<-Z1*/
-			gorbn_copy(T, Z1);
-			/*Z1 <- (X1Z2 + X2Z1)^2 */
-			gorbn_mul_mod(Z1, X2, Z1, crv->p);
-			gorbn_mul_mod(TMP, X1, Z2, crv->p);
-			gorbn_add_mod(Z1, TMP, Z1, crv->p);
-			gorbn_sqr_mod(Z1, Z1, crv->p);
-			/*X1 <- xZ1 + X1X2TZ2*/
-			gorbn_mul_mod(X1, X1, X2, crv->p);
-			gorbn_mul_mod(X1, X1, T, crv->p);
-			gorbn_mul_mod(X1, X1, Z2, crv->p);
-			gorbn_mul_mod(TMP, p_point->x, Z1, crv->p);
-			gorbn_add_mod(X1, X1, TMP, crv->p);
-			/*T <- X2*/
-			gorbn_copy(T, X2);
-			/*X2 <- X2^4 + b*Z2^4 */
-			gorbn_sqr_mod(X2, X2, crv->p);
-			gorbn_sqr_mod(X2, X2, crv->p);
-			gorbn_sqr_mod(TMP2, Z2, crv->p);
-			gorbn_sqr_mod(TMP, TMP2, crv->p);
-			gorbn_mul_mod(TMP, TMP, crv->b, crv->p);
-			gorbn_add_mod(X2, X2, TMP, crv->p);
-			/*Z2 <- (T^2)(Z2^2)*/
-			gorbn_sqr_mod(TMP, T, crv->p);
-			gorbn_mul_mod(Z2, TMP2, TMP, crv->p);
-		}
-		else {
-			/*T <- Z2*/
-			gorbn_copy(T, Z2);
-			/*Z2 <- (X1Z2 + X2Z1)^2 */
-			gorbn_mul_mod(Z2, X1, Z2, crv->p);
-			gorbn_mul_mod(TMP, X2, Z1, crv->p);
-			gorbn_add_mod(Z2, TMP, Z2, crv->p);
-			gorbn_sqr_mod(Z2, Z2, crv->p);
-			/*X2 <- xZ2 + X1X2Z1T*/
-			gorbn_mul_mod(X2, X1, X2, crv->p);
-			gorbn_mul_mod(X2, X2, Z1, crv->p);
-			gorbn_mul_mod(X2, X2, T, crv->p);
-			gorbn_mul_mod(TMP, Z2, p_point->x, crv->p);
-			gorbn_add_mod(X2, X2, TMP, crv->p);
-			/*T <- X1*/
-			gorbn_copy(T, X1);
-			/*X1 <- (X1^4) + (b * Z1^4) */
-			gorbn_sqr_mod(X1, X1, crv->p);
-			gorbn_sqr_mod(X1, X1, crv->p);
-			gorbn_sqr_mod(TMP2, Z1, crv->p);
-			gorbn_sqr_mod(TMP, TMP2, crv->p);
-			gorbn_mul_mod(TMP, TMP, crv->b, crv->p);
-			gorbn_add_mod(X1, X1, TMP, crv->p);
-			/*Z1 <- T^2 * Z1^2 */
-			gorbn_sqr_mod(TMP, T, crv->p);
-			gorbn_mul_mod(Z1, TMP2, TMP, crv->p);
-		}
-	}
-
-	/*x3 <- X1/Z1*/
-	gorbn_inv_mod(TMP, Z1, crv->p);
-	gorbn_mul_mod(p_result->x, X1, TMP, crv->p);
-
-	/*y3 <- (x + X1/Z1)[(X1 + xZ1)(X2 + xZ2) + (XX + y)(Z1Z2)](xZ1Z2)^-1 + y */
-	gorbn_add_mod(p_result->y, p_point->x, p_result->x, crv->p);
-	gorbn_mul_mod(TMP2, Z1, Z2, crv->p); /*TMP2 = Z1 * Z2;*/
-
-	gorbn_mul_mod(Z1, p_point->x, Z1, crv->p);/*Z1 no longer needed after this operation*/
-	gorbn_add_mod(Z1, Z1, X1, crv->p);/*X1 no longer needed after this operation*/
-
-	gorbn_mul_mod(Z2, p_point->x, Z2, crv->p);/*Z2 no longer needed after this operation*/
-	gorbn_add_mod(Z2, Z2, X2, crv->p);/*X2 no longer needed after this operation*/
-
-	gorbn_mul_mod(Z1, Z1, Z2, crv->p);
-
-	gorbn_sqr_mod(TMP, p_point->x, crv->p);
-	gorbn_add_mod(TMP, TMP, p_point->y, crv->p);
-	gorbn_mul_mod(TMP, TMP, TMP2, crv->p);
-	gorbn_add_mod(TMP, TMP, Z1, crv->p);
-
-	gorbn_mul_mod(TMP2, TMP2, p_point->x, crv->p);
-	gorbn_inv_mod(TMP2, TMP2, crv->p);
-	gorbn_mul_mod(TMP, TMP, TMP2, crv->p);
-	gorbn_mul_mod(p_result->y, p_result->y, TMP, crv->p);
-	gorbn_add_mod(p_result->y, p_result->y, p_point->y, crv->p);
+	gorec_point result1;
+	gorec_point result2;
+
+	if (!entry1 && !entry2) {
+		gorec_pt_mul_double(p_result, k1, p1, k2, p2, crv);
+		return;
+	}
+
+	//NOTE(dima): A cached half needs no doublings, the other one goes through wNAF
+	if (entry1) {
+		_gorec_pt_mul_base_internal(&result1, k1, &entry1->table, crv);
+		_gorec_table_cache_release(cache, entry1);
+	}
+	else {
+		_gorec_pt_mul_wnaf_internal(&result1, p1, k1, crv);
+	}
+
+	if (entry2) {
+		_gorec_pt_mul_base_internal(&result2, k2, &entry2->table, crv);
+		_gorec_table_cache_release(cache, entry2);
+	}
+	else {
+		_gorec_pt_mul_wnaf_internal(&result2, p2, k2, crv);
+	}
+
+	gorec_pt_add_jacobian(&result1, &result1, &result2, crv);
+
+	//NOTE(dima): Exit from Jacobian coordinates
+	_gorec_pt_to_affine_batch(&result1, 1, crv);
+	_gorec_pt_leave(&result1, &result1, crv);
+
+	gorec_pt_copy(p_result, &result1);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,587 @@
+/*
+	Benchmark of the bignum engines in this repo and of every point
+	multiplication method:
+		gorbn_*  - gor_bignum.h
+		BN_*     - bignum_roma.cpp (1-byte limbs)
+		bignum_* - dima_bignum.h
+		bnv_*    - dima_bignum.h, variable-width numbers
+		field_*  - gor_field.h, templates for all three bign levels at once
+		json_*   - dima_json_writer.h, one tracing record per operation,
+		           NDJSON text against CBOR
+
+	Every operation is repeated until it runs at least min_ms milliseconds,
+	then ns/op and cycles/op are reported. The operands are the same random
+	numbers below p of the bign curve for all engines. Results are written
+	to stdout as JSON (see dima_json_writer.h) so that runs of different
+	builds can be diffed. A human-readable table goes to stderr.
+
+	Limb size of gor_bignum is a compile-time setting, so build one binary
+	per configuration and run them all. gorbn_szword in the output tells
+	which one the numbers are for.
+
+	BUILD:
+		g++ -O2 -DGORBN_SZWORD=2 gor_bignum_bench.cpp -o gor_bignum_bench -lpthread
+
+	USAGE:
+		gor_bignum_bench [min_ms] [filter] > bench.json
+
+		filter is a substring of "engine/op", e.g. "gorbn/pt_mul" or "inv_mod".
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#define BENCH_HAS_CYCLES 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#define BENCH_HAS_CYCLES 1
+#else
+#define BENCH_CYCLES() ((uint64_t)0)
+#define BENCH_HAS_CYCLES 0
+#endif
+
+#define GOR_BIGNUM_IMPLEMENTATION
+#include "gor_bignum.h"
+
+#define DIMA_BIGNUM_IMPLEMENTATION
+#include "dima_bignum.h"
+
+#include "bignum_roma.cpp"
+
+#include "gor_field.h"
+
+#define DIMA_JSON_WRITER_IMPLEMENTATION
+#include "dima_json_writer.h"
+
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t bench_field_limb;
+#else
+typedef uint32_t bench_field_limb;
+#endif
+
+typedef gor::Bign128Field<bench_field_limb> bench_field128;
+typedef gor::Bign192Field<bench_field_limb> bench_field192;
+typedef gor::Bign256Field<bench_field_limb> bench_field256;
+
+//NOTE(dima): Must be power of 2
+#define BENCH_OPERANDS_COUNT 16
+#define BENCH_MAX_ITERATIONS (1 << 30)
+
+struct bench_data {
+	gorec_curve Curve;
+	gorec_point Q;
+	gorbn_t A[BENCH_OPERANDS_COUNT][GORBN_SZARR];
+	gorbn_t B[BENCH_OPERANDS_COUNT][GORBN_SZARR];
+	gorbn_t K[BENCH_OPERANDS_COUNT][GORBN_SZARR];
+	gorbn_t Wide[BENCH_OPERANDS_COUNT][GORBN_SZARR * 2];
+	gorbn_t R[GORBN_SZARR * 2];
+	gorec_point Point;
+	gorec_point Points4[GOREC_X4_LANES];
+	gorec_point Results4[GOREC_X4_LANES];
+	gorec_fe_x4 FA4;
+	gorec_fe_x4 FB4;
+	gorec_fe_x4 FR4;
+
+	EC_curve BNCurve;
+	BN_t BNA[BENCH_OPERANDS_COUNT][BN_arr_size];
+	BN_t BNB[BENCH_OPERANDS_COUNT][BN_arr_size];
+	BN_t BNK[BENCH_OPERANDS_COUNT][BN_arr_size];
+	BN_t BNWide[BENCH_OPERANDS_COUNT][BN_arr_size * 2];
+	BN_t BNR[BN_arr_size * 2];
+	EC_point BNPoint;
+
+	struct bn DA[BENCH_OPERANDS_COUNT];
+	struct bn DB[BENCH_OPERANDS_COUNT];
+	struct bn DWide[BENCH_OPERANDS_COUNT];
+	struct bn DBigA[BENCH_OPERANDS_COUNT]; /* 2048-bit, RSA-sized */
+	struct bn DBigB[BENCH_OPERANDS_COUNT];
+	struct bn DBigM; /* odd, above all DBigA */
+	struct bn DP;
+	struct bn DR;
+	struct bn DTmp;
+
+	struct bnv VBigA[BENCH_OPERANDS_COUNT]; /* same values as DBigA */
+	struct bnv VBigB[BENCH_OPERANDS_COUNT];
+	struct bnv VHugeA[BENCH_OPERANDS_COUNT]; /* 8192-bit, over the struct bn limit */
+	struct bnv VHugeB[BENCH_OPERANDS_COUNT];
+	struct bnv VR;
+	struct bnv VQ;
+
+	gor::EcCurve<bench_field128> FCurve128;
+	bench_field128::elem F128A[BENCH_OPERANDS_COUNT];
+	bench_field128::elem F128B[BENCH_OPERANDS_COUNT];
+	bench_field128::elem F128K[BENCH_OPERANDS_COUNT]; /* same scalars as K */
+	bench_field128::elem F128R;
+	gor::EcPoint<bench_field128> FPoint128;
+	bench_field192::elem F192A[BENCH_OPERANDS_COUNT];
+	bench_field192::elem F192B[BENCH_OPERANDS_COUNT];
+	bench_field192::elem F192R;
+	bench_field256::elem F256A[BENCH_OPERANDS_COUNT];
+	bench_field256::elem F256B[BENCH_OPERANDS_COUNT];
+	bench_field256::elem F256R;
+};
+
+static bench_data BenchData;
+static gorec_base_table BenchBaseTable;
+
+//NOTE(dima): Two entries, G and Q stay cached for the whole run
+static gorec_table_cache BenchCache;
+static uint8_t BenchCacheMemory[2 * sizeof(gorec_table_cache_entry) + GORBN_ARENA_ALIGN];
+
+//NOTE(dima): More keys than entries, taken in turn. Admission has to keep this close to the uncached speed
+#define BENCH_THRASH_KEYS 64
+#define BENCH_THRASH_ENTRIES 8
+static gorec_point BenchThrashKeys[BENCH_THRASH_KEYS];
+static int BenchThrashNext;
+static gorec_table_cache BenchThrashCache;
+static uint8_t BenchThrashCacheMemory[BENCH_THRASH_ENTRIES * sizeof(gorec_table_cache_entry) + GORBN_ARENA_ALIGN];
+
+//NOTE(dima): Records mode writers, finished records are dropped every BENCH_RECORDS_BATCH
+#define BENCH_RECORDS_BATCH 1024
+static json_writer BenchTextWriter;
+static json_writer BenchCBORWriter;
+
+/* What a per-operation latency log would write: op, curve, duration, field-op counts, a coordinate */
+static void BenchWriteRecord(json_writer* Writer, gorbn_t* X, int i) {
+	JSONBeginRecord(Writer);
+	JSONAddSTR(Writer, (char*)"op", (char*)"pt_mul");
+	JSONAddSTR(Writer, (char*)"curve", (char*)"bign128");
+	JSONAddU64(Writer, (char*)"ns", 52000 + i * 37);
+	JSONBeginName(Writer, (char*)"field_ops");
+	JSONAddU32(Writer, (char*)"mul", 2950 + i);
+	JSONAddU32(Writer, (char*)"sqr", 1280 + i);
+	JSONAddU32(Writer, (char*)"inv", 1);
+	JSONEnd(Writer);
+	JSONAddDataHex(Writer, (char*)"x", (uint8_t*)X, GORBN_SZARR * GORBN_SZWORD);
+	JSONEndRecord(Writer);
+
+	if (Writer->PendingRecords == BENCH_RECORDS_BATCH) {
+		JSONFlushRecords(Writer);
+	}
+}
+
+static int32_t BenchRecordSize(uint32_t Flags) {
+	json_writer Writer;
+	JSONInit(&Writer, Flags);
+
+	BenchWriteRecord(&Writer, BenchData.K[0], 0);
+	int32_t Result = JSONGetSize(&Writer);
+
+	JSONFree(&Writer);
+
+	return(Result);
+}
+
+#define BENCH_OP_FN(name) void name(bench_data* Data, int i)
+typedef BENCH_OP_FN(bench_op_fn);
+#define BENCH_OP(name) static BENCH_OP_FN(name)
+
+/*NOTE(dima): gor_bignum*/
+BENCH_OP(GorAdd) { gorbn_add(Data->R, Data->A[i], Data->B[i]); }
+BENCH_OP(GorSub) { gorbn_sub(Data->R, Data->A[i], Data->B[i]); }
+BENCH_OP(GorMul) { gorbn_mul(Data->R, Data->A[i], Data->B[i]); }
+BENCH_OP(GorSqr) { gorbn_sqr(Data->R, Data->A[i]); }
+BENCH_OP(GorMod) { gorbn_mod(Data->R, Data->Wide[i], GORBN_SZARR * 2, Data->Curve.p); }
+BENCH_OP(GorMulMod) { gorbn_mul_mod(Data->R, Data->A[i], Data->B[i], Data->Curve.p); }
+BENCH_OP(GorInvMod) { gorbn_inv_mod(Data->R, Data->A[i], Data->Curve.p); }
+BENCH_OP(GorMontMul) { gorbn_mont_mul(Data->R, Data->A[i], Data->B[i], &Data->Curve.mont); }
+BENCH_OP(GorPtMul) { gorec_pt_mul(&Data->Point, &Data->Curve.g, Data->K[i], &Data->Curve); }
+BENCH_OP(GorPtMulJacobian) { gorec_pt_mul_jacobian(&Data->Point, &Data->Curve.g, Data->K[i], &Data->Curve); }
+BENCH_OP(GorPtMulWNAF) { gorec_pt_mul_wnaf_jacobian(&Data->Point, &Data->Curve.g, Data->K[i], &Data->Curve); }
+BENCH_OP(GorPtMulMonty) { gorec_pt_mul_monty(&Data->Point, &Data->Curve.g, Data->K[i], &Data->Curve); }
+BENCH_OP(GorPtMulBase) { gorec_pt_mul_base(&Data->Point, Data->K[i], &BenchBaseTable, &Data->Curve); }
+BENCH_OP(GorPtMulDouble) {
+	gorec_pt_mul_double(
+		&Data->Point,
+		Data->K[i], &Data->Curve.g,
+		Data->K[(i + 1) & (BENCH_OPERANDS_COUNT - 1)], &Data->Q,
+		&Data->Curve);
+}
+BENCH_OP(GorPtMulCached) { gorec_pt_mul_cached(&Data->Point, &Data->Q, Data->K[i], &BenchCache); }
+BENCH_OP(GorPtMulCachedThrash) {
+	gorec_point* Key = &BenchThrashKeys[BenchThrashNext++ % BENCH_THRASH_KEYS];
+	gorec_pt_mul_cached(&Data->Point, Key, Data->K[i], &BenchThrashCache);
+}
+BENCH_OP(GorPtMulDoubleCached) {
+	gorec_pt_mul_double_cached(
+		&Data->Point,
+		Data->K[i], &Data->Curve.g,
+		Data->K[(i + 1) & (BENCH_OPERANDS_COUNT - 1)], &Data->Q,
+		&BenchCache);
+}
+BENCH_OP(GorFeMulX4) { (void)i; gorec_fe_x4_mul(&Data->FR4, &Data->FA4, &Data->FB4, &Data->Curve); }
+//NOTE(dima): One iteration is GOREC_X4_LANES multiplications, K is used as GOREC_X4_LANES consecutive scalars
+BENCH_OP(GorPtMulX4) {
+	gorec_pt_mul_x4(Data->Results4, Data->Points4, Data->K[i & (BENCH_OPERANDS_COUNT - GOREC_X4_LANES)], &Data->Curve);
+}
+
+/*NOTE(dima): bignum_roma. EC_pt_mul_jacobian and EC_pt_mul_monty are declared but not implemented*/
+BENCH_OP(BNAdd) { BN_add(Data->BNR, Data->BNA[i], Data->BNB[i]); }
+BENCH_OP(BNSub) { BN_sub(Data->BNR, Data->BNA[i], Data->BNB[i]); }
+BENCH_OP(BNMul) { BN_mul(Data->BNR, Data->BNA[i], Data->BNB[i]); }
+BENCH_OP(BNSqr) { BN_sqr(Data->BNR, Data->BNA[i]); }
+BENCH_OP(BNMod) { BN_mod(Data->BNR, Data->BNWide[i], BN_arr_size * 2, Data->BNCurve.p); }
+BENCH_OP(BNMulMod) { BN_MulM(Data->BNR, Data->BNA[i], Data->BNB[i], Data->BNCurve.p); }
+BENCH_OP(BNInvMod) { BN_InvM(Data->BNR, Data->BNA[i], Data->BNCurve.p); }
+BENCH_OP(BNPtMul) { EC_pt_mul(&Data->BNPoint, &Data->BNCurve.g, Data->BNK[i], &Data->BNCurve); }
+
+/*NOTE(dima): dima_bignum. It has no modular inversion and no curves*/
+BENCH_OP(DimaAdd) { bignum_add(&Data->DA[i], &Data->DB[i], &Data->DR); }
+BENCH_OP(DimaSub) { bignum_sub(&Data->DA[i], &Data->DB[i], &Data->DR); }
+BENCH_OP(DimaMul) { bignum_mul(&Data->DA[i], &Data->DB[i], &Data->DR); }
+BENCH_OP(DimaSqr) { bignum_mul(&Data->DA[i], &Data->DA[i], &Data->DR); }
+BENCH_OP(DimaMod) { bignum_mod(&Data->DWide[i], &Data->DP, &Data->DR); }
+BENCH_OP(DimaMulMod) {
+	bignum_mul(&Data->DA[i], &Data->DB[i], &Data->DTmp);
+	bignum_mod(&Data->DTmp, &Data->DP, &Data->DR);
+}
+BENCH_OP(DimaMul2048) { bignum_mul(&Data->DBigA[i], &Data->DBigB[i], &Data->DR); }
+BENCH_OP(DimaPowMod2048) { bignum_powmod(&Data->DBigA[i], &Data->DBigB[i], &Data->DBigM, &Data->DR); }
+BENCH_OP(DimaPowModCT2048) { bignum_powmod_ct(&Data->DBigA[i], &Data->DBigB[i], &Data->DBigM, &Data->DR); }
+
+/*NOTE(dima): dima_bignum variable-width numbers. Outputs keep their buffers between calls*/
+BENCH_OP(VarAdd2048) { bnv_add(&Data->VBigA[i], &Data->VBigB[i], &Data->VR); }
+BENCH_OP(VarMul2048) { bnv_mul(&Data->VBigA[i], &Data->VBigB[i], &Data->VR); }
+BENCH_OP(VarMul8192) { bnv_mul(&Data->VHugeA[i], &Data->VHugeB[i], &Data->VR); }
+BENCH_OP(VarDivMod8192) { bnv_divmod(&Data->VHugeA[i], &Data->VBigB[i], &Data->VQ, &Data->VR); }
+
+/*NOTE(dima): gor_field templates, p = 2^256 - 189, 2^384 - 317, 2^512 - 569*/
+BENCH_OP(FieldMul256) { bench_field128::mul(Data->F128R, Data->F128A[i], Data->F128B[i]); }
+BENCH_OP(FieldSqr256) { bench_field128::sqr(Data->F128R, Data->F128A[i]); }
+BENCH_OP(FieldInv256) { bench_field128::inv(Data->F128R, Data->F128A[i]); }
+BENCH_OP(FieldMul384) { bench_field192::mul(Data->F192R, Data->F192A[i], Data->F192B[i]); }
+BENCH_OP(FieldMul512) { bench_field256::mul(Data->F256R, Data->F256A[i], Data->F256B[i]); }
+BENCH_OP(FieldPtMul128) { gor::pt_mul_jacobian(&Data->FPoint128, &Data->FCurve128.g, Data->F128K[i], &Data->FCurve128); }
+
+/*NOTE(dima): dima_json_writer*/
+BENCH_OP(JSONRecordText) { BenchWriteRecord(&BenchTextWriter, Data->K[i], i); }
+BENCH_OP(JSONRecordCBOR) { BenchWriteRecord(&BenchCBORWriter, Data->K[i], i); }
+
+struct bench_op {
+	const char* Engine;
+	const char* Name;
+	bench_op_fn* Func;
+};
+
+static bench_op BenchOps[] = {
+	{ "gorbn", "add", GorAdd },
+	{ "gorbn", "sub", GorSub },
+	{ "gorbn", "mul", GorMul },
+	{ "gorbn", "sqr", GorSqr },
+	{ "gorbn", "mod", GorMod },
+	{ "gorbn", "mul_mod", GorMulMod },
+	{ "gorbn", "inv_mod", GorInvMod },
+	{ "gorbn", "mont_mul", GorMontMul },
+	{ "gorbn", "pt_mul", GorPtMul },
+	{ "gorbn", "pt_mul_jacobian", GorPtMulJacobian },
+	{ "gorbn", "pt_mul_wnaf_jacobian", GorPtMulWNAF },
+	{ "gorbn", "pt_mul_monty", GorPtMulMonty },
+	{ "gorbn", "pt_mul_base", GorPtMulBase },
+	{ "gorbn", "pt_mul_double", GorPtMulDouble },
+	{ "gorbn", "pt_mul_cached", GorPtMulCached },
+	{ "gorbn", "pt_mul_cached_thrash", GorPtMulCachedThrash },
+	{ "gorbn", "pt_mul_double_cached", GorPtMulDoubleCached },
+	{ "gorbn", "fe_mul_x4", GorFeMulX4 },
+	{ "gorbn", "pt_mul_x4", GorPtMulX4 },
+
+	{ "BN", "add", BNAdd },
+	{ "BN", "sub", BNSub },
+	{ "BN", "mul", BNMul },
+	{ "BN", "sqr", BNSqr },
+	{ "BN", "mod", BNMod },
+	{ "BN", "mul_mod", BNMulMod },
+	{ "BN", "inv_mod", BNInvMod },
+	{ "BN", "pt_mul", BNPtMul },
+
+	{ "bignum", "add", DimaAdd },
+	{ "bignum", "sub", DimaSub },
+	{ "bignum", "mul", DimaMul },
+	{ "bignum", "sqr", DimaSqr },
+	{ "bignum", "mod", DimaMod },
+	{ "bignum", "mul_mod", DimaMulMod },
+	{ "bignum", "mul_2048", DimaMul2048 },
+	{ "bignum", "powmod_2048", DimaPowMod2048 },
+	{ "bignum", "powmod_ct_2048", DimaPowModCT2048 },
+
+	{ "bnv", "add_2048", VarAdd2048 },
+	{ "bnv", "mul_2048", VarMul2048 },
+	{ "bnv", "mul_8192", VarMul8192 },
+	{ "bnv", "divmod_8192", VarDivMod8192 },
+
+	{ "field", "mul_256", FieldMul256 },
+	{ "field", "sqr_256", FieldSqr256 },
+	{ "field", "inv_256", FieldInv256 },
+	{ "field", "mul_384", FieldMul384 },
+	{ "field", "mul_512", FieldMul512 },
+	{ "field", "pt_mul_128", FieldPtMul128 },
+
+	{ "json", "record_text", JSONRecordText },
+	{ "json", "record_cbor", JSONRecordCBOR },
+};
+
+struct bench_result {
+	uint64_t Iterations;
+	uint64_t TotalNs;
+	uint64_t TotalCycles;
+};
+
+static uint32_t BenchRandomState = 0x2545F491;
+
+static uint32_t BenchRandom() {
+	uint32_t x = BenchRandomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	BenchRandomState = x;
+
+	return(x);
+}
+
+static void BenchRandomBelow(uint8_t* Bytes, gorbn_t* Num, gorbn_t* Limit) {
+	do {
+		for (int i = 0; i < GORBN_SZARR * GORBN_SZWORD; i++) {
+			Bytes[i] = (uint8_t)BenchRandom();
+		}
+		gorbn_from_data(Num, Bytes, GORBN_SZARR * GORBN_SZWORD);
+	} while (gorbn_cmp(Num, Limit) >= 0 || gorbn_is_zero(Num));
+}
+
+static void BenchPrepare(bench_data* Data) {
+	gorec_load_stb128(&Data->Curve);
+	EC_load_stb128(&Data->BNCurve);
+
+	gorbn_t Seven[GORBN_SZARR];
+	gorbn_init(Seven, GORBN_SZARR);
+	Seven[0] = 7;
+	gorec_pt_mul_wnaf_jacobian(&Data->Q, &Data->Curve.g, Seven, &Data->Curve);
+
+	uint8_t PBytes[GORBN_SZARR * GORBN_SZWORD];
+	gorbn_to_data(PBytes, 0, sizeof(PBytes), Data->Curve.p);
+	bignum_from_data(&Data->DP, PBytes, sizeof(PBytes));
+
+	//NOTE(dima): All engines keep numbers little-endian, so the same bytes give the same values
+	for (int i = 0; i < BENCH_OPERANDS_COUNT; i++) {
+		uint8_t ABytes[GORBN_SZARR * GORBN_SZWORD];
+		uint8_t BBytes[GORBN_SZARR * GORBN_SZWORD];
+		uint8_t KBytes[GORBN_SZARR * GORBN_SZWORD];
+		uint8_t WideBytes[GORBN_SZARR * GORBN_SZWORD * 2];
+
+		BenchRandomBelow(ABytes, Data->A[i], Data->Curve.p);
+		BenchRandomBelow(BBytes, Data->B[i], Data->Curve.p);
+		BenchRandomBelow(KBytes, Data->K[i], Data->Curve.q);
+		gorbn_mul(Data->Wide[i], Data->A[i], Data->B[i]);
+		memcpy(WideBytes, Data->Wide[i], sizeof(WideBytes));
+
+		BN_from_data(Data->BNA[i], ABytes, sizeof(ABytes));
+		BN_from_data(Data->BNB[i], BBytes, sizeof(BBytes));
+		BN_from_data(Data->BNK[i], KBytes, sizeof(KBytes));
+		memcpy(Data->BNWide[i], WideBytes, sizeof(WideBytes));
+
+		bignum_from_data(&Data->DA[i], ABytes, sizeof(ABytes));
+		bignum_from_data(&Data->DB[i], BBytes, sizeof(BBytes));
+		bignum_from_data(&Data->DWide[i], WideBytes, sizeof(WideBytes));
+
+		uint8_t BigBytes[2][256];
+		for (int j = 0; j < (int)sizeof(BigBytes); j++) {
+			((uint8_t*)BigBytes)[j] = (uint8_t)BenchRandom();
+		}
+		BigBytes[0][sizeof(BigBytes[0]) - 1] &= 0x7F;
+		bignum_from_data(&Data->DBigA[i], BigBytes[0], sizeof(BigBytes[0]));
+		bignum_from_data(&Data->DBigB[i], BigBytes[1], sizeof(BigBytes[1]));
+
+		uint8_t HugeBytes[2][1024];
+		for (int j = 0; j < (int)sizeof(HugeBytes); j++) {
+			((uint8_t*)HugeBytes)[j] = (uint8_t)BenchRandom();
+		}
+
+		bnv_init(&Data->VBigA[i], 0);
+		bnv_init(&Data->VBigB[i], 0);
+		bnv_init(&Data->VHugeA[i], 0);
+		bnv_init(&Data->VHugeB[i], 0);
+		bnv_from_data(&Data->VBigA[i], BigBytes[0], sizeof(BigBytes[0]));
+		bnv_from_data(&Data->VBigB[i], BigBytes[1], sizeof(BigBytes[1]));
+		bnv_from_data(&Data->VHugeA[i], HugeBytes[0], sizeof(HugeBytes[0]));
+		bnv_from_data(&Data->VHugeB[i], HugeBytes[1], sizeof(HugeBytes[1]));
+
+		//NOTE(dima): Top bits are cleared so that values are below every p
+		bench_field128::elem::from_data(Data->F128A[i], ABytes, sizeof(ABytes));
+		bench_field128::elem::from_data(Data->F128B[i], BBytes, sizeof(BBytes));
+		bench_field128::elem::from_data(Data->F128K[i], KBytes, sizeof(KBytes));
+		HugeBytes[0][47] = HugeBytes[1][47] = HugeBytes[0][63] = HugeBytes[1][63] = 0;
+		bench_field192::elem::from_data(Data->F192A[i], HugeBytes[0], 48);
+		bench_field192::elem::from_data(Data->F192B[i], HugeBytes[1], 48);
+		bench_field256::elem::from_data(Data->F256A[i], HugeBytes[0], 64);
+		bench_field256::elem::from_data(Data->F256B[i], HugeBytes[1], 64);
+	}
+	bnv_init(&Data->VR, 0);
+	bnv_init(&Data->VQ, 0);
+
+	uint8_t MBytes[256];
+	for (int j = 0; j < (int)sizeof(MBytes); j++) {
+		MBytes[j] = (uint8_t)BenchRandom();
+	}
+	MBytes[0] |= 1;
+	MBytes[sizeof(MBytes) - 1] |= 0x80;
+	bignum_from_data(&Data->DBigM, MBytes, sizeof(MBytes));
+
+	for (int Lane = 0; Lane < GOREC_X4_LANES; Lane++) {
+		Data->Points4[Lane] = (Lane & 1) ? Data->Q : Data->Curve.g;
+		if (Data->Curve.x4.enabled) {
+			gorec_fe_x4_load(&Data->FA4, Lane, Data->A[Lane]);
+			gorec_fe_x4_load(&Data->FB4, Lane, Data->B[Lane]);
+		}
+	}
+
+	gorec_base_table_build(&BenchBaseTable, &Data->Curve);
+	gorec_table_cache_init(&BenchCache, BenchCacheMemory, sizeof(BenchCacheMemory), &Data->Curve);
+
+	for (int KeyIndex = 0; KeyIndex < BENCH_THRASH_KEYS; KeyIndex++) {
+		gorbn_t Multiplier[GORBN_SZARR];
+		gorbn_init(Multiplier, GORBN_SZARR);
+		Multiplier[0] = (gorbn_t)(KeyIndex + 2);
+		gorec_pt_mul_wnaf_jacobian(&BenchThrashKeys[KeyIndex], &Data->Curve.g, Multiplier, &Data->Curve);
+	}
+	gorec_table_cache_init(&BenchThrashCache, BenchThrashCacheMemory, sizeof(BenchThrashCacheMemory), &Data->Curve);
+
+	gor::curve_load_stb128(&Data->FCurve128);
+
+	JSONInit(&BenchTextWriter);
+	JSONInit(&BenchCBORWriter, JSONWriterFlag_CBOR);
+}
+
+static void BenchMeasure(bench_op* Op, bench_data* Data, uint64_t MinNs, bench_result* Result) {
+	uint64_t Iterations = 1;
+
+	//NOTE(dima): Warm up caches and branch predictors
+	Op->Func(Data, 0);
+
+	for (;;) {
+		std::chrono::steady_clock::time_point Begin = std::chrono::steady_clock::now();
+		uint64_t BeginCycles = BENCH_CYCLES();
+
+		for (uint64_t i = 0; i < Iterations; i++) {
+			Op->Func(Data, (int)(i & (BENCH_OPERANDS_COUNT - 1)));
+		}
+
+		uint64_t EndCycles = BENCH_CYCLES();
+		std::chrono::steady_clock::time_point End = std::chrono::steady_clock::now();
+
+		uint64_t Ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(End - Begin).count();
+		if (Ns >= MinNs || Iterations >= BENCH_MAX_ITERATIONS) {
+			Result->Iterations = Iterations;
+			Result->TotalNs = Ns;
+			Result->TotalCycles = EndCycles - BeginCycles;
+			break;
+		}
+
+		//NOTE(dima): Jump close to the target, but never more than 16x at once
+		uint64_t Next = Iterations * 2;
+		if (Ns > 0) {
+			uint64_t Estimate = Iterations * MinNs / Ns + 1;
+			if (Estimate > Next) {
+				Next = (Estimate < Iterations * 16) ? Estimate : Iterations * 16;
+			}
+		}
+		Iterations = Next;
+	}
+}
+
+int main(int ArgsCount, char** Args) {
+	int MinMs = 200;
+	const char* Filter = 0;
+
+	if (ArgsCount > 1) {
+		MinMs = atoi(Args[1]);
+	}
+	if (ArgsCount > 2) {
+		Filter = Args[2];
+	}
+
+	BenchPrepare(&BenchData);
+
+	json_writer Writer;
+	//NOTE(dima): Streaming straight to stdout, the report can be of any size
+	JSONInitFD(&Writer, 1, JSONWriterFlag_Pretty);
+
+	JSONBegin(&Writer);
+	JSONAddSTR(&Writer, (char*)"bench", (char*)"gor_bignum");
+	JSONAddS32(&Writer, (char*)"gorbn_szword", GORBN_SZWORD);
+	JSONAddS32(&Writer, (char*)"gorbn_bits", GORBN_SZARR_BITS_TOTAL);
+	JSONAddS32(&Writer, (char*)"bn_szword", BN_SZWORD);
+	JSONAddS32(&Writer, (char*)"dbn_szword", DBN_SZWORD);
+	JSONAddS32(&Writer, (char*)"field_kind", BenchData.Curve.field_kind);
+	JSONAddS32(&Writer, (char*)"x4_enabled", BenchData.Curve.x4.enabled);
+	JSONAddS32(&Writer, (char*)"x4_simd", gorec_x4_simd());
+	JSONAddS32(&Writer, (char*)"min_ms", MinMs);
+	JSONAddS32(&Writer, (char*)"has_cycles", BENCH_HAS_CYCLES);
+
+	fprintf(stderr, "gorbn_szword %d, %d ms per op\n", GORBN_SZWORD, MinMs);
+	fprintf(stderr, "%-8s %-22s %14s %14s %12s\n", "engine", "op", "ns/op", "cycles/op", "iterations");
+
+	JSONBeginArr(&Writer, (char*)"results");
+	for (int OpIndex = 0; OpIndex < (int)(sizeof(BenchOps) / sizeof(BenchOps[0])); OpIndex++) {
+		bench_op* Op = &BenchOps[OpIndex];
+
+		char FullName[64];
+		snprintf(FullName, sizeof(FullName), "%s/%s", Op->Engine, Op->Name);
+		if (Filter && !strstr(FullName, Filter)) {
+			continue;
+		}
+
+		bench_result Result;
+		BenchMeasure(Op, &BenchData, (uint64_t)MinMs * 1000000, &Result);
+
+		double NsPerOp = (double)Result.TotalNs / (double)Result.Iterations;
+		double CyclesPerOp = (double)Result.TotalCycles / (double)Result.Iterations;
+
+		fprintf(stderr, "%-8s %-22s %14.1f %14.1f %12llu\n",
+			Op->Engine, Op->Name,
+			NsPerOp, CyclesPerOp,
+			(unsigned long long)Result.Iterations);
+
+		//NOTE(dima): The writer has no floats, so exact totals go along with rounded per-op values
+		JSONBegin(&Writer);
+		JSONAddSTR(&Writer, (char*)"engine", (char*)Op->Engine);
+		JSONAddSTR(&Writer, (char*)"op", (char*)Op->Name);
+		JSONAddU64(&Writer, (char*)"iterations", Result.Iterations);
+		JSONAddU64(&Writer, (char*)"total_ns", Result.TotalNs);
+		JSONAddU64(&Writer, (char*)"total_cycles", Result.TotalCycles);
+		JSONAddU64(&Writer, (char*)"ps_per_op", (uint64_t)(NsPerOp * 1000.0 + 0.5));
+		JSONAddU64(&Writer, (char*)"cycles_per_op", (uint64_t)(CyclesPerOp + 0.5));
+		JSONEnd(&Writer);
+	}
+	JSONEndArr(&Writer);
+
+	gorec_table_cache_stats CacheStats;
+	gorec_table_cache_get_stats(&BenchCache, &CacheStats);
+	JSONAddU64(&Writer, (char*)"table_cache_hits", CacheStats.hits);
+	JSONAddU64(&Writer, (char*)"table_cache_misses", CacheStats.misses);
+	gorec_table_cache_get_stats(&BenchThrashCache, &CacheStats);
+	JSONAddU64(&Writer, (char*)"table_cache_thrash_hits", CacheStats.hits);
+	JSONAddU64(&Writer, (char*)"table_cache_thrash_misses", CacheStats.misses);
+
+	int32_t RecordText = BenchRecordSize(JSONWriterFlag_None);
+	int32_t RecordCBOR = BenchRecordSize(JSONWriterFlag_CBOR);
+	fprintf(stderr, "json record bytes: text %d, cbor %d\n", RecordText, RecordCBOR);
+
+	JSONBeginName(&Writer, (char*)"record_bytes");
+	JSONAddS32(&Writer, (char*)"text", RecordText);
+	JSONAddS32(&Writer, (char*)"cbor", RecordCBOR);
+	JSONEnd(&Writer);
+	JSONEnd(&Writer);
+
+	JSONFlush(&Writer);
+	JSONFree(&Writer);
+	JSONFree(&BenchTextWriter);
+	JSONFree(&BenchCBORWriter);
+
+	return(0);
+}
@@ -0,0 +1,259 @@
+/*
+	Timing leakage test for gor_bignum point multiplication (dudect style).
+
+	Two classes of inputs are interleaved at random: class 0 uses a fixed
+	scalar with few bits set, class 1 uses random scalars. Execution times
+	of both classes are compared with Welch's t-test, both over all
+	measurements and after cropping the slowest ones at several percentiles.
+	|t| above 4.5 means that timings depend on the scalar.
+
+	Reference: O. Reparaz, J. Balasch, I. Verbauwhede,
+	"Dude, is my code constant time?", 2017.
+
+	BUILD:
+		g++ -O2 gor_bignum_dudect.cpp -o gor_bignum_dudect -lpthread
+
+	USAGE:
+		gor_bignum_dudect [ladder|wnaf|base] [rounds] [measurements_per_round]
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DUDECT_CYCLES() __rdtsc()
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define DUDECT_CYCLES() __rdtsc()
+#else
+#include <chrono>
+#define DUDECT_CYCLES() ((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count())
+#endif
+
+#define GOR_BIGNUM_IMPLEMENTATION
+#include "gor_bignum.h"
+
+#define DUDECT_PERCENTILES_COUNT 32
+#define DUDECT_TESTS_COUNT (DUDECT_PERCENTILES_COUNT + 1)
+#define DUDECT_T_THRESHOLD 4.5
+
+enum {
+	DudectMethod_Ladder,
+	DudectMethod_WNAF,
+	DudectMethod_Base,
+};
+
+struct dudect_ttest {
+	double Mean[2];
+	double M2[2];
+	double N[2];
+};
+
+static void DudectTTestPush(dudect_ttest* Test, double Value, int Class) {
+	//NOTE(dima): Welford's online mean and variance
+	Test->N[Class] += 1.0;
+
+	double Delta = Value - Test->Mean[Class];
+	Test->Mean[Class] += Delta / Test->N[Class];
+	Test->M2[Class] += Delta * (Value - Test->Mean[Class]);
+}
+
+static double DudectTTestCompute(dudect_ttest* Test) {
+	if (Test->N[0] < 2.0 || Test->N[1] < 2.0) {
+		return(0.0);
+	}
+
+	double Var0 = Test->M2[0] / (Test->N[0] - 1.0);
+	double Var1 = Test->M2[1] / (Test->N[1] - 1.0);
+	double Den = sqrt(Var0 / Test->N[0] + Var1 / Test->N[1]);
+
+	double Result = 0.0;
+	if (Den > 0.0) {
+		Result = (Test->Mean[0] - Test->Mean[1]) / Den;
+	}
+
+	return(Result);
+}
+
+static int DudectCmpU64(const void* A, const void* B) {
+	uint64_t a = *(const uint64_t*)A;
+	uint64_t b = *(const uint64_t*)B;
+
+	return((a > b) - (a < b));
+}
+
+static uint32_t DudectRandomState = 0x12345678;
+
+static uint32_t DudectRandom() {
+	//NOTE(dima): xorshift32, good enough for picking classes and scalars
+	uint32_t x = DudectRandomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	DudectRandomState = x;
+
+	return(x);
+}
+
+static void DudectRandomScalar(gorbn_t* Scalar, gorec_curve* Curve) {
+	uint8_t Bytes[GORBN_SZARR * GORBN_SZWORD];
+
+	do {
+		for (int i = 0; i < (int)sizeof(Bytes); i++) {
+			Bytes[i] = (uint8_t)DudectRandom();
+		}
+		gorbn_from_data(Scalar, Bytes, sizeof(Bytes));
+	} while (gorbn_cmp(Scalar, Curve->q) >= 0 || gorbn_is_zero(Scalar));
+}
+
+static gorec_base_table DudectBaseTable;
+
+static void DudectRun(
+	int Method,
+	gorec_curve* Curve,
+	gorbn_t* Scalar)
+{
+	gorec_point Result;
+
+	switch (Method) {
+		case DudectMethod_Ladder: {
+			gorec_pt_mul_monty(&Result, &Curve->g, Scalar, Curve);
+		}break;
+
+		case DudectMethod_WNAF: {
+			gorec_pt_mul_wnaf_jacobian(&Result, &Curve->g, Scalar, Curve);
+		}break;
+
+		case DudectMethod_Base: {
+			gorec_pt_mul_base(&Result, Scalar, &DudectBaseTable, Curve);
+		}break;
+	}
+}
+
+int main(int ArgsCount, char** Args) {
+	int Method = DudectMethod_Ladder;
+	char* MethodName = (char*)"ladder";
+	int RoundsCount = 10;
+	int MeasurementsCount = 1000;
+
+	if (ArgsCount > 1) {
+		MethodName = Args[1];
+		if (strcmp(MethodName, "wnaf") == 0) {
+			Method = DudectMethod_WNAF;
+		}
+		else if (strcmp(MethodName, "base") == 0) {
+			Method = DudectMethod_Base;
+		}
+		else if (strcmp(MethodName, "ladder") != 0) {
+			fprintf(stderr, "Unknown method %s. Use ladder, wnaf or base\n", MethodName);
+			return(1);
+		}
+	}
+	if (ArgsCount > 2) {
+		RoundsCount = atoi(Args[2]);
+	}
+	if (ArgsCount > 3) {
+		MeasurementsCount = atoi(Args[3]);
+	}
+
+	gorec_curve Curve;
+	gorec_load_stb128(&Curve);
+	if (Method == DudectMethod_Base) {
+		gorec_base_table_build(&DudectBaseTable, &Curve);
+	}
+
+	gorbn_t* Scalars = (gorbn_t*)malloc(sizeof(gorbn_t) * GORBN_SZARR * MeasurementsCount);
+	int* Classes = (int*)malloc(sizeof(int) * MeasurementsCount);
+	uint64_t* Times = (uint64_t*)malloc(sizeof(uint64_t) * MeasurementsCount);
+	uint64_t* Sorted = (uint64_t*)malloc(sizeof(uint64_t) * MeasurementsCount);
+
+	//NOTE(dima): Fixed class scalar - only a few bits set
+	gorbn_t FixedScalar[GORBN_SZARR];
+	gorbn_init(FixedScalar, GORBN_SZARR);
+	FixedScalar[0] = 1;
+	FixedScalar[GORBN_SZARR - 1] = (gorbn_t)1 << (GORBN_SZWORD_BITS - 2);
+
+	dudect_ttest Tests[DUDECT_TESTS_COUNT];
+	memset(Tests, 0, sizeof(Tests));
+	uint64_t Percentiles[DUDECT_PERCENTILES_COUNT];
+	int PercentilesReady = 0;
+
+	printf("method %s, %d rounds x %d measurements\n", MethodName, RoundsCount, MeasurementsCount);
+
+	for (int RoundIndex = 0; RoundIndex < RoundsCount; RoundIndex++) {
+		//NOTE(dima): Preparing inputs before measuring
+		for (int i = 0; i < MeasurementsCount; i++) {
+			gorbn_t* Scalar = Scalars + (size_t)i * GORBN_SZARR;
+
+			Classes[i] = DudectRandom() & 1;
+			if (Classes[i] == 0) {
+				gorbn_copy(Scalar, FixedScalar);
+			}
+			else {
+				DudectRandomScalar(Scalar, &Curve);
+			}
+		}
+
+		for (int i = 0; i < MeasurementsCount; i++) {
+			uint64_t Begin = DUDECT_CYCLES();
+			DudectRun(Method, &Curve, Scalars + (size_t)i * GORBN_SZARR);
+			uint64_t End = DUDECT_CYCLES();
+
+			Times[i] = End - Begin;
+		}
+
+		//NOTE(dima): Cropping thresholds are taken from the first round
+		if (!PercentilesReady) {
+			memcpy(Sorted, Times, sizeof(uint64_t) * MeasurementsCount);
+			qsort(Sorted, MeasurementsCount, sizeof(uint64_t), DudectCmpU64);
+
+			for (int i = 0; i < DUDECT_PERCENTILES_COUNT; i++) {
+				double Which = 1.0 - pow(0.5, 10.0 * (double)(i + 1) / DUDECT_PERCENTILES_COUNT);
+				Percentiles[i] = Sorted[(int)(Which * (MeasurementsCount - 1))];
+			}
+			PercentilesReady = 1;
+		}
+
+		for (int i = 0; i < MeasurementsCount; i++) {
+			double Value = (double)Times[i];
+
+			DudectTTestPush(&Tests[0], Value, Classes[i]);
+			for (int j = 0; j < DUDECT_PERCENTILES_COUNT; j++) {
+				if (Times[i] < Percentiles[j]) {
+					DudectTTestPush(&Tests[j + 1], Value, Classes[i]);
+				}
+			}
+		}
+
+		double MaxT = 0.0;
+		int MaxTIndex = 0;
+		for (int i = 0; i < DUDECT_TESTS_COUNT; i++) {
+			double T = fabs(DudectTTestCompute(&Tests[i]));
+			if (T > MaxT) {
+				MaxT = T;
+				MaxTIndex = i;
+			}
+		}
+
+		printf("round %3d: measurements %8.0f, max |t| = %7.2f (test %2d), mean cycles fixed %.0f random %.0f -> %s\n",
+			RoundIndex,
+			Tests[0].N[0] + Tests[0].N[1],
+			MaxT,
+			MaxTIndex,
+			Tests[0].Mean[0],
+			Tests[0].Mean[1],
+			(MaxT > DUDECT_T_THRESHOLD) ? "LEAKAGE" : "no leakage detected yet");
+		fflush(stdout);
+	}
+
+	free(Scalars);
+	free(Classes);
+	free(Times);
+	free(Sorted);
+
+	return(0);
+}
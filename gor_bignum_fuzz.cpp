@@ -0,0 +1,1896 @@
+/*
+	Differential fuzz target for the bignum engines and point multiplications.
+
+	Every input is turned into operands that are fed to gorbn_* (gor_bignum.h),
+	BN_* (bignum_roma.cpp) and bignum_* (dima_bignum.h), and the results are
+	compared. Point multiplications are compared between all gorec methods
+	and EC_pt_mul, and with stb128 forced into Montgomery form, which other
+	curves get. Any disagreement is a bug in one of them.
+
+	The dima_bignum checks use operands up to the full struct bn width. They
+	are expanded from the input bytes (see FuzzExpand()) and compared against
+	plain references built here or from other bignum_* functions. struct bnv
+	is compared against struct bn, and past its width checked by round trips
+	with an allocator that can be made to fail.
+
+	gor_field.h point multiplication is compared with gorec_pt_mul_jacobian
+	for every limb type, its 384- and 512-bit fields with bignum_* modulo p.
+
+	dima_json_writer.h strings are parsed back here, written to the buffer
+	and to a sink, and its SSE2 escape scan is compared with a plain one.
+	Its CBOR output is decoded back by a small decoder here.
+
+	Input layout (missing bytes are zeros):
+		byte 0       - check selector, see FuzzCheck()
+		bytes 1..32  - a
+		bytes 33..64 - b
+		bytes 65..96 - k1
+		bytes 97..   - k2
+	Numbers are little-endian. Scalars are reduced modulo q. When bit 7 of
+	the selector is set, k1 is the small number byte[65], when bit 6 is set
+	it is q - byte[65], to hit 0, 1, q-1 and other edge scalars often.
+
+	BUILD (libFuzzer, minimization with -minimize_crash=1):
+		clang++ -O1 -g -fsanitize=fuzzer,address -DGOR_BIGNUM_FUZZ_LIBFUZZER gor_bignum_fuzz.cpp -o gor_bignum_fuzz
+
+	BUILD (standalone, with its own random inputs and minimizer):
+		g++ -O2 -DGORBN_SZWORD=8 gor_bignum_fuzz.cpp -o gor_bignum_fuzz -lpthread
+
+	With 4-byte words struct bn is below the Toom-3 cutoff, so also run builds
+	that reach it, with lowered cutoffs and with narrower words:
+		g++ -O2 -DDBN_KARATSUBA_CUTOFF=4 -DDBN_TOOM3_CUTOFF=9 gor_bignum_fuzz.cpp -o gor_bignum_fuzz_cutoffs -lpthread
+		g++ -O2 -DDBN_SZWORD=2 gor_bignum_fuzz.cpp -o gor_bignum_fuzz_w2 -lpthread
+
+	USAGE (standalone):
+		gor_bignum_fuzz [-runs N] [-seed S] [input files to replay...]
+
+		A failing input is minimized and written to gor_bignum_fuzz_crash.bin,
+		which can be replayed by passing it back as an argument.
+
+	The bee2 fragment in ecurva.h is not self-contained (qr_o, ww*, zz*
+	primitives are missing), so ecMulA() is not part of the comparison.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GOR_BIGNUM_IMPLEMENTATION
+#include "gor_bignum.h"
+#include "gor_field.h"
+
+#define DIMA_BIGNUM_IMPLEMENTATION
+#include "dima_bignum.h"
+
+#include "bignum_roma.cpp"
+
+#define DIMA_JSON_WRITER_IMPLEMENTATION
+#include "dima_json_writer.h"
+
+#define FUZZ_NUM_BYTES 32
+#define FUZZ_INPUT_SIZE (1 + FUZZ_NUM_BYTES * 4)
+#define FUZZ_CRASH_FILE "gor_bignum_fuzz_crash.bin"
+
+//NOTE(dima): Whole struct bn in bytes
+#define FUZZ_DIMA_BYTES (DBN_SZARR * DBN_SZWORD)
+//NOTE(dima): struct bnv operands go past struct bn, into the Karatsuba with scratch from the allocator
+#define FUZZ_BNV_BYTES (FUZZ_DIMA_BYTES * 4)
+
+//NOTE(dima): Point multiplication goes through all limb types, wider fields only through the one the bench uses
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t fuzz_field_limb;
+#else
+typedef uint32_t fuzz_field_limb;
+#endif
+
+enum {
+	FuzzCheck_Mul,
+	FuzzCheck_Sqr,
+	FuzzCheck_Mod,
+	FuzzCheck_Div,
+	FuzzCheck_MulMod,
+	FuzzCheck_AddSubMod,
+	FuzzCheck_InvMod,
+	FuzzCheck_PtMul,
+	FuzzCheck_PtMulSlow,
+	FuzzCheck_PtMulDouble,
+	FuzzCheck_PtMulBatch,
+	FuzzCheck_PtMulX4,
+	FuzzCheck_PtMulCached,
+	FuzzCheck_PtMulMont,
+	FuzzCheck_DimaMul,
+	FuzzCheck_DimaPowMod,
+	FuzzCheck_DimaDivMod,
+	FuzzCheck_DimaBarrett,
+	FuzzCheck_DimaBnv,
+	FuzzCheck_DimaBnvWide,
+	FuzzCheck_FieldPtMul,
+	FuzzCheck_FieldOps,
+	FuzzCheck_JSONEscape,
+	FuzzCheck_JSONCBOR,
+
+	FuzzCheck_Count,
+};
+
+struct fuzz_state {
+	gorec_curve Curve;
+	gorec_point Q; /* 7 * G */
+	gorec_base_table BaseTable;
+
+	//NOTE(dima): Room for one table only, so G and 7G keep evicting each other
+	gorec_table_cache Cache;
+	uint8_t CacheMemory[sizeof(gorec_table_cache_entry) + GORBN_ARENA_ALIGN];
+
+	//NOTE(dima): stb128 with Montgomery form forced, gorec_curve_prepare() picks Crandall reduction for it
+	gorec_curve MontCurve;
+	gorec_base_table MontBaseTable;
+
+	EC_curve BNCurve;
+	struct bn DP;
+
+	int Initialized;
+};
+
+static fuzz_state FuzzState;
+
+//NOTE(dima): Name of the failed comparison. Fixed strings only, so that it can be compared by pointer
+static const char* FuzzFailure;
+
+static int FuzzExpect(int Condition, const char* What) {
+	if (!Condition && !FuzzFailure) {
+		FuzzFailure = What;
+	}
+
+	return(Condition);
+}
+
+static void FuzzInit() {
+	fuzz_state* State = &FuzzState;
+
+	if (State->Initialized) {
+		return;
+	}
+
+	gorec_load_stb128(&State->Curve);
+	EC_load_stb128(&State->BNCurve);
+
+	gorbn_t Seven[GORBN_SZARR];
+	gorbn_init(Seven, GORBN_SZARR);
+	Seven[0] = 7;
+	gorec_pt_mul_wnaf_jacobian(&State->Q, &State->Curve.g, Seven, &State->Curve);
+
+	bignum_from_data(&State->DP, State->Curve.p, FUZZ_NUM_BYTES);
+
+	gorec_base_table_build(&State->BaseTable, &State->Curve);
+
+	State->MontCurve = State->Curve;
+	State->MontCurve.field_kind = GOREC_FIELD_MONT;
+	State->MontCurve.crand_c = 0;
+	gorbn_to_mont(State->MontCurve.a_repr, State->MontCurve.a, &State->MontCurve.mont);
+	State->MontCurve.x4.enabled = 0;
+	gorec_base_table_build(&State->MontBaseTable, &State->MontCurve);
+	gorec_table_cache_init(&State->Cache, State->CacheMemory, sizeof(State->CacheMemory), &State->Curve);
+
+	State->Initialized = 1;
+}
+
+static int FuzzPointsEqual(gorec_point* A, gorec_point* B) {
+	if (A->is_inf || B->is_inf) {
+		return(A->is_inf == B->is_inf);
+	}
+
+	return(gorbn_cmp(A->x, B->x) == GORBN_CMP_EQUAL &&
+		gorbn_cmp(A->y, B->y) == GORBN_CMP_EQUAL);
+}
+
+//NOTE(dima): dima_bignum numbers are much wider, the rest of them must be zero
+static int FuzzDimaEqual(struct bn* D, void* Bytes, int BytesCount) {
+	uint8_t* At = (uint8_t*)D->array;
+
+	int Result = memcmp(At, Bytes, BytesCount) == 0;
+	for (int i = BytesCount; i < (int)sizeof(D->array); i++) {
+		Result &= At[i] == 0;
+	}
+
+	return(Result);
+}
+
+static void FuzzScalar(gorbn_t* K, uint8_t Selector, const uint8_t* Bytes, gorec_curve* Curve) {
+	gorbn_from_data(K, (void*)Bytes, FUZZ_NUM_BYTES);
+	gorbn_mod(K, K, GORBN_SZARR, Curve->q);
+
+	if (Selector & 0xC0) {
+		gorbn_t Small[GORBN_SZARR];
+		gorbn_init(Small, GORBN_SZARR);
+		Small[0] = Bytes[0];
+
+		if (Selector & 0x80) {
+			gorbn_copy(K, Small);
+		}
+		else {
+			gorbn_sub(K, Curve->q, Small);
+			gorbn_mod(K, K, GORBN_SZARR, Curve->q);
+		}
+	}
+}
+
+/*
+	NOTE(dima): dima_bignum operands are longer than the input. They are
+	expanded from 8 input bytes with xorshift, Pattern 1 makes them sparse
+	and 2 saturated, as FuzzRandomInput() does.
+*/
+static void FuzzExpand(uint8_t* To, int Count, const uint8_t* Seed, int Pattern) {
+	uint64_t State = 0xCBF29CE484222325ull;
+	for (int i = 0; i < 8; i++) {
+		State = (State ^ Seed[i]) * 0x100000001B3ull;
+	}
+	State |= 1;
+
+	for (int i = 0; i < Count; i++) {
+		State ^= State << 13;
+		State ^= State >> 7;
+		State ^= State << 17;
+
+		uint8_t Byte = (uint8_t)(State >> 24);
+		if (Pattern == 1 && (State & 3)) {
+			Byte = 0;
+		}
+		else if (Pattern == 2 && (State & 3)) {
+			Byte = 0xFF;
+		}
+		To[i] = Byte;
+	}
+}
+
+/* Length in bytes from 1 to Max. Bit 7 picks lengths right below Max, where the truncation is */
+static int FuzzWideLength(uint8_t Byte, int Max) {
+	if (Byte & 0x80) {
+		int Result = Max - (Byte & 0x0F);
+		return((Result > 1) ? Result : 1);
+	}
+
+	return(1 + (Byte * Max) / 128);
+}
+
+/* Zero-padded number of Count random bytes, see FuzzExpand() */
+static void FuzzWideNumber(uint8_t* To, int Count, const uint8_t* Seed, uint8_t Pattern) {
+	memset(To, 0, FUZZ_DIMA_BYTES);
+	FuzzExpand(To, Count, Seed, Pattern % 3);
+}
+
+/* r = a * b truncated to Count bytes. Schoolbook on bytes, it shares nothing with the engines */
+static void FuzzMulBytes(uint8_t* R, const uint8_t* A, int ACount, const uint8_t* B, int BCount, int Count) {
+	memset(R, 0, Count);
+
+	for (int i = 0; i < ACount && i < Count; i++) {
+		uint32_t Carry = 0;
+		int j;
+		for (j = 0; j < BCount && i + j < Count; j++) {
+			Carry += (uint32_t)A[i] * B[j] + R[i + j];
+			R[i + j] = (uint8_t)Carry;
+			Carry >>= 8;
+		}
+		for (; Carry && i + j < Count; j++) {
+			Carry += R[i + j];
+			R[i + j] = (uint8_t)Carry;
+			Carry >>= 8;
+		}
+	}
+}
+
+static int FuzzDimaWords(struct bn* A) {
+	int Result = DBN_SZARR;
+	while (Result > 0 && A->array[Result - 1] == 0) {
+		Result--;
+	}
+
+	return(Result);
+}
+
+static int FuzzDimaBit(struct bn* A, int Bit) {
+	return((A->array[Bit / (DBN_SZWORD * 8)] >> (Bit % (DBN_SZWORD * 8))) & 1);
+}
+
+/* r = a^e mod m, square-and-multiply with bignum_mul and bignum_mod. m is at most half of struct bn */
+static void FuzzPowModReference(struct bn* A, struct bn* E, struct bn* M, struct bn* R) {
+	struct bn Base, One, T;
+	bignum_mod(A, M, &Base);
+	bignum_from_int(&One, 1);
+	bignum_mod(&One, M, R);
+
+	int Bit = FUZZ_DIMA_BYTES * 8 - 1;
+	while (Bit >= 0 && !FuzzDimaBit(E, Bit)) {
+		Bit--;
+	}
+
+	for (; Bit >= 0; Bit--) {
+		bignum_mul(R, R, &T);
+		bignum_mod(&T, M, R);
+
+		if (FuzzDimaBit(E, Bit)) {
+			bignum_mul(R, &Base, &T);
+			bignum_mod(&T, M, R);
+		}
+	}
+}
+
+/*
+	NOTE(dima): Allocator for struct bnv that fails after Left allocations
+	(never while Left is negative) and counts what is still allocated, so
+	that a free with a wrong size or a leak shows up.
+*/
+struct fuzz_allocator {
+	int Left;
+	int Live;
+	size_t Bytes;
+};
+
+static DBN_ALLOC(FuzzAlloc) {
+	fuzz_allocator* Allocator = (fuzz_allocator*)user;
+	if (Allocator->Left == 0) {
+		return(0);
+	}
+	if (Allocator->Left > 0) {
+		Allocator->Left--;
+	}
+
+	Allocator->Live++;
+	Allocator->Bytes += size;
+	return(malloc(size));
+}
+
+static DBN_FREE(FuzzFree) {
+	fuzz_allocator* Allocator = (fuzz_allocator*)user;
+	Allocator->Live--;
+	Allocator->Bytes -= size;
+	free(ptr);
+}
+
+//NOTE(dima): Also checks that the top word of V is not zero, the other bnv functions rely on it
+static int FuzzBnvEqual(struct bnv* V, struct bn* D) {
+	struct bn T;
+	int Result = bnv_to_bn(&T, V) && bignum_cmp(&T, D) == DIMA_BIGNUM_CMP_EQUAL;
+	Result &= V->used <= V->alloc && (V->used == 0 || V->array[V->used - 1] != 0);
+
+	return(Result);
+}
+
+/* Output of an operation on x and y: Z, or x or y themselves when Alias is 1 or 2 */
+static struct bnv* FuzzBnvOut(struct bnv* X, struct bnv* Y, struct bnv* Z, struct bnv* A, struct bnv* B, int Alias) {
+	bnv_copy(X, A);
+	bnv_copy(Y, B);
+
+	return((Alias == 1) ? X : ((Alias == 2) ? Y : Z));
+}
+
+/* gor::pt_mul_jacobian with Limb limbs vs Ref, which is k * p from gorec */
+template<class Limb>
+static int FuzzFieldPtMulEqual(gorec_point* P, gorbn_t* K, gorec_point* Ref) {
+	typedef gor::Bign128Field<Limb> field;
+	typedef typename field::elem elem;
+
+	gor::EcCurve<field> Curve;
+	gor::curve_load_stb128(&Curve);
+
+	gor::EcPoint<field> Pt, R;
+	elem::from_data(Pt.x, P->x, FUZZ_NUM_BYTES);
+	elem::from_data(Pt.y, P->y, FUZZ_NUM_BYTES);
+	elem::from_uint(Pt.z, 1);
+	Pt.is_inf = P->is_inf;
+
+	elem Scalar;
+	elem::from_data(Scalar, K, FUZZ_NUM_BYTES);
+	gor::pt_mul_jacobian(&R, &Pt, Scalar, &Curve);
+
+	if (R.is_inf || Ref->is_inf) {
+		return(R.is_inf && Ref->is_inf);
+	}
+
+	uint8_t X[FUZZ_NUM_BYTES], Y[FUZZ_NUM_BYTES];
+	elem::to_data(X, FUZZ_NUM_BYTES, R.x);
+	elem::to_data(Y, FUZZ_NUM_BYTES, R.y);
+
+	return(memcmp(X, Ref->x, FUZZ_NUM_BYTES) == 0 && memcmp(Y, Ref->y, FUZZ_NUM_BYTES) == 0);
+}
+
+/*
+	NOTE(dima): gor::CrandField arithmetic against bignum_* and bignum_mod by
+	p, which shares nothing with the folding by C. Bits 6 and 7 of Edge put a
+	and b right below p, at p - 1 - the first seed byte: squares of those are
+	the products whose second fold wraps. Bit 5 makes b zero.
+*/
+template<class Field>
+static void FuzzFieldOps(const uint8_t* ASeed, const uint8_t* BSeed, uint8_t Edge) {
+	typedef typename Field::elem elem;
+	enum { Bytes = Field::Bits / 8 };
+
+	uint8_t WA[Bytes], WB[Bytes], WR[Bytes];
+	elem P, A, B, R;
+	Field::prime(P);
+	elem::to_data(WR, Bytes, P);
+
+	struct bn DP, DA, DB, DR, DT;
+	bignum_from_data(&DP, WR, Bytes);
+
+	FuzzExpand(WA, Bytes, ASeed, Edge % 3);
+	FuzzExpand(WB, Bytes, BSeed, (Edge / 3) % 3);
+	bignum_from_data(&DT, WA, Bytes);
+	bignum_mod(&DT, &DP, &DA);
+	bignum_from_data(&DT, WB, Bytes);
+	bignum_mod(&DT, &DP, &DB);
+
+	if (Edge & 0x40) {
+		bignum_from_int(&DT, 1 + ASeed[0]);
+		bignum_sub(&DP, &DT, &DA);
+	}
+	if (Edge & 0x80) {
+		bignum_from_int(&DT, 1 + BSeed[0]);
+		bignum_sub(&DP, &DT, &DB);
+	}
+	if (Edge & 0x20) {
+		bignum_init(&DB);
+	}
+
+	elem::from_data(A, DA.array, Bytes);
+	elem::from_data(B, DB.array, Bytes);
+
+	Field::mul(R, A, B);
+	elem::to_data(WR, Bytes, R);
+	bignum_mul(&DA, &DB, &DT);
+	bignum_mod(&DT, &DP, &DR);
+	FuzzExpect(FuzzDimaEqual(&DR, WR, Bytes), "field: mul vs bignum_mul and bignum_mod");
+
+	Field::sqr(R, A);
+	elem::to_data(WR, Bytes, R);
+	bignum_mul(&DA, &DA, &DT);
+	bignum_mod(&DT, &DP, &DR);
+	FuzzExpect(FuzzDimaEqual(&DR, WR, Bytes), "field: sqr vs bignum_mul and bignum_mod");
+
+	Field::add(R, A, B);
+	elem::to_data(WR, Bytes, R);
+	bignum_add(&DA, &DB, &DT);
+	bignum_mod(&DT, &DP, &DR);
+	FuzzExpect(FuzzDimaEqual(&DR, WR, Bytes), "field: add vs bignum_add and bignum_mod");
+
+	Field::sub(R, A, B);
+	elem::to_data(WR, Bytes, R);
+	bignum_add(&DA, &DP, &DT);
+	bignum_sub(&DT, &DB, &DR);
+	bignum_mod(&DR, &DP, &DT);
+	FuzzExpect(FuzzDimaEqual(&DT, WR, Bytes), "field: sub vs bignum_sub and bignum_mod");
+
+	//NOTE(dima): a * a^-1 has to be 1, there is no other inversion modulo p to compare with
+	if (!bignum_is_zero(&DA)) {
+		Field::inv(R, A);
+		elem::to_data(WR, Bytes, R);
+		bignum_from_data(&DR, WR, Bytes);
+		bignum_mul(&DA, &DR, &DT);
+		bignum_mod(&DT, &DP, &DR);
+		bignum_from_int(&DT, 1);
+		FuzzExpect(bignum_cmp(&DR, &DT) == DIMA_BIGNUM_CMP_EQUAL, "field: a * inv(a) vs 1");
+
+		bignum_from_data(&DR, WR, Bytes);
+		FuzzExpect(bignum_cmp(&DR, &DP) == DIMA_BIGNUM_CMP_SMALLER, "field: inv(a) below p");
+	}
+}
+
+/* Everything a sink writer hands out, in one growing block */
+struct fuzz_sink {
+	char* Data;
+	int32_t Size;
+	int32_t Capacity;
+};
+
+static DIMA_JSON_WRITER_SINK(FuzzSinkAppend) {
+	fuzz_sink* Sink = (fuzz_sink*)User;
+
+	if (Sink->Size + Size > Sink->Capacity) {
+		Sink->Capacity = (Sink->Size + Size) * 2;
+		Sink->Data = (char*)realloc(Sink->Data, Sink->Capacity);
+	}
+	memcpy(Sink->Data + Sink->Size, Data, Size);
+	Sink->Size += Size;
+
+	return(1);
+}
+
+/* JSONScanPlain byte by byte, the way it goes without SSE2 */
+static int32_t FuzzScanPlain(const uint8_t* Str, int32_t Len) {
+	int32_t i = 0;
+
+	while (i < Len && Str[i] != '\"' && Str[i] != '\\' && Str[i] >= 0x20) {
+		i++;
+	}
+
+	return(i);
+}
+
+/*
+	NOTE(dima): Lengths for the escaping checks. Below 128 they are around
+	the 16-byte SSE2 step, then random up to 512, and the top 16 go past
+	one sink chunk, so the sink gets the string in two pieces.
+*/
+static int32_t FuzzJSONLength(uint8_t Byte) {
+	static const int32_t Lengths[] = { 0, 1, 15, 16, 17, 31, 32, 33, 48 };
+
+	if (Byte < 0x80) {
+		return(Lengths[Byte % (sizeof(Lengths) / sizeof(Lengths[0]))]);
+	}
+	if (Byte < 0xF0) {
+		return(1 + (Byte & 0x7F) * 4);
+	}
+
+	return(DIMA_JSON_WRITER_SINK_CHUNK - 8 + (Byte & 0x0F));
+}
+
+/*
+	NOTE(dima): Bytes for the escaping checks. Pattern 3 takes them only
+	from around the escaping rules: quote, backslash, the edges of the
+	control chars, DEL and bytes with the top bit set, which go as is.
+*/
+static void FuzzJSONBytes(uint8_t* To, int32_t Count, const uint8_t* Seed, uint8_t Pattern) {
+	static const uint8_t Edges[] = { '\"', '\\', 0x00, '\n', 0x1F, 0x20, '/', 'a', 0x7F, 0x80, 0xFF };
+
+	FuzzExpand(To, Count, Seed, Pattern % 4);
+	if (Pattern % 4 == 3) {
+		for (int32_t i = 0; i < Count; i++) {
+			To[i] = Edges[To[i] % sizeof(Edges)];
+		}
+	}
+}
+
+static void FuzzJSONSkipSpace(const char** At, const char* End) {
+	while (*At < End && (**At == ' ' || **At == '\t' || **At == '\n')) {
+		(*At)++;
+	}
+}
+
+static int FuzzHexDigit(char c) {
+	if (c >= '0' && c <= '9') return(c - '0');
+	if (c >= 'A' && c <= 'F') return(c - 'A' + 10);
+	if (c >= 'a' && c <= 'f') return(c - 'a' + 10);
+	return(-1);
+}
+
+/*
+	Reads the JSON string starting at the quote at *At into To. Fails on
+	anything the writer must not produce: a raw control char, an unknown
+	escape or \u above 0xFF.
+*/
+static int FuzzJSONParseString(const char** At, const char* End, uint8_t* To, int32_t* ToLen) {
+	const char* From = *At;
+	int32_t Len = 0;
+
+	if (From >= End || *From++ != '\"') {
+		return(0);
+	}
+
+	for (;;) {
+		if (From >= End) {
+			return(0);
+		}
+
+		uint8_t c = (uint8_t)*From++;
+		if (c == '\"') {
+			break;
+		}
+		if (c < 0x20) {
+			return(0);
+		}
+		if (c != '\\') {
+			To[Len++] = c;
+			continue;
+		}
+
+		if (From >= End) {
+			return(0);
+		}
+		switch (*From++) {
+			case '\"': To[Len++] = '\"'; break;
+			case '\\': To[Len++] = '\\'; break;
+			case '/': To[Len++] = '/'; break;
+			case 'b': To[Len++] = '\b'; break;
+			case 'f': To[Len++] = '\f'; break;
+			case 'n': To[Len++] = '\n'; break;
+			case 'r': To[Len++] = '\r'; break;
+			case 't': To[Len++] = '\t'; break;
+			case 'u': {
+				int Code = 0;
+				for (int i = 0; i < 4; i++) {
+					int Digit = (From < End) ? FuzzHexDigit(*From++) : -1;
+					if (Digit < 0) {
+						return(0);
+					}
+					Code = Code * 16 + Digit;
+				}
+				if (Code > 0xFF) {
+					return(0);
+				}
+				To[Len++] = (uint8_t)Code;
+			}break;
+			default: {
+				return(0);
+			}
+		}
+	}
+
+	*At = From;
+	*ToLen = Len;
+	return(1);
+}
+
+/* Doc has to be exactly { "Key": "Value" }, with any whitespace between */
+static int FuzzJSONParseDoc(const char* Doc, int32_t Size, const uint8_t* Key, int32_t KeyLen, const uint8_t* Value, int32_t ValueLen) {
+	const char* At = Doc;
+	const char* End = Doc + Size;
+	uint8_t* Parsed = (uint8_t*)malloc(Size + 1);
+	int32_t ParsedLen = 0;
+	int Result = 0;
+
+	FuzzJSONSkipSpace(&At, End);
+	if (At < End && *At++ == '{') {
+		FuzzJSONSkipSpace(&At, End);
+		if (FuzzJSONParseString(&At, End, Parsed, &ParsedLen) &&
+			ParsedLen == KeyLen && memcmp(Parsed, Key, KeyLen) == 0 &&
+			At < End && *At++ == ':')
+		{
+			FuzzJSONSkipSpace(&At, End);
+			if (FuzzJSONParseString(&At, End, Parsed, &ParsedLen) &&
+				ParsedLen == ValueLen && memcmp(Parsed, Value, ValueLen) == 0)
+			{
+				FuzzJSONSkipSpace(&At, End);
+				if (At < End && *At++ == '}') {
+					FuzzJSONSkipSpace(&At, End);
+					Result = (At == End);
+				}
+			}
+		}
+	}
+
+	free(Parsed);
+	return(Result);
+}
+
+//NOTE(dima): Enough for every item FuzzCBORWrite() writes
+#define FUZZ_CBOR_ITEMS 256
+
+/* Head of one CBOR data item. Data is where the bytes of a string are, Arg is their count */
+struct fuzz_cbor_item {
+	int Major;
+	uint64_t Arg;
+	int Indefinite;
+	const uint8_t* Data;
+};
+
+/* The items a document has to decode to, in order */
+struct fuzz_cbor_doc {
+	fuzz_cbor_item Items[FUZZ_CBOR_ITEMS];
+	int Count;
+};
+
+/*
+	Decodes the item head at *At and steps over it and the bytes of a
+	string. Fails if the input ends early, if the argument is not in its
+	shortest form, which the writer always picks, and on the reserved
+	additional info 28..30.
+*/
+static int FuzzCBORNext(const uint8_t** At, const uint8_t* End, fuzz_cbor_item* Item) {
+	if (*At >= End) {
+		return(0);
+	}
+
+	uint8_t Initial = *(*At)++;
+	int Info = Initial & 0x1F;
+
+	Item->Major = Initial >> 5;
+	Item->Arg = 0;
+	Item->Indefinite = 0;
+	Item->Data = 0;
+
+	if (Info < 24) {
+		Item->Arg = (uint64_t)Info;
+	}
+	else if (Info <= 27) {
+		int Size = 1 << (Info - 24);
+		if (End - *At < Size) {
+			return(0);
+		}
+		for (int i = 0; i < Size; i++) {
+			Item->Arg = (Item->Arg << 8) | *(*At)++;
+		}
+
+		//NOTE(dima): 1 byte is for 24 and up, 2 bytes for 2^8 and up, 4 for 2^16, 8 for 2^32
+		uint64_t Min = (Size == 1) ? 24 : ((uint64_t)1 << (Size * 4));
+		if (Item->Arg < Min) {
+			return(0);
+		}
+	}
+	else if (Info == 31) {
+		Item->Indefinite = 1;
+	}
+	else {
+		return(0);
+	}
+
+	if ((Item->Major == 2 || Item->Major == 3) && !Item->Indefinite) {
+		if ((uint64_t)(End - *At) < Item->Arg) {
+			return(0);
+		}
+		Item->Data = *At;
+		*At += Item->Arg;
+	}
+
+	return(1);
+}
+
+/*
+	Steps over one whole data item. An indefinite map or array has to end
+	with a break, and a map has to have a value for every key. Definite
+	ones, tags and simple values the writer never writes.
+*/
+static int FuzzCBORSkip(const uint8_t** At, const uint8_t* End, int Depth) {
+	fuzz_cbor_item Item;
+
+	if (Depth > DIMA_JSON_WRITER_MAX_DEPTH || !FuzzCBORNext(At, End, &Item)) {
+		return(0);
+	}
+
+	if (Item.Major == 4 || Item.Major == 5) {
+		int Count = 0;
+
+		if (!Item.Indefinite) {
+			return(0);
+		}
+		while (*At < End && **At != 0xFF) {
+			if (!FuzzCBORSkip(At, End, Depth + 1)) {
+				return(0);
+			}
+			Count++;
+		}
+		if (*At == End) {
+			return(0);
+		}
+		(*At)++;
+
+		return(Item.Major == 4 || (Count % 2) == 0);
+	}
+
+	return(Item.Major <= 3 && !Item.Indefinite);
+}
+
+/* Decodes the whole document and compares it item by item with Doc */
+static int FuzzCBOREqual(const char* Data, int32_t Size, fuzz_cbor_doc* Doc) {
+	const uint8_t* At = (const uint8_t*)Data;
+	const uint8_t* End = At + Size;
+
+	if (!FuzzCBORSkip(&At, End, 0) || At != End) {
+		return(0);
+	}
+
+	At = (const uint8_t*)Data;
+	for (int i = 0; i < Doc->Count; i++) {
+		fuzz_cbor_item* Want = &Doc->Items[i];
+		fuzz_cbor_item Item;
+
+		if (!FuzzCBORNext(&At, End, &Item) ||
+			Item.Major != Want->Major ||
+			Item.Arg != Want->Arg ||
+			Item.Indefinite != Want->Indefinite)
+		{
+			return(0);
+		}
+		if (Item.Data && memcmp(Item.Data, Want->Data, (size_t)Item.Arg) != 0) {
+			return(0);
+		}
+	}
+
+	return(At == End);
+}
+
+static void FuzzCBORPush(fuzz_cbor_doc* Doc, int Major, uint64_t Arg, int Indefinite, const void* Data) {
+	fuzz_cbor_item* Item = &Doc->Items[Doc->Count++];
+
+	Item->Major = Major;
+	Item->Arg = Arg;
+	Item->Indefinite = Indefinite;
+	Item->Data = (const uint8_t*)Data;
+}
+
+static void FuzzCBORPushKey(fuzz_cbor_doc* Doc, const char* Key) {
+	FuzzCBORPush(Doc, 3, strlen(Key), 0, Key);
+}
+
+//NOTE(dima): Negative n is major type 1 with argument -1 - n, which can not overflow for n < 0
+static void FuzzCBORPushSigned(fuzz_cbor_doc* Doc, int64_t Value) {
+	if (Value < 0) {
+		FuzzCBORPush(Doc, 1, (uint64_t)(-1 - Value), 0, 0);
+	}
+	else {
+		FuzzCBORPush(Doc, 0, (uint64_t)Value, 0, 0);
+	}
+}
+
+/*
+	NOTE(dima): Writes the same document to any writer and the items it
+	has to decode to into Doc. Integers go through every argument size
+	edge, and Random is put at all of them by a shift. Byte strings of
+	BytesLen have heads of every size up to 4 bytes.
+*/
+static void FuzzCBORWrite(json_writer* Writer, fuzz_cbor_doc* Doc, uint64_t Random, uint8_t* Bytes, int32_t BytesLen, int Depth) {
+	static const uint64_t Unsigned[] = {
+		0, 1, 23, 24, 255, 256, 65535, 65536,
+		0xFFFFFFFFull, 0x100000000ull, 0xFFFFFFFFFFFFFFFFull,
+	};
+	static const int64_t Signed[] = {
+		INT64_MIN, INT64_MIN + 1, -1, -24, -25, -256, -257, -65536, -65537,
+		-(int64_t)0x100000000ll, -(int64_t)0x100000001ll, INT64_MAX,
+	};
+
+	Doc->Count = 0;
+
+	JSONBegin(Writer);
+	FuzzCBORPush(Doc, 5, 0, 1, 0);
+
+	for (int i = 0; i < (int)(sizeof(Unsigned) / sizeof(Unsigned[0])); i++) {
+		JSONAddU64(Writer, (char*)"u", Unsigned[i]);
+		FuzzCBORPushKey(Doc, "u");
+		FuzzCBORPush(Doc, 0, Unsigned[i], 0, 0);
+	}
+	for (int i = 0; i < (int)(sizeof(Signed) / sizeof(Signed[0])); i++) {
+		JSONAddS64(Writer, (char*)"s", Signed[i]);
+		FuzzCBORPushKey(Doc, "s");
+		FuzzCBORPushSigned(Doc, Signed[i]);
+	}
+
+	JSONAddU32(Writer, (char*)"u32", 0xFFFFFFFFu);
+	FuzzCBORPushKey(Doc, "u32");
+	FuzzCBORPush(Doc, 0, 0xFFFFFFFFu, 0, 0);
+
+	JSONAddS32(Writer, (char*)"s32", INT32_MIN);
+	FuzzCBORPushKey(Doc, "s32");
+	FuzzCBORPushSigned(Doc, INT32_MIN);
+
+	for (int Shift = 0; Shift < 64; Shift += 7) {
+		JSONAddU64(Writer, (char*)"ur", Random >> Shift);
+		FuzzCBORPushKey(Doc, "ur");
+		FuzzCBORPush(Doc, 0, Random >> Shift, 0, 0);
+
+		JSONAddS64(Writer, (char*)"sr", (int64_t)Random >> Shift);
+		FuzzCBORPushKey(Doc, "sr");
+		FuzzCBORPushSigned(Doc, (int64_t)Random >> Shift);
+	}
+
+	JSONAddDataHex(Writer, (char*)"b", Bytes, BytesLen);
+	FuzzCBORPushKey(Doc, "b");
+	FuzzCBORPush(Doc, 2, (uint64_t)BytesLen, 0, Bytes);
+
+	//NOTE(dima): No data is written as 0, not as an empty string
+	JSONAddDataHex(Writer, (char*)"b0", 0, 0);
+	FuzzCBORPushKey(Doc, "b0");
+	FuzzCBORPush(Doc, 0, 0, 0, 0);
+
+	JSONAddSTRLen(Writer, (char*)"t", 1, (char*)Bytes, (BytesLen < 300) ? BytesLen : 300);
+	FuzzCBORPushKey(Doc, "t");
+	FuzzCBORPush(Doc, 3, (uint64_t)((BytesLen < 300) ? BytesLen : 300), 0, Bytes);
+
+	//NOTE(dima): Nested maps, each one with an array of empty and one-entry maps in it
+	for (int Level = 0; Level < Depth; Level++) {
+		JSONBeginName(Writer, (char*)"m");
+		FuzzCBORPushKey(Doc, "m");
+		FuzzCBORPush(Doc, 5, 0, 1, 0);
+
+		JSONBeginArr(Writer, (char*)"a");
+		FuzzCBORPushKey(Doc, "a");
+		FuzzCBORPush(Doc, 4, 0, 1, 0);
+
+		JSONBegin(Writer);
+		FuzzCBORPush(Doc, 5, 0, 1, 0);
+		JSONEnd(Writer);
+		FuzzCBORPush(Doc, 7, 0, 1, 0);
+
+		JSONBegin(Writer);
+		FuzzCBORPush(Doc, 5, 0, 1, 0);
+		JSONAddS32(Writer, (char*)"l", -Level);
+		FuzzCBORPushKey(Doc, "l");
+		FuzzCBORPushSigned(Doc, -Level);
+		JSONEnd(Writer);
+		FuzzCBORPush(Doc, 7, 0, 1, 0);
+
+		JSONEndArr(Writer);
+		FuzzCBORPush(Doc, 7, 0, 1, 0);
+	}
+	for (int Level = 0; Level < Depth; Level++) {
+		JSONEnd(Writer);
+		FuzzCBORPush(Doc, 7, 0, 1, 0);
+	}
+
+	JSONEnd(Writer);
+	FuzzCBORPush(Doc, 7, 0, 1, 0);
+}
+
+/*
+	NOTE(dima): Returns 0 if all engines agree, otherwise the name of the
+	first failed comparison.
+*/
+static const char* FuzzCheck(const uint8_t* Data, size_t Size) {
+	FuzzInit();
+	FuzzFailure = 0;
+
+	uint8_t In[FUZZ_INPUT_SIZE];
+	memset(In, 0, sizeof(In));
+	memcpy(In, Data, (Size < sizeof(In)) ? Size : sizeof(In));
+
+	uint8_t Selector = In[0];
+	uint8_t* ABytes = In + 1;
+	uint8_t* BBytes = ABytes + FUZZ_NUM_BYTES;
+	uint8_t* K1Bytes = BBytes + FUZZ_NUM_BYTES;
+	uint8_t* K2Bytes = K1Bytes + FUZZ_NUM_BYTES;
+
+	gorec_curve* Curve = &FuzzState.Curve;
+	gorbn_t* P = Curve->p;
+
+	gorbn_t A[GORBN_SZARR];
+	gorbn_t B[GORBN_SZARR];
+	gorbn_from_data(A, ABytes, FUZZ_NUM_BYTES);
+	gorbn_from_data(B, BBytes, FUZZ_NUM_BYTES);
+
+	BN_t BNA[BN_arr_size];
+	BN_t BNB[BN_arr_size];
+	BN_from_data(BNA, ABytes, FUZZ_NUM_BYTES);
+	BN_from_data(BNB, BBytes, FUZZ_NUM_BYTES);
+
+	struct bn DA, DB, DR, DT;
+	bignum_from_data(&DA, ABytes, FUZZ_NUM_BYTES);
+	bignum_from_data(&DB, BBytes, FUZZ_NUM_BYTES);
+
+	gorbn_t R[GORBN_SZARR * 2];
+	gorbn_t T[GORBN_SZARR * 2];
+	BN_t BNR[BN_arr_size * 2];
+
+	switch ((Selector & 0x3F) % FuzzCheck_Count) {
+		case FuzzCheck_Mul: {
+			gorbn_mul(R, A, B);
+			BN_mul(BNR, BNA, BNB);
+			bignum_mul(&DA, &DB, &DR);
+
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES * 2) == 0, "mul: gorbn vs BN");
+			FuzzExpect(FuzzDimaEqual(&DR, R, FUZZ_NUM_BYTES * 2), "mul: gorbn vs bignum");
+		}break;
+
+		case FuzzCheck_Sqr: {
+			gorbn_sqr(R, A);
+			gorbn_mul(T, A, A);
+			BN_sqr(BNR, BNA);
+
+			FuzzExpect(memcmp(R, T, FUZZ_NUM_BYTES * 2) == 0, "sqr: gorbn_sqr vs gorbn_mul");
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES * 2) == 0, "sqr: gorbn vs BN");
+		}break;
+
+		case FuzzCheck_Mod: {
+			//NOTE(dima): 512-bit dividend made of a and b
+			gorbn_t Wide[GORBN_SZARR * 2];
+			uint8_t WideBytes[FUZZ_NUM_BYTES * 2];
+			memcpy(WideBytes, ABytes, FUZZ_NUM_BYTES * 2);
+			memcpy(Wide, WideBytes, sizeof(WideBytes));
+
+			BN_t BNWide[BN_arr_size * 2];
+			memcpy(BNWide, WideBytes, sizeof(WideBytes));
+
+			struct bn DWide;
+			bignum_from_data(&DWide, WideBytes, sizeof(WideBytes));
+
+			gorbn_mod(R, Wide, GORBN_SZARR * 2, P);
+			BN_mod(BNR, BNWide, BN_arr_size * 2, FuzzState.BNCurve.p);
+			bignum_mod(&DWide, &FuzzState.DP, &DR);
+
+			FuzzExpect(gorbn_cmp(R, P) == GORBN_CMP_SMALLER, "mod: gorbn result not reduced");
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES) == 0, "mod: gorbn vs BN");
+			FuzzExpect(FuzzDimaEqual(&DR, R, FUZZ_NUM_BYTES), "mod: gorbn vs bignum");
+		}break;
+
+		case FuzzCheck_Div: {
+			//NOTE(dima): Divisor of 1 to 32 bytes from k1. Bit 6 makes its top limb one byte
+			//            and bit 7 that byte small, there the quotient estimate is far off before normalization
+			int YCount = 1 + K2Bytes[0] % FUZZ_NUM_BYTES;
+			if (Selector & 0x40) {
+				YCount = 1 + GORBN_SZWORD * (K2Bytes[0] % (FUZZ_NUM_BYTES / GORBN_SZWORD));
+			}
+
+			uint8_t YBytes[FUZZ_NUM_BYTES];
+			memset(YBytes, 0, sizeof(YBytes));
+			memcpy(YBytes, K1Bytes, YCount);
+			if (Selector & 0x80) {
+				YBytes[YCount - 1] = K2Bytes[1] & 3;
+			}
+			if (YBytes[YCount - 1] == 0) {
+				YBytes[YCount - 1] = 1;
+			}
+
+			gorbn_t Y[GORBN_SZARR];
+			gorbn_t Q[GORBN_SZARR];
+			gorbn_t Rem[GORBN_SZARR];
+			gorbn_from_data(Y, YBytes, FUZZ_NUM_BYTES);
+
+			struct bn DY, DQ;
+			bignum_from_data(&DY, YBytes, FUZZ_NUM_BYTES);
+
+			gorbn_div(Q, Rem, A, GORBN_SZARR, Y, GORBN_SZARR);
+			bignum_divmod(&DA, &DY, &DQ, &DR);
+			FuzzExpect(FuzzDimaEqual(&DQ, Q, FUZZ_NUM_BYTES), "div: gorbn quotient vs bignum_divmod");
+			FuzzExpect(FuzzDimaEqual(&DR, Rem, FUZZ_NUM_BYTES), "div: gorbn remainder vs bignum_divmod");
+
+			gorbn_mul(R, Q, Y);
+			gorbn_add(T, R, Rem);
+			FuzzExpect(gorbn_is_zero(R + GORBN_SZARR) && gorbn_cmp(T, A) == GORBN_CMP_EQUAL, "div: q * y + r != x");
+			FuzzExpect(gorbn_cmp(Rem, Y) == GORBN_CMP_SMALLER, "div: remainder not below divisor");
+
+			//NOTE(dima): 512-bit dividend made of a and b, only the remainder fits
+			gorbn_t Wide[GORBN_SZARR * 2];
+			uint8_t WideBytes[FUZZ_NUM_BYTES * 2];
+			memcpy(WideBytes, ABytes, FUZZ_NUM_BYTES * 2);
+			memcpy(Wide, WideBytes, sizeof(WideBytes));
+
+			struct bn DWide;
+			bignum_from_data(&DWide, WideBytes, sizeof(WideBytes));
+
+			gorbn_mod(Rem, Wide, GORBN_SZARR * 2, Y);
+			bignum_mod(&DWide, &DY, &DR);
+			FuzzExpect(FuzzDimaEqual(&DR, Rem, FUZZ_NUM_BYTES), "div: gorbn_mod of 512 bits vs bignum_mod");
+		}break;
+
+		case FuzzCheck_MulMod: {
+			gorbn_mul_mod(R, A, B, P);
+			BN_MulM(BNR, BNA, BNB, FuzzState.BNCurve.p);
+			bignum_mul(&DA, &DB, &DT);
+			bignum_mod(&DT, &FuzzState.DP, &DR);
+
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES) == 0, "mul_mod: gorbn vs BN");
+			FuzzExpect(FuzzDimaEqual(&DR, R, FUZZ_NUM_BYTES), "mul_mod: gorbn vs bignum");
+
+			//NOTE(dima): Montgomery and Crandall paths need reduced inputs
+			gorbn_t AR[GORBN_SZARR], BR[GORBN_SZARR];
+			gorbn_t AM[GORBN_SZARR], BM[GORBN_SZARR];
+			gorbn_mod(AR, A, GORBN_SZARR, P);
+			gorbn_mod(BR, B, GORBN_SZARR, P);
+
+			gorbn_to_mont(AM, AR, &Curve->mont);
+			gorbn_to_mont(BM, BR, &Curve->mont);
+			gorbn_mont_mul(T, AM, BM, &Curve->mont);
+			gorbn_from_mont(T, T, &Curve->mont);
+			FuzzExpect(gorbn_cmp(T, R) == GORBN_CMP_EQUAL, "mul_mod: gorbn_mul_mod vs gorbn_mont_mul");
+
+			gorbn_t CR[GORBN_SZARR * 2];
+			gorbn_mul(CR, AR, BR);
+			gorbn_red_crand(T, CR, GORBN_SZARR, Curve->crand_c);
+			FuzzExpect(gorbn_cmp(T, R) == GORBN_CMP_EQUAL, "mul_mod: gorbn_mul_mod vs gorbn_red_crand");
+		}break;
+
+		case FuzzCheck_AddSubMod: {
+			gorbn_mod(A, A, GORBN_SZARR, P);
+			gorbn_mod(B, B, GORBN_SZARR, P);
+			memcpy(BNA, A, FUZZ_NUM_BYTES);
+			memcpy(BNB, B, FUZZ_NUM_BYTES);
+
+			gorbn_add_mod(R, A, B, P);
+			BN_AddM(BNR, BNA, BNB, FuzzState.BNCurve.p);
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES) == 0, "add_mod: gorbn vs BN");
+
+			gorbn_sub_mod(R, A, B, P);
+			BN_SubM(BNR, BNA, BNB, FuzzState.BNCurve.p);
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES) == 0, "sub_mod: gorbn vs BN");
+
+			gorbn_add_mod(T, R, B, P);
+			FuzzExpect(gorbn_cmp(T, A) == GORBN_CMP_EQUAL, "sub_mod: (a - b) + b != a");
+		}break;
+
+		case FuzzCheck_InvMod: {
+			gorbn_mod(A, A, GORBN_SZARR, P);
+			if (gorbn_is_zero(A)) {
+				break;
+			}
+			memcpy(BNA, A, FUZZ_NUM_BYTES);
+
+			gorbn_inv_mod(R, A, P);
+			BN_InvM(BNR, BNA, FuzzState.BNCurve.p);
+			FuzzExpect(memcmp(R, BNR, FUZZ_NUM_BYTES) == 0, "inv_mod: gorbn vs BN");
+
+			gorbn_mul_mod(T, R, A, P);
+			FuzzExpect(gorbn_is_one(T), "inv_mod: a * a^-1 != 1");
+		}break;
+
+		case FuzzCheck_PtMul: {
+			gorbn_t K[GORBN_SZARR];
+			FuzzScalar(K, Selector, K1Bytes, Curve);
+
+			gorec_point Ref, Pt;
+			gorec_pt_mul_wnaf_jacobian(&Ref, &Curve->g, K, Curve);
+
+			gorec_pt_mul_jacobian(&Pt, &Curve->g, K, Curve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul: wnaf_jacobian vs jacobian");
+
+			gorec_pt_mul_monty(&Pt, &Curve->g, K, Curve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul: wnaf_jacobian vs monty");
+
+			gorec_pt_mul_base(&Pt, K, &FuzzState.BaseTable, Curve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul: wnaf_jacobian vs base");
+
+			//NOTE(dima): Same check on an arbitrary point
+			gorec_point RefQ;
+			gorec_pt_mul_wnaf_jacobian(&RefQ, &FuzzState.Q, K, Curve);
+			gorec_pt_mul_monty(&Pt, &FuzzState.Q, K, Curve);
+			FuzzExpect(FuzzPointsEqual(&RefQ, &Pt), "pt_mul: wnaf_jacobian vs monty on 7G");
+		}break;
+
+		case FuzzCheck_PtMulSlow: {
+			gorbn_t K[GORBN_SZARR];
+			FuzzScalar(K, Selector, K1Bytes, Curve);
+
+			gorec_point Ref, Pt;
+			gorec_pt_mul_wnaf_jacobian(&Ref, &Curve->g, K, Curve);
+
+			gorec_pt_mul(&Pt, &Curve->g, K, Curve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul: wnaf_jacobian vs affine");
+
+			BN_t BNK[BN_arr_size];
+			memcpy(BNK, K, FUZZ_NUM_BYTES);
+
+			EC_point BNPt;
+			EC_pt_mul(&BNPt, &FuzzState.BNCurve.g, BNK, &FuzzState.BNCurve);
+			if (!Ref.is_inf) {
+				FuzzExpect(!BNPt.is_inf &&
+					memcmp(BNPt.x, Ref.x, FUZZ_NUM_BYTES) == 0 &&
+					memcmp(BNPt.y, Ref.y, FUZZ_NUM_BYTES) == 0,
+					"pt_mul: gorec vs EC_pt_mul");
+			}
+		}break;
+
+		case FuzzCheck_PtMulDouble: {
+			gorbn_t K1[GORBN_SZARR], K2[GORBN_SZARR];
+			FuzzScalar(K1, Selector, K1Bytes, Curve);
+			FuzzScalar(K2, 0, K2Bytes, Curve);
+
+			//NOTE(dima): k1 * G + k2 * 7G = (k1 + 7 * k2) * G
+			gorbn_t Seven[GORBN_SZARR], K[GORBN_SZARR];
+			gorbn_init(Seven, GORBN_SZARR);
+			Seven[0] = 7;
+			gorbn_mul_mod(K, K2, Seven, Curve->q);
+			gorbn_add_mod(K, K, K1, Curve->q);
+
+			gorec_point Ref, Pt;
+			gorec_pt_mul_wnaf_jacobian(&Ref, &Curve->g, K, Curve);
+			gorec_pt_mul_double(&Pt, K1, &Curve->g, K2, &FuzzState.Q, Curve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_double: vs wnaf_jacobian of combined scalar");
+		}break;
+
+		case FuzzCheck_PtMulBatch: {
+			gorec_point Points[3];
+			gorec_point Results[3];
+			gorbn_t Scalars[3 * GORBN_SZARR];
+
+			Points[0] = Curve->g;
+			Points[1] = FuzzState.Q;
+			Points[2] = Curve->g;
+			FuzzScalar(Scalars, Selector, K1Bytes, Curve);
+			FuzzScalar(Scalars + GORBN_SZARR, 0, K2Bytes, Curve);
+			FuzzScalar(Scalars + 2 * GORBN_SZARR, 0, ABytes, Curve);
+
+			gorec_pt_mul_batch(Results, Points, Scalars, 3, Curve, 2);
+			for (int i = 0; i < 3; i++) {
+				gorec_point Ref;
+				gorec_pt_mul_wnaf_jacobian(&Ref, &Points[i], Scalars + i * GORBN_SZARR, Curve);
+				FuzzExpect(FuzzPointsEqual(&Ref, &Results[i]), "pt_mul_batch: vs wnaf_jacobian");
+			}
+		}break;
+
+		case FuzzCheck_PtMulX4: {
+			gorec_point Points[GOREC_X4_LANES];
+			gorec_point Results[GOREC_X4_LANES];
+			gorbn_t Scalars[GOREC_X4_LANES * GORBN_SZARR];
+
+			uint8_t* LaneBytes[GOREC_X4_LANES] = { K1Bytes, K2Bytes, ABytes, BBytes };
+			for (int i = 0; i < GOREC_X4_LANES; i++) {
+				Points[i] = (i & 1) ? FuzzState.Q : Curve->g;
+				FuzzScalar(Scalars + i * GORBN_SZARR, i ? 0 : Selector, LaneBytes[i], Curve);
+			}
+
+			gorec_pt_mul_x4(Results, Points, Scalars, Curve);
+			for (int i = 0; i < GOREC_X4_LANES; i++) {
+				gorec_point Ref;
+				gorec_pt_mul_wnaf_jacobian(&Ref, &Points[i], Scalars + i * GORBN_SZARR, Curve);
+				FuzzExpect(FuzzPointsEqual(&Ref, &Results[i]), "pt_mul_x4: vs wnaf_jacobian");
+			}
+		}break;
+
+		case FuzzCheck_PtMulCached: {
+			gorbn_t K1[GORBN_SZARR], K2[GORBN_SZARR];
+			FuzzScalar(K1, Selector, K1Bytes, Curve);
+			FuzzScalar(K2, 0, K2Bytes, Curve);
+
+			gorec_point* Key = (ABytes[0] & 1) ? &FuzzState.Q : &Curve->g;
+
+			gorec_point Ref, Pt;
+			gorec_pt_mul_wnaf_jacobian(&Ref, Key, K1, Curve);
+			gorec_pt_mul_cached(&Pt, Key, K1, &FuzzState.Cache);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_cached: vs wnaf_jacobian");
+
+			gorec_pt_mul_double(&Ref, K1, &Curve->g, K2, &FuzzState.Q, Curve);
+			gorec_pt_mul_double_cached(&Pt, K1, &Curve->g, K2, &FuzzState.Q, &FuzzState.Cache);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_double_cached: vs pt_mul_double");
+		}break;
+
+		case FuzzCheck_PtMulMont: {
+			gorec_curve* MontCurve = &FuzzState.MontCurve;
+			gorbn_t K1[GORBN_SZARR], K2[GORBN_SZARR];
+			FuzzScalar(K1, Selector, K1Bytes, Curve);
+			FuzzScalar(K2, 0, K2Bytes, Curve);
+
+			gorec_point* Key = (ABytes[0] & 1) ? &FuzzState.Q : &Curve->g;
+
+			gorec_point Ref, Pt;
+			gorec_pt_mul_wnaf_jacobian(&Ref, Key, K1, Curve);
+
+			gorec_pt_mul_wnaf_jacobian(&Pt, Key, K1, MontCurve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_mont: wnaf_jacobian vs Crandall");
+
+			gorec_pt_mul_jacobian(&Pt, Key, K1, MontCurve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_mont: jacobian vs Crandall");
+
+			gorec_pt_mul_monty(&Pt, Key, K1, MontCurve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_mont: monty vs Crandall");
+
+			if (Selector & 0x40) {
+				gorec_pt_mul(&Pt, Key, K1, MontCurve);
+				FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_mont: affine vs Crandall");
+			}
+
+			gorec_pt_mul_wnaf_jacobian(&Ref, &Curve->g, K1, Curve);
+			gorec_pt_mul_base(&Pt, K1, &FuzzState.MontBaseTable, MontCurve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_mont: base vs Crandall");
+
+			gorec_pt_mul_double(&Ref, K1, &Curve->g, K2, &FuzzState.Q, Curve);
+			gorec_pt_mul_double(&Pt, K1, &Curve->g, K2, &FuzzState.Q, MontCurve);
+			FuzzExpect(FuzzPointsEqual(&Ref, &Pt), "pt_mul_mont: double vs Crandall");
+
+			gorec_point Points[2] = { *Key, Curve->g };
+			gorec_point Results[2];
+			gorbn_t Scalars[2 * GORBN_SZARR];
+			gorbn_copy(Scalars, K1);
+			gorbn_copy(Scalars + GORBN_SZARR, K2);
+			gorec_pt_mul_batch(Results, Points, Scalars, 2, MontCurve, 1);
+			for (int i = 0; i < 2; i++) {
+				gorec_pt_mul_wnaf_jacobian(&Ref, &Points[i], Scalars + i * GORBN_SZARR, Curve);
+				FuzzExpect(FuzzPointsEqual(&Ref, &Results[i]), "pt_mul_mont: batch vs Crandall");
+			}
+		}break;
+
+		case FuzzCheck_DimaMul: {
+			//NOTE(dima): Long enough for Karatsuba and Toom-3, products are truncated to struct bn
+			uint8_t WA[FUZZ_DIMA_BYTES], WB[FUZZ_DIMA_BYTES], WR[FUZZ_DIMA_BYTES];
+			int ACount = FuzzWideLength(K1Bytes[0], FUZZ_DIMA_BYTES);
+			int BCount = FuzzWideLength(K1Bytes[1], FUZZ_DIMA_BYTES);
+			FuzzWideNumber(WA, ACount, ABytes, K1Bytes[2]);
+			FuzzWideNumber(WB, BCount, BBytes, K1Bytes[3]);
+
+			struct bn DWA, DWB;
+			bignum_from_data(&DWA, WA, FUZZ_DIMA_BYTES);
+			bignum_from_data(&DWB, WB, FUZZ_DIMA_BYTES);
+
+			FuzzMulBytes(WR, WA, ACount, WB, BCount, FUZZ_DIMA_BYTES);
+			bignum_mul(&DWA, &DWB, &DR);
+			FuzzExpect(FuzzDimaEqual(&DR, WR, FUZZ_DIMA_BYTES), "dima mul: bignum_mul vs bytes");
+			bignum_mul_karatsuba(&DWA, &DWB, &DR);
+			FuzzExpect(FuzzDimaEqual(&DR, WR, FUZZ_DIMA_BYTES), "dima mul: bignum_mul_karatsuba vs bytes");
+
+			FuzzMulBytes(WR, WA, ACount, WA, ACount, FUZZ_DIMA_BYTES);
+			bignum_mul(&DWA, &DWA, &DR);
+			FuzzExpect(FuzzDimaEqual(&DR, WR, FUZZ_DIMA_BYTES), "dima mul: bignum_mul a * a vs bytes");
+		}break;
+
+		case FuzzCheck_DimaPowMod: {
+			//NOTE(dima): Edge cases come from K1Bytes[0]: e = 0, m = 1, a >= m, one-word m
+			uint8_t Edge = K1Bytes[0];
+			uint8_t WA[FUZZ_DIMA_BYTES], WE[FUZZ_DIMA_BYTES], WM[FUZZ_DIMA_BYTES];
+
+			int MCount = FuzzWideLength(K1Bytes[1], FUZZ_DIMA_BYTES / 2);
+			if (Edge & 0x80) {
+				MCount = 1 + K1Bytes[1] % DBN_SZWORD;
+			}
+			FuzzWideNumber(WM, MCount, BBytes, K1Bytes[2]);
+			WM[0] |= 1;
+			if ((Edge & 0x38) == 0) {
+				memset(WM, 0, FUZZ_DIMA_BYTES);
+				WM[0] = 1;
+			}
+
+			//NOTE(dima): One byte shorter than m is below m, a >= m can be up to struct bn wide
+			int ACount = (Edge & 0x40) ? FuzzWideLength(K1Bytes[3], FUZZ_DIMA_BYTES) : MCount - 1;
+			FuzzWideNumber(WA, ACount, ABytes, K1Bytes[4]);
+
+			int ECount = FuzzWideLength(K1Bytes[5], 48);
+			FuzzWideNumber(WE, ECount, K2Bytes, K1Bytes[6]);
+			if ((Edge & 0x07) == 0) {
+				memset(WE, 0, FUZZ_DIMA_BYTES);
+			}
+
+			struct bn DWA, DWE, DWM, DRef;
+			bignum_from_data(&DWA, WA, FUZZ_DIMA_BYTES);
+			bignum_from_data(&DWE, WE, FUZZ_DIMA_BYTES);
+			bignum_from_data(&DWM, WM, FUZZ_DIMA_BYTES);
+
+			FuzzPowModReference(&DWA, &DWE, &DWM, &DRef);
+			bignum_powmod(&DWA, &DWE, &DWM, &DR);
+			FuzzExpect(bignum_cmp(&DR, &DRef) == DIMA_BIGNUM_CMP_EQUAL, "dima powmod: bignum_powmod vs square-and-multiply");
+
+			//NOTE(dima): The _ct version takes e only up to the length of m, top bytes of both can come out zero
+			if (FuzzDimaWords(&DWE) <= FuzzDimaWords(&DWM)) {
+				bignum_powmod_ct(&DWA, &DWE, &DWM, &DT);
+				FuzzExpect(bignum_cmp(&DT, &DRef) == DIMA_BIGNUM_CMP_EQUAL, "dima powmod: bignum_powmod_ct vs square-and-multiply");
+				FuzzExpect(bignum_cmp(&DT, &DR) == DIMA_BIGNUM_CMP_EQUAL, "dima powmod: bignum_powmod_ct vs bignum_powmod");
+			}
+		}break;
+
+		case FuzzCheck_DimaDivMod: {
+			//NOTE(dima): Divisors up to the full width. Saturated patterns push the quotient estimate off by one
+			uint8_t WA[FUZZ_DIMA_BYTES], WB[FUZZ_DIMA_BYTES], WC[FUZZ_DIMA_BYTES];
+			int ACount = FuzzWideLength(K1Bytes[0], FUZZ_DIMA_BYTES);
+			int BCount = FuzzWideLength(K1Bytes[1], FUZZ_DIMA_BYTES);
+			FuzzWideNumber(WA, ACount, ABytes, K1Bytes[2]);
+			FuzzWideNumber(WB, BCount, BBytes, K1Bytes[3]);
+
+			struct bn DWA, DWB, DWC, DQ, DRem;
+			bignum_from_data(&DWB, WB, FUZZ_DIMA_BYTES);
+			if (bignum_is_zero(&DWB)) {
+				bignum_from_int(&DWB, 1);
+			}
+
+			//NOTE(dima): a = c * b + (b - 1) has a known quotient and the largest remainder
+			int Known = (K1Bytes[4] & 0x80) && BCount < FUZZ_DIMA_BYTES;
+			if (Known) {
+				int CCount = 1 + K1Bytes[5] % (FUZZ_DIMA_BYTES - BCount);
+				FuzzWideNumber(WC, CCount, K2Bytes, K1Bytes[6]);
+				bignum_from_data(&DWC, WC, FUZZ_DIMA_BYTES);
+
+				bignum_mul(&DWC, &DWB, &DT);
+				bignum_copy(&DR, &DWB);
+				bignum_dec(&DR);
+				bignum_add(&DT, &DR, &DWA);
+			}
+			else {
+				bignum_from_data(&DWA, WA, FUZZ_DIMA_BYTES);
+			}
+
+			bignum_divmod(&DWA, &DWB, &DQ, &DRem);
+			FuzzExpect(bignum_cmp(&DRem, &DWB) == DIMA_BIGNUM_CMP_SMALLER, "dima divmod: r < b");
+			bignum_mul(&DQ, &DWB, &DT);
+			bignum_add(&DT, &DRem, &DR);
+			FuzzExpect(bignum_cmp(&DR, &DWA) == DIMA_BIGNUM_CMP_EQUAL, "dima divmod: q * b + r vs a");
+			if (Known) {
+				FuzzExpect(bignum_cmp(&DQ, &DWC) == DIMA_BIGNUM_CMP_EQUAL, "dima divmod: q vs c for a = c * b + b - 1");
+			}
+
+			DBN_T W;
+			memcpy(&W, K2Bytes, sizeof(W));
+			if (W == 0) {
+				W = 1;
+			}
+
+			DBN_T Rem = bignum_div_word(&DWA, W, &DQ);
+			FuzzExpect(Rem < W, "dima divmod: bignum_div_word remainder < w");
+			bignum_from_uint(&DT, W);
+			bignum_mul(&DQ, &DT, &DR);
+			bignum_from_uint(&DT, Rem);
+			bignum_add(&DR, &DT, &DRem);
+			FuzzExpect(bignum_cmp(&DRem, &DWA) == DIMA_BIGNUM_CMP_EQUAL, "dima divmod: bignum_div_word q * w + r vs a");
+		}break;
+
+		case FuzzCheck_DimaBarrett: {
+			//NOTE(dima): Bit 7 of K1Bytes[0] takes x at or above B^(2n), where bignum_barrett_mod falls back to bignum_mod
+			uint8_t WX[FUZZ_DIMA_BYTES], WM[FUZZ_DIMA_BYTES];
+			int Above = K1Bytes[0] & 0x80;
+
+			int MCount = FuzzWideLength(K1Bytes[1], Above ? FUZZ_DIMA_BYTES / 4 : FUZZ_DIMA_BYTES / 2);
+			FuzzWideNumber(WM, MCount, BBytes, K1Bytes[2]);
+
+			//NOTE(dima): Top word of m is 1, the estimate is then most often 2 below. m = B^(n - 1) is the one modulus where mu needs n + 2 words
+			if (K1Bytes[0] & 0x20) {
+				int Top = ((MCount - 1) / DBN_SZWORD) * DBN_SZWORD;
+				if (K1Bytes[0] & 0x10) {
+					memset(WM, 0, Top);
+				}
+				memset(WM + Top, 0, DBN_SZWORD);
+				WM[Top] = 1;
+			}
+
+			struct bn DWX, DWM, DRef;
+			struct bn_barrett Barrett;
+			bignum_from_data(&DWM, WM, FUZZ_DIMA_BYTES);
+			if (bignum_is_zero(&DWM)) {
+				bignum_from_int(&DWM, 1);
+			}
+			int N = FuzzDimaWords(&DWM);
+			int Limit = 2 * N * DBN_SZWORD;
+
+			bignum_barrett_init(&Barrett, &DWM);
+
+			//NOTE(dima): Several x per modulus, as Barrett is used. The seed window slides over a
+			for (int i = 0; i < 16; i++) {
+				uint8_t Length = (uint8_t)(K1Bytes[3] + i * 37);
+
+				int XCount;
+				if (Above) {
+					XCount = Limit + 1 + Length % (FUZZ_DIMA_BYTES - Limit);
+				}
+				else if (K1Bytes[0] & 0x20) {
+					XCount = Limit;
+				}
+				else {
+					XCount = FuzzWideLength(Length, Limit);
+				}
+				FuzzWideNumber(WX, XCount, ABytes + i, K1Bytes[4]);
+				if (Above) {
+					WX[XCount - 1] |= 1;
+				}
+				else if ((K1Bytes[0] & 0x40) && i == 0) {
+					//NOTE(dima): B^(2n) - 1 is the largest x the estimate has to cover
+					memset(WX, 0xFF, Limit);
+				}
+				bignum_from_data(&DWX, WX, FUZZ_DIMA_BYTES);
+
+				bignum_barrett_mod(&DWX, &Barrett, &DR);
+				bignum_mod(&DWX, &DWM, &DRef);
+				FuzzExpect(bignum_cmp(&DR, &DRef) == DIMA_BIGNUM_CMP_EQUAL, "dima barrett: bignum_barrett_mod vs bignum_mod");
+			}
+		}break;
+
+		case FuzzCheck_DimaBnv: {
+			//NOTE(dima): Up to half of struct bn, so that products and shifts fit and struct bn is the reference
+			uint8_t WA[FUZZ_DIMA_BYTES], WB[FUZZ_DIMA_BYTES], WR[FUZZ_DIMA_BYTES];
+			int ACount = FuzzWideLength(K1Bytes[0], FUZZ_DIMA_BYTES / 2);
+			int BCount = FuzzWideLength(K1Bytes[1], FUZZ_DIMA_BYTES / 2);
+			FuzzWideNumber(WA, ACount, ABytes, K1Bytes[2]);
+			FuzzWideNumber(WB, BCount, BBytes, K1Bytes[3]);
+			int Alias = K1Bytes[4] % 3;
+			int Shift = (K1Bytes[5] | (K1Bytes[6] << 8)) % (FUZZ_DIMA_BYTES * 4);
+
+			struct bn DWA, DWB, DQ, DRem;
+			bignum_from_data(&DWA, WA, FUZZ_DIMA_BYTES);
+			bignum_from_data(&DWB, WB, FUZZ_DIMA_BYTES);
+
+			struct bnv VA, VB, X, Y, Z, W;
+			bnv_init(&VA, 0);
+			bnv_init(&VB, 0);
+			bnv_init(&X, 0);
+			bnv_init(&Y, 0);
+			bnv_init(&Z, 0);
+			bnv_init(&W, 0);
+
+			bnv_from_data(&VA, WA, ACount);
+			bnv_from_bn(&VB, &DWB);
+			FuzzExpect(FuzzBnvEqual(&VA, &DWA), "dima bnv: bnv_from_data vs bignum_from_data");
+			FuzzExpect(FuzzBnvEqual(&VB, &DWB), "dima bnv: bnv_from_bn vs bignum_from_data");
+			FuzzExpect(bnv_cmp(&VA, &VB) == bignum_cmp(&DWA, &DWB), "dima bnv: bnv_cmp vs bignum_cmp");
+			FuzzExpect(bnv_is_zero(&VB) == bignum_is_zero(&DWB), "dima bnv: bnv_is_zero vs bignum_is_zero");
+
+			int Needed = ACount;
+			while (Needed > 0 && WA[Needed - 1] == 0) {
+				Needed--;
+			}
+			FuzzExpect(bnv_to_data(&VA, WR, FUZZ_DIMA_BYTES) == Needed && memcmp(WR, WA, FUZZ_DIMA_BYTES) == 0, "dima bnv: bnv_to_data vs input");
+			if (Needed > 0) {
+				FuzzExpect(bnv_to_data(&VA, WR, Needed - 1) == 0, "dima bnv: bnv_to_data into a short buffer");
+			}
+
+			struct bnv* Out = FuzzBnvOut(&X, &Y, &Z, &VA, &VB, Alias);
+			bnv_add(&X, &Y, Out);
+			bignum_add(&DWA, &DWB, &DR);
+			FuzzExpect(FuzzBnvEqual(Out, &DR), "dima bnv: bnv_add vs bignum_add");
+
+			//NOTE(dima): Larger minus smaller
+			int Swap = bignum_cmp(&DWA, &DWB) == DIMA_BIGNUM_CMP_SMALLER;
+			Out = FuzzBnvOut(&X, &Y, &Z, Swap ? &VB : &VA, Swap ? &VA : &VB, Alias);
+			bnv_sub(&X, &Y, Out);
+			bignum_sub(Swap ? &DWB : &DWA, Swap ? &DWA : &DWB, &DR);
+			FuzzExpect(FuzzBnvEqual(Out, &DR), "dima bnv: bnv_sub vs bignum_sub");
+
+			Out = FuzzBnvOut(&X, &Y, &Z, &VA, &VB, Alias);
+			bnv_mul(&X, &Y, Out);
+			bignum_mul(&DWA, &DWB, &DR);
+			FuzzExpect(FuzzBnvEqual(Out, &DR), "dima bnv: bnv_mul vs bignum_mul");
+
+			Out = FuzzBnvOut(&X, &Y, &Z, &VA, &VB, Alias);
+			bnv_sqr(&X, Out);
+			bignum_mul(&DWA, &DWA, &DR);
+			FuzzExpect(FuzzBnvEqual(Out, &DR), "dima bnv: bnv_sqr vs bignum_mul");
+
+			//NOTE(dima): bignum_lshift and bignum_rshift shift a in place as well
+			Out = FuzzBnvOut(&X, &Y, &Z, &VA, &VB, Alias);
+			bnv_lshift(&X, Out, Shift);
+			bignum_copy(&DT, &DWA);
+			bignum_lshift(&DT, &DR, Shift);
+			FuzzExpect(FuzzBnvEqual(Out, &DR), "dima bnv: bnv_lshift vs bignum_lshift");
+
+			Out = FuzzBnvOut(&X, &Y, &Z, &VA, &VB, Alias);
+			bnv_rshift(&X, Out, Shift);
+			bignum_copy(&DT, &DWA);
+			bignum_rshift(&DT, &DR, Shift);
+			FuzzExpect(FuzzBnvEqual(Out, &DR), "dima bnv: bnv_rshift vs bignum_rshift");
+
+			if (!bignum_is_zero(&DWB)) {
+				bignum_divmod(&DWA, &DWB, &DQ, &DRem);
+
+				//NOTE(dima): q and r go to x and y, the other way around, or to their own numbers
+				FuzzBnvOut(&X, &Y, &Z, &VA, &VB, Alias);
+				struct bnv* Q = (Alias == 1) ? &X : ((Alias == 2) ? &Y : &Z);
+				struct bnv* R = (Alias == 1) ? &Y : ((Alias == 2) ? &X : &W);
+				bnv_divmod(&X, &Y, Q, R);
+				FuzzExpect(FuzzBnvEqual(Q, &DQ), "dima bnv: bnv_divmod q vs bignum_divmod");
+				FuzzExpect(FuzzBnvEqual(R, &DRem), "dima bnv: bnv_divmod r vs bignum_divmod");
+
+				bnv_divmod(&VA, &VB, &Z, 0);
+				FuzzExpect(FuzzBnvEqual(&Z, &DQ), "dima bnv: bnv_divmod without r");
+				bnv_divmod(&VA, &VB, 0, &W);
+				FuzzExpect(FuzzBnvEqual(&W, &DRem), "dima bnv: bnv_divmod without q");
+			}
+
+			bnv_free(&VA);
+			bnv_free(&VB);
+			bnv_free(&X);
+			bnv_free(&Y);
+			bnv_free(&Z);
+			bnv_free(&W);
+		}break;
+
+		case FuzzCheck_DimaBnvWide: {
+			//NOTE(dima): Past struct bn there is no reference, so (a * b + c) / b has to give back a and c
+			static uint8_t WA[FUZZ_BNV_BYTES], WB[FUZZ_BNV_BYTES], WC[FUZZ_BNV_BYTES];
+			int ACount = FuzzWideLength(K1Bytes[0], FUZZ_BNV_BYTES);
+			int BCount = FuzzWideLength(K1Bytes[1], FUZZ_BNV_BYTES);
+			int CCount = FuzzWideLength(K1Bytes[2], BCount);
+			FuzzExpand(WA, ACount, ABytes, K1Bytes[3] % 3);
+			FuzzExpand(WB, BCount, BBytes, K1Bytes[4] % 3);
+			FuzzExpand(WC, CCount, K2Bytes, K1Bytes[3] % 3);
+			int Shift = (K1Bytes[5] | (K1Bytes[6] << 8)) % (FUZZ_BNV_BYTES * 8);
+
+			fuzz_allocator Counter = {-1, 0, 0};
+			struct bn_allocator Allocator = {FuzzAlloc, FuzzFree, &Counter};
+
+			struct bnv VA, VB, VC, One, P, S, Sq, L, Q, R, Out, Out2, Saved, Saved2;
+			struct bnv* All[] = {&VA, &VB, &VC, &One, &P, &S, &Sq, &L, &Q, &R, &Out, &Out2, &Saved, &Saved2};
+			for (int i = 0; i < (int)(sizeof(All) / sizeof(All[0])); i++) {
+				bnv_init(All[i], &Allocator);
+			}
+
+			bnv_from_data(&VA, WA, ACount);
+			bnv_from_data(&VB, WB, BCount);
+			bnv_from_data(&VC, WC, CCount);
+			bnv_from_uint(&One, 1);
+			if (bnv_is_zero(&VA)) {
+				bnv_copy(&VA, &One);
+			}
+			if (bnv_is_zero(&VB)) {
+				bnv_copy(&VB, &One);
+			}
+			if (bnv_cmp(&VC, &VB) != DIMA_BIGNUM_CMP_SMALLER) {
+				bnv_sub(&VB, &One, &VC);
+			}
+
+			bnv_mul(&VA, &VB, &P);
+			bnv_add(&P, &VC, &S);
+			bnv_divmod(&S, &VB, &Q, &R);
+			FuzzExpect(bnv_cmp(&Q, &VA) == DIMA_BIGNUM_CMP_EQUAL, "dima bnv wide: (a * b + c) / b vs a");
+			FuzzExpect(bnv_cmp(&R, &VC) == DIMA_BIGNUM_CMP_EQUAL, "dima bnv wide: (a * b + c) % b vs c");
+
+			bnv_sqr(&VA, &Sq);
+			bnv_divmod(&Sq, &VA, &Q, &R);
+			FuzzExpect(bnv_cmp(&Q, &VA) == DIMA_BIGNUM_CMP_EQUAL && bnv_is_zero(&R), "dima bnv wide: a * a / a vs a");
+
+			bnv_lshift(&VA, &L, Shift);
+			bnv_rshift(&L, &Q, Shift);
+			FuzzExpect(bnv_cmp(&Q, &VA) == DIMA_BIGNUM_CMP_EQUAL, "dima bnv wide: (a << n) >> n vs a");
+
+			//NOTE(dima): Again with the allocator failing after a few allocations, outputs hold c before
+			int Op = K1Bytes[7] % 5;
+			bnv_copy(&Out, &VC);
+			bnv_copy(&Out2, &VC);
+			bnv_copy(&Saved, &Out);
+			bnv_copy(&Saved2, &Out2);
+
+			Counter.Left = K1Bytes[8] % 4;
+			int Done = 0;
+			struct bnv* Expected = &P;
+			struct bnv* Expected2 = 0;
+			switch (Op) {
+				case 0: {
+					Done = bnv_mul(&VA, &VB, &Out);
+				}break;
+				case 1: {
+					Done = bnv_sqr(&VA, &Out);
+					Expected = &Sq;
+				}break;
+				case 2: {
+					Done = bnv_add(&P, &VC, &Out);
+					Expected = &S;
+				}break;
+				case 3: {
+					Done = bnv_lshift(&VA, &Out, Shift);
+					Expected = &L;
+				}break;
+				case 4: {
+					Done = bnv_divmod(&S, &VB, &Out, &Out2);
+					Expected = &VA;
+					Expected2 = &VC;
+				}break;
+			}
+			Counter.Left = -1;
+
+			if (Done) {
+				FuzzExpect(bnv_cmp(&Out, Expected) == DIMA_BIGNUM_CMP_EQUAL, "dima bnv wide: result with a failing allocator");
+				if (Expected2) {
+					FuzzExpect(bnv_cmp(&Out2, Expected2) == DIMA_BIGNUM_CMP_EQUAL, "dima bnv wide: result with a failing allocator");
+				}
+			}
+			else {
+				FuzzExpect(bnv_cmp(&Out, &Saved) == DIMA_BIGNUM_CMP_EQUAL && bnv_cmp(&Out2, &Saved2) == DIMA_BIGNUM_CMP_EQUAL, "dima bnv wide: output changed by a failed operation");
+			}
+
+			for (int i = 0; i < (int)(sizeof(All) / sizeof(All[0])); i++) {
+				bnv_free(All[i]);
+			}
+			FuzzExpect(Counter.Live == 0 && Counter.Bytes == 0, "dima bnv wide: allocations not freed with their size");
+		}break;
+
+		case FuzzCheck_FieldPtMul: {
+			gorbn_t K[GORBN_SZARR];
+			FuzzScalar(K, Selector, K1Bytes, Curve);
+
+			gorec_point Ref, RefQ;
+			gorec_pt_mul_jacobian(&Ref, &Curve->g, K, Curve);
+			gorec_pt_mul_jacobian(&RefQ, &FuzzState.Q, K, Curve);
+
+			FuzzExpect(FuzzFieldPtMulEqual<uint16_t>(&Curve->g, K, &Ref), "field pt_mul: 16-bit limbs vs gorec_pt_mul_jacobian");
+			FuzzExpect(FuzzFieldPtMulEqual<uint32_t>(&Curve->g, K, &Ref), "field pt_mul: 32-bit limbs vs gorec_pt_mul_jacobian");
+			FuzzExpect(FuzzFieldPtMulEqual<uint32_t>(&FuzzState.Q, K, &RefQ), "field pt_mul: 32-bit limbs vs gorec_pt_mul_jacobian on 7G");
+#if defined(__SIZEOF_INT128__)
+			FuzzExpect(FuzzFieldPtMulEqual<uint64_t>(&Curve->g, K, &Ref), "field pt_mul: 64-bit limbs vs gorec_pt_mul_jacobian");
+#endif
+		}break;
+
+		case FuzzCheck_FieldOps: {
+			FuzzFieldOps<gor::Bign192Field<fuzz_field_limb> >(ABytes, BBytes, K1Bytes[0]);
+			FuzzFieldOps<gor::Bign256Field<fuzz_field_limb> >(ABytes, BBytes, K1Bytes[0]);
+		}break;
+		case FuzzCheck_JSONEscape: {
+			int32_t Len = FuzzJSONLength(K1Bytes[0]);
+			uint8_t* Value = (uint8_t*)malloc(Len + 1);
+			FuzzJSONBytes(Value, Len, ABytes, K1Bytes[1]);
+
+			uint8_t Key[40];
+			int32_t KeyLen = K1Bytes[2] % sizeof(Key);
+			FuzzJSONBytes(Key, KeyLen, BBytes, K1Bytes[3]);
+
+			//NOTE(dima): From every start in the first 64 bytes, so the SSE2 loads go over all tails and misalignments
+			for (int32_t Start = 0; Start <= Len && Start < 64; Start++) {
+				FuzzExpect(JSONScanPlain((char*)Value + Start, Len - Start) == FuzzScanPlain(Value + Start, Len - Start),
+					"json escape: JSONScanPlain vs byte by byte");
+			}
+
+			uint32_t Flags = (Selector & 0x40) ? JSONWriterFlag_Pretty : JSONWriterFlag_None;
+
+			json_writer Writer;
+			JSONInit(&Writer, Flags);
+			JSONBegin(&Writer);
+			JSONAddSTRLen(&Writer, (char*)Key, KeyLen, (char*)Value, Len);
+			JSONEnd(&Writer);
+
+			fuzz_sink Sink = {};
+			json_writer SinkWriter;
+			JSONInitSink(&SinkWriter, FuzzSinkAppend, &Sink, Flags);
+			JSONBegin(&SinkWriter);
+			JSONAddSTRLen(&SinkWriter, (char*)Key, KeyLen, (char*)Value, Len);
+			JSONEnd(&SinkWriter);
+			JSONFlush(&SinkWriter);
+
+			FuzzExpect(FuzzJSONParseDoc(JSONGetBuf(&Writer), JSONGetSize(&Writer), Key, KeyLen, Value, Len),
+				"json escape: buffer mode output parsed back");
+			FuzzExpect(FuzzJSONParseDoc(Sink.Data, Sink.Size, Key, KeyLen, Value, Len),
+				"json escape: sink mode output parsed back");
+			FuzzExpect(Sink.Size == JSONGetSize(&Writer) && memcmp(Sink.Data, JSONGetBuf(&Writer), Sink.Size) == 0,
+				"json escape: sink mode vs buffer mode");
+
+			JSONFree(&Writer);
+			JSONFree(&SinkWriter);
+			free(Sink.Data);
+			free(Value);
+		}break;
+		case FuzzCheck_JSONCBOR: {
+			static const int32_t Lengths[] = { 0, 1, 23, 24, 255, 256, 65535, 65536 };
+
+			int32_t BytesLen = Lengths[K1Bytes[0] % 8];
+			if (K1Bytes[0] & 0x80) {
+				BytesLen = FuzzJSONLength(K1Bytes[1]);
+			}
+			uint8_t* Bytes = (uint8_t*)malloc(BytesLen + 1);
+			FuzzExpand(Bytes, BytesLen, BBytes, K1Bytes[2] % 3);
+
+			uint64_t Random = 0;
+			for (int i = 0; i < 8; i++) {
+				Random |= (uint64_t)ABytes[i] << (i * 8);
+			}
+			int Depth = K1Bytes[3] % 8;
+
+			//NOTE(dima): Pretty has to be ignored in CBOR
+			uint32_t Flags = JSONWriterFlag_CBOR | ((Selector & 0x40) ? JSONWriterFlag_Pretty : JSONWriterFlag_None);
+
+			fuzz_cbor_doc* Doc = (fuzz_cbor_doc*)malloc(sizeof(fuzz_cbor_doc));
+
+			json_writer Writer;
+			JSONInit(&Writer, Flags);
+			FuzzCBORWrite(&Writer, Doc, Random, Bytes, BytesLen, Depth);
+			FuzzExpect(FuzzCBOREqual(JSONGetBuf(&Writer), JSONGetSize(&Writer), Doc), "json cbor: buffer mode output decoded back");
+
+			fuzz_sink Sink = {};
+			json_writer SinkWriter;
+			JSONInitSink(&SinkWriter, FuzzSinkAppend, &Sink, Flags);
+			FuzzCBORWrite(&SinkWriter, Doc, Random, Bytes, BytesLen, Depth);
+			JSONFlush(&SinkWriter);
+			FuzzExpect(FuzzCBOREqual(Sink.Data, Sink.Size, Doc), "json cbor: sink mode output decoded back");
+
+			JSONFree(&Writer);
+			JSONFree(&SinkWriter);
+			free(Sink.Data);
+			free(Doc);
+			free(Bytes);
+		}break;
+	}
+
+	return(FuzzFailure);
+}
+
+#ifdef GOR_BIGNUM_FUZZ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* Data, size_t Size) {
+	const char* Failure = FuzzCheck(Data, Size);
+	if (Failure) {
+		//NOTE(dima): libFuzzer saves and minimizes the input after abort
+		fprintf(stderr, "MISMATCH: %s\n", Failure);
+		abort();
+	}
+
+	return(0);
+}
+
+#else
+
+static uint64_t FuzzRandomState = 0x9E3779B97F4A7C15ull;
+
+static uint64_t FuzzRandom() {
+	//NOTE(dima): xorshift64
+	uint64_t x = FuzzRandomState;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	FuzzRandomState = x;
+
+	return(x);
+}
+
+static void FuzzRandomInput(uint8_t* Data) {
+	for (int i = 0; i < FUZZ_INPUT_SIZE; i++) {
+		Data[i] = (uint8_t)FuzzRandom();
+	}
+
+	//NOTE(dima): Sparse and saturated numbers find carry bugs much faster than uniform ones
+	int Mode = (int)(FuzzRandom() % 4);
+	for (int i = 1; i < FUZZ_INPUT_SIZE; i++) {
+		if (Mode == 1 && (FuzzRandom() & 3)) {
+			Data[i] = 0;
+		}
+		else if (Mode == 2 && (FuzzRandom() & 3)) {
+			Data[i] = 0xFF;
+		}
+	}
+}
+
+/*
+	NOTE(dima): Greedy minimization. The input is cut from the end, then
+	bytes are zeroed one by one, as long as the same comparison fails.
+*/
+static size_t FuzzMinimize(uint8_t* Data, size_t Size, const char* Failure) {
+	while (Size > 1 && FuzzCheck(Data, Size - 1) == Failure) {
+		Size--;
+	}
+
+	for (size_t i = 1; i < Size; i++) {
+		uint8_t Old = Data[i];
+		if (Old == 0) {
+			continue;
+		}
+
+		Data[i] = 0;
+		if (FuzzCheck(Data, Size) != Failure) {
+			Data[i] = Old;
+		}
+	}
+
+	return(Size);
+}
+
+static void FuzzReport(uint8_t* Data, size_t Size, const char* Failure) {
+	fprintf(stderr, "MISMATCH: %s\nminimizing...\n", Failure);
+	Size = FuzzMinimize(Data, Size, Failure);
+
+	fprintf(stderr, "input (%d bytes):", (int)Size);
+	for (size_t i = 0; i < Size; i++) {
+		fprintf(stderr, "%s%02X", (i % 32 == 0) ? "\n\t" : "", Data[i]);
+	}
+	fprintf(stderr, "\n");
+
+	FILE* File = fopen(FUZZ_CRASH_FILE, "wb");
+	if (File) {
+		fwrite(Data, 1, Size, File);
+		fclose(File);
+		fprintf(stderr, "saved to %s\n", FUZZ_CRASH_FILE);
+	}
+}
+
+int main(int ArgsCount, char** Args) {
+	long long RunsCount = 10000;
+	int FilesCount = 0;
+	int Failed = 0;
+
+	for (int ArgIndex = 1; ArgIndex < ArgsCount; ArgIndex++) {
+		if (strcmp(Args[ArgIndex], "-runs") == 0 && ArgIndex + 1 < ArgsCount) {
+			RunsCount = atoll(Args[++ArgIndex]);
+		}
+		else if (strcmp(Args[ArgIndex], "-seed") == 0 && ArgIndex + 1 < ArgsCount) {
+			FuzzRandomState = strtoull(Args[++ArgIndex], 0, 0) | 1;
+		}
+		else {
+			//NOTE(dima): Replaying a saved input
+			uint8_t Data[FUZZ_INPUT_SIZE];
+			size_t Size = 0;
+
+			FILE* File = fopen(Args[ArgIndex], "rb");
+			if (!File) {
+				fprintf(stderr, "Can not open %s\n", Args[ArgIndex]);
+				return(1);
+			}
+			Size = fread(Data, 1, sizeof(Data), File);
+			fclose(File);
+
+			const char* Failure = FuzzCheck(Data, Size);
+			printf("%s: %s\n", Args[ArgIndex], Failure ? Failure : "ok");
+			Failed |= Failure != 0;
+			FilesCount++;
+		}
+	}
+
+	if (FilesCount) {
+		return(Failed);
+	}
+
+	for (long long RunIndex = 0; RunIndex < RunsCount; RunIndex++) {
+		uint8_t Data[FUZZ_INPUT_SIZE];
+		FuzzRandomInput(Data);
+
+		const char* Failure = FuzzCheck(Data, sizeof(Data));
+		if (Failure) {
+			fprintf(stderr, "run %lld: ", RunIndex);
+			FuzzReport(Data, sizeof(Data), Failure);
+			return(1);
+		}
+
+		if ((RunIndex + 1) % 1000 == 0) {
+			printf("%lld runs ok\n", RunIndex + 1);
+			fflush(stdout);
+		}
+	}
+
+	printf("%lld runs, all engines agree\n", RunsCount);
+
+	return(0);
+}
+
+#endif
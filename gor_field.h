@@ -0,0 +1,724 @@
+#ifndef GOR_FIELD_H_INCLUDED
+#define GOR_FIELD_H_INCLUDED
+
+/*
+	ABOUT:
+		Fixed-width prime field and curve arithmetic as C++ templates.
+
+		gor_bignum.h fixes one number width per translation unit through
+		GORBN_SZWORD / GORBN_SZARR. Here the width is a template parameter,
+		so the 128-, 192- and 256-bit bign security levels can live in one
+		binary, each one compiled for its own size:
+
+			gor::FieldElem<Bits, Limb>   - Bits-wide number in limbs of type Limb
+			gor::CrandField<Elem, C>     - arithmetic modulo p = 2^Bits - C
+			gor::EcCurve<Field>          - curve y^2 = x^3 + a*x + b over Field
+			gor::EcPoint<Field>          - point of such a curve
+
+		Loops over limbs have a fixed trip count and the compiler unrolls
+		them (GORF_UNROLL), and C of the prime is a template argument, so
+		the whole reduction becomes straight-line code with C folded in as
+		an immediate. Only pseudo-Mersenne primes are covered, that is what
+		all bign curves use. Other primes still go through gor_bignum.h
+		Montgomery code.
+
+		All numbers are little-endian. Field elements are always kept fully
+		reduced (below p). Field operations run in constant time, point
+		multiplication does not (same as gorec_pt_mul_jacobian).
+
+		The point code is a separate copy of the gorec formulas, not
+		shared with gor_bignum.h, and covers only Jacobian doubling and
+		addition (as gorec_pt_double_jacobian, gorec_pt_add_jacobian) and
+		4-bit fixed-window pt_mul_jacobian. There is no mixed addition,
+		wNAF, fixed-base table, ladder or batch multiplication here, use
+		gor_bignum.h for those. A fix to one copy of the formulas has to be
+		made in the other one too, the fuzzer compares the two.
+
+	USAGE:
+		Header-only, no implementation define needed.
+
+			gor::EcCurve<gor::Bign128Field<uint64_t> > Curve;
+			gor::curve_load_stb128(&Curve);
+			gor::pt_mul_jacobian(&Result, &Curve.g, Scalar, &Curve);
+
+		Limb can be uint16_t, uint32_t, or uint64_t when the compiler has
+		unsigned __int128. Needs C++11.
+
+	LICENCE:
+		This is free and unencumbered software released into the public domain.
+		For more information, please refer to <https://unlicense.org>
+
+	AUTHOR:
+		Gorevoy Dmitry - github.com/gorevojd
+*/
+
+#ifndef __cplusplus
+#error gor_field.h is C++ only, use gor_bignum.h from C
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_MSC_VER)
+#define GORF_INLINE __forceinline
+#define GORF_UNROLL
+#else
+#define GORF_INLINE inline __attribute__((always_inline))
+#define GORF_UNROLL _Pragma("GCC unroll 32")
+#endif
+
+namespace gor {
+
+/* Double-width type used for limb products */
+template<class Limb> struct limb_traits;
+
+template<> struct limb_traits<uint16_t> { typedef uint32_t wide_t; };
+template<> struct limb_traits<uint32_t> { typedef uint64_t wide_t; };
+#if defined(__SIZEOF_INT128__)
+template<> struct limb_traits<uint64_t> { typedef unsigned __int128 wide_t; };
+#endif
+
+template<size_t Bits, class Limb>
+struct FieldElem {
+	typedef Limb limb_t;
+	typedef typename limb_traits<Limb>::wide_t wide_t;
+	typedef FieldElem<Bits * 2, Limb> wide_elem;
+
+	enum {
+		LimbBits = (int)(sizeof(Limb) * 8),
+		N = (int)(Bits / (sizeof(Limb) * 8)),
+	};
+
+	static_assert(Bits % (sizeof(Limb) * 8) == 0, "Bits must be a multiple of the limb size");
+
+	Limb v[N];
+
+	static GORF_INLINE void zero(FieldElem& r) {
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) { r.v[i] = 0; }
+	}
+
+	static GORF_INLINE void from_uint(FieldElem& r, uint64_t x) {
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			r.v[i] = (i * LimbBits < 64) ? (Limb)(x >> (i * LimbBits % 64)) : 0;
+		}
+	}
+
+	/* Little-endian bytes, missing ones are zero, extra ones are dropped */
+	static void from_data(FieldElem& r, const void* data, int size) {
+		const uint8_t* at = (const uint8_t*)data;
+
+		zero(r);
+		for (int i = 0; i < size && i < N * (int)sizeof(Limb); i++) {
+			r.v[i / sizeof(Limb)] |= (Limb)((Limb)at[i] << (8 * (i % sizeof(Limb))));
+		}
+	}
+
+	static void to_data(void* data, int size, const FieldElem& a) {
+		uint8_t* to = (uint8_t*)data;
+
+		for (int i = 0; i < size; i++) {
+			to[i] = (i < N * (int)sizeof(Limb)) ? (uint8_t)(a.v[i / sizeof(Limb)] >> (8 * (i % sizeof(Limb)))) : 0;
+		}
+	}
+
+	/* r = a + b, returns carry */
+	static GORF_INLINE Limb add(FieldElem& r, const FieldElem& a, const FieldElem& b) {
+		Limb carry = 0;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			wide_t t = (wide_t)a.v[i] + b.v[i] + carry;
+			r.v[i] = (Limb)t;
+			carry = (Limb)(t >> LimbBits);
+		}
+
+		return(carry);
+	}
+
+	/* r = a + b for one-limb b, returns carry */
+	static GORF_INLINE Limb add_limb(FieldElem& r, const FieldElem& a, Limb b) {
+		Limb carry = b;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			wide_t t = (wide_t)a.v[i] + carry;
+			r.v[i] = (Limb)t;
+			carry = (Limb)(t >> LimbBits);
+		}
+
+		return(carry);
+	}
+
+	/* r = a - b, returns borrow */
+	static GORF_INLINE Limb sub(FieldElem& r, const FieldElem& a, const FieldElem& b) {
+		Limb borrow = 0;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			wide_t t = (wide_t)a.v[i] - b.v[i] - borrow;
+			r.v[i] = (Limb)t;
+			borrow = (Limb)((t >> LimbBits) & 1);
+		}
+
+		return(borrow);
+	}
+
+	/* r = a - b for one-limb b, returns borrow */
+	static GORF_INLINE Limb sub_limb(FieldElem& r, const FieldElem& a, Limb b) {
+		Limb borrow = b;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			wide_t t = (wide_t)a.v[i] - borrow;
+			r.v[i] = (Limb)t;
+			borrow = (Limb)((t >> LimbBits) & 1);
+		}
+
+		return(borrow);
+	}
+
+	/* r = a * b, schoolbook */
+	static GORF_INLINE void mul(wide_elem& r, const FieldElem& a, const FieldElem& b) {
+		GORF_UNROLL
+		for (int i = 0; i < 2 * N; i++) { r.v[i] = 0; }
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			Limb carry = 0;
+			GORF_UNROLL
+			for (int j = 0; j < N; j++) {
+				wide_t t = (wide_t)a.v[i] * b.v[j] + r.v[i + j] + carry;
+				r.v[i + j] = (Limb)t;
+				carry = (Limb)(t >> LimbBits);
+			}
+			r.v[i + N] = carry;
+		}
+	}
+
+	/* r = a * a. Cross products are computed once and doubled */
+	static GORF_INLINE void sqr(wide_elem& r, const FieldElem& a) {
+		GORF_UNROLL
+		for (int i = 0; i < 2 * N; i++) { r.v[i] = 0; }
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			Limb carry = 0;
+			GORF_UNROLL
+			for (int j = i + 1; j < N; j++) {
+				wide_t t = (wide_t)a.v[i] * a.v[j] + r.v[i + j] + carry;
+				r.v[i + j] = (Limb)t;
+				carry = (Limb)(t >> LimbBits);
+			}
+			r.v[i + N] = carry;
+		}
+
+		Limb top = 0;
+		GORF_UNROLL
+		for (int i = 0; i < 2 * N; i++) {
+			Limb x = r.v[i];
+			r.v[i] = (Limb)((Limb)(x << 1) | top);
+			top = (Limb)(x >> (LimbBits - 1));
+		}
+
+		Limb carry = 0;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			wide_t t = (wide_t)a.v[i] * a.v[i] + r.v[2 * i] + carry;
+			r.v[2 * i] = (Limb)t;
+			t = (wide_t)r.v[2 * i + 1] + (Limb)(t >> LimbBits);
+			r.v[2 * i + 1] = (Limb)t;
+			carry = (Limb)(t >> LimbBits);
+		}
+	}
+
+	/* r = cond ? b : a, cond is 0 or 1, no branches */
+	static GORF_INLINE void select(FieldElem& r, const FieldElem& a, const FieldElem& b, Limb cond) {
+		Limb mask = (Limb)(0 - cond);
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			r.v[i] = (Limb)(a.v[i] ^ ((a.v[i] ^ b.v[i]) & mask));
+		}
+	}
+
+	/* Returns 1 if a > b, -1 if a < b, 0 if equal (like GORBN_CMP_*) */
+	static int cmp(const FieldElem& a, const FieldElem& b) {
+		for (int i = N - 1; i >= 0; i--) {
+			if (a.v[i] != b.v[i]) {
+				return((a.v[i] > b.v[i]) ? 1 : -1);
+			}
+		}
+
+		return(0);
+	}
+
+	static GORF_INLINE int is_zero(const FieldElem& a) {
+		Limb acc = 0;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) { acc |= a.v[i]; }
+
+		return(acc == 0);
+	}
+
+	static GORF_INLINE int equal(const FieldElem& a, const FieldElem& b) {
+		Limb acc = 0;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) { acc |= (Limb)(a.v[i] ^ b.v[i]); }
+
+		return(acc == 0);
+	}
+
+	static GORF_INLINE int bit(const FieldElem& a, int i) {
+		return((int)((a.v[i / LimbBits] >> (i % LimbBits)) & 1));
+	}
+
+	static int nbits(const FieldElem& a) {
+		for (int i = N - 1; i >= 0; i--) {
+			if (a.v[i]) {
+				int result = i * LimbBits;
+				for (Limb x = a.v[i]; x; x >>= 1) {
+					result++;
+				}
+				return(result);
+			}
+		}
+
+		return(0);
+	}
+};
+
+/*
+	Arithmetic modulo p = 2^Bits - C. C is baked into the reduction: the
+	high half of a product is folded as hi * C, twice, and one conditional
+	subtraction of p finishes it.
+*/
+template<class Elem, uint64_t C>
+struct CrandField {
+	typedef Elem elem;
+	typedef typename Elem::limb_t limb_t;
+	typedef typename Elem::wide_t wide_t;
+	typedef typename Elem::wide_elem wide_elem;
+
+	enum {
+		N = Elem::N,
+		LimbBits = Elem::LimbBits,
+		Bits = Elem::N * Elem::LimbBits,
+	};
+
+	static_assert(C > 0 && C + 2 <= (uint64_t)(limb_t)~(limb_t)0, "C + 2 must fit one limb");
+
+	static GORF_INLINE void prime(Elem& p) {
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) { p.v[i] = (limb_t)~(limb_t)0; }
+		p.v[0] = (limb_t)(0 - (limb_t)C);
+	}
+
+	/* If a >= p then a -= p. a - p = a + C - 2^Bits, so the carry out of a + C tells */
+	static GORF_INLINE void final_sub(Elem& a) {
+		Elem t;
+		limb_t carry = Elem::add_limb(t, a, (limb_t)C);
+		Elem::select(a, a, t, carry);
+	}
+
+	/* r = t mod p, t is double-width */
+	static GORF_INLINE void reduce(Elem& r, const wide_elem& t) {
+		//NOTE(dima): 2^Bits = C mod p, so t = lo + hi * C
+		limb_t carry = 0;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			wide_t x = (wide_t)t.v[N + i] * (limb_t)C + t.v[i] + carry;
+			r.v[i] = (limb_t)x;
+			carry = (limb_t)(x >> LimbBits);
+		}
+
+		//NOTE(dima): Second fold, carry * C can take more than one limb for small limbs
+		wide_t x = (wide_t)carry * (limb_t)C;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) {
+			x += r.v[i];
+			r.v[i] = (limb_t)x;
+			x >>= LimbBits;
+		}
+
+		//NOTE(dima): If it wrapped once more, r is tiny now and + C can not overflow
+		Elem::add_limb(r, r, (limb_t)((limb_t)x * (limb_t)C));
+		final_sub(r);
+	}
+
+	static GORF_INLINE void add(Elem& r, const Elem& a, const Elem& b) {
+		Elem t;
+		Elem u;
+		limb_t carry = Elem::add(t, a, b);
+		carry |= Elem::add_limb(u, t, (limb_t)C);
+		Elem::select(r, t, u, carry);
+	}
+
+	static GORF_INLINE void sub(Elem& r, const Elem& a, const Elem& b) {
+		Elem t;
+		Elem u;
+		limb_t borrow = Elem::sub(t, a, b);
+
+		//NOTE(dima): t + p = t - C mod 2^Bits
+		Elem::sub_limb(u, t, (limb_t)C);
+		Elem::select(r, t, u, borrow);
+	}
+
+	static GORF_INLINE void neg(Elem& r, const Elem& a) {
+		Elem z;
+		Elem::zero(z);
+		sub(r, z, a);
+	}
+
+	static GORF_INLINE void mul(Elem& r, const Elem& a, const Elem& b) {
+		wide_elem t;
+		Elem::mul(t, a, b);
+		reduce(r, t);
+	}
+
+	static GORF_INLINE void sqr(Elem& r, const Elem& a) {
+		wide_elem t;
+		Elem::sqr(t, a);
+		reduce(r, t);
+	}
+
+	/*
+		r = a ^ -1 = a ^ (p - 2), a != 0. Fixed 4-bit windows over the public
+		exponent, so it runs in the same time for every a.
+	*/
+	static void inv(Elem& r, const Elem& a) {
+		Elem e;
+		GORF_UNROLL
+		for (int i = 0; i < N; i++) { e.v[i] = (limb_t)~(limb_t)0; }
+		e.v[0] = (limb_t)(0 - (limb_t)(C + 2));
+
+		Elem table[16];
+		Elem::from_uint(table[0], 1);
+		for (int i = 1; i < 16; i++) {
+			mul(table[i], table[i - 1], a);
+		}
+
+		Elem acc = table[0];
+		for (int i = Bits - 4; i >= 0; i -= 4) {
+			sqr(acc, acc);
+			sqr(acc, acc);
+			sqr(acc, acc);
+			sqr(acc, acc);
+
+			int digit = (int)((e.v[i / LimbBits] >> (i % LimbBits)) & 0xF);
+			mul(acc, acc, table[digit]);
+		}
+
+		r = acc;
+	}
+};
+
+/*
+	NOTE(dima): bign primes, p = 2^(4 * level) - C. Limb is free, so the same
+	level can be instantiated several times for different targets.
+*/
+template<class Limb> using Bign128Field = CrandField<FieldElem<256, Limb>, 189>;
+template<class Limb> using Bign192Field = CrandField<FieldElem<384, Limb>, 317>;
+template<class Limb> using Bign256Field = CrandField<FieldElem<512, Limb>, 569>;
+
+template<class F>
+struct EcPoint {
+	typename F::elem x;
+	typename F::elem y;
+	typename F::elem z;
+
+	int is_inf;
+};
+
+template<class F>
+struct EcCurve {
+	typedef F field;
+	typedef typename F::elem elem;
+
+	elem a;
+	elem b;
+	elem q; /* group order, same width as p */
+
+	EcPoint<F> g;
+
+	int a_is_minus3; /* A = p - 3 allows cheaper doubling */
+};
+
+template<class F>
+void pt_clear(EcPoint<F>* p) {
+	F::elem::zero(p->x);
+	F::elem::zero(p->y);
+	F::elem::from_uint(p->z, 1);
+	p->is_inf = 1;
+}
+
+/*
+	Loading curve parameters from little-endian bytes, size bytes each (like
+	gorbn_from_data). Generator is affine.
+*/
+template<class F>
+void curve_load(
+	EcCurve<F>* crv,
+	const void* a, const void* b, const void* q,
+	const void* xg, const void* yg,
+	int size)
+{
+	typedef typename F::elem elem;
+
+	elem::from_data(crv->a, a, size);
+	elem::from_data(crv->b, b, size);
+	elem::from_data(crv->q, q, size);
+	elem::from_data(crv->g.x, xg, size);
+	elem::from_data(crv->g.y, yg, size);
+	elem::from_uint(crv->g.z, 1);
+	crv->g.is_inf = 0;
+
+	elem minus3;
+	elem three;
+	elem::from_uint(three, 3);
+	F::neg(minus3, three);
+	crv->a_is_minus3 = elem::equal(crv->a, minus3);
+}
+
+/* Standard bign parameters of the 128-bit level, same as gorec_load_stb128() */
+template<class Limb>
+void curve_load_stb128(EcCurve<Bign128Field<Limb> >* crv) {
+	static const unsigned char a[32] = {
+		0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	};
+
+	static const unsigned char b[32] = {
+		0xF1, 0x03, 0x9C, 0xD6, 0x6B, 0x7D, 0x2E, 0xB2,
+		0x53, 0x92, 0x8B, 0x97, 0x69, 0x50, 0xF5, 0x4C,
+		0xBE, 0xFB, 0xD8, 0xE4, 0xAB, 0x3A, 0xC1, 0xD2,
+		0xED, 0xA8, 0xF3, 0x15, 0x15, 0x6C, 0xCE, 0x77,
+	};
+
+	static const unsigned char q[32] = {
+		0x07, 0x66, 0x3D, 0x26, 0x99, 0xBF, 0x5A, 0x7E,
+		0xFC, 0x4D, 0xFB, 0x0D, 0xD6, 0x8E, 0x5C, 0xD9,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	};
+
+	static const unsigned char yg[32] = {
+		0x93, 0x6A, 0x51, 0x04, 0x18, 0xCF, 0x29, 0x1E,
+		0x52, 0xF6, 0x08, 0xC4, 0x66, 0x39, 0x91, 0x78,
+		0x5D, 0x83, 0xD6, 0x51, 0xA3, 0xC9, 0xE4, 0x5C,
+		0x9F, 0xD6, 0x16, 0xFB, 0x3C, 0xFC, 0xF7, 0x6B,
+	};
+
+	static const unsigned char xg[32] = { 0 };
+
+	curve_load(crv, a, b, q, xg, yg, 32);
+}
+
+/* Point doubling in Jacobian coordinates */
+template<class F>
+void pt_double_jacobian(EcPoint<F>* r, const EcPoint<F>* a, const EcCurve<F>* crv) {
+	typedef typename F::elem elem;
+
+	if (a->is_inf) {
+		*r = *a;
+		return;
+	}
+
+	elem S, M, TMP, YSQ;
+	EcPoint<F> rp;
+
+	// S = 4*X*Y^2
+	F::sqr(YSQ, a->y);
+	F::mul(S, a->x, YSQ);
+	F::add(S, S, S);
+	F::add(S, S, S);
+
+	if (crv->a_is_minus3) {
+		// M = 3*(X - Z^2)*(X + Z^2)
+		F::sqr(TMP, a->z);
+		F::sub(M, a->x, TMP);
+		F::add(TMP, a->x, TMP);
+		F::mul(M, M, TMP);
+		F::add(TMP, M, M);
+		F::add(M, M, TMP);
+	}
+	else {
+		// M = 3*X^2 + a*Z^4
+		F::sqr(TMP, a->z);
+		F::sqr(TMP, TMP);
+		F::mul(TMP, TMP, crv->a);
+		F::sqr(M, a->x);
+		F::add(TMP, TMP, M);
+		F::add(M, M, M);
+		F::add(M, M, TMP);
+	}
+
+	// X' = M^2 - 2*S
+	F::sqr(rp.x, M);
+	F::add(TMP, S, S);
+	F::sub(rp.x, rp.x, TMP);
+
+	// Y' = M*(S - X') - 8 * Y ^ 4
+	F::sub(rp.y, S, rp.x);
+	F::mul(rp.y, M, rp.y);
+	F::sqr(TMP, YSQ);
+	F::add(TMP, TMP, TMP);
+	F::add(TMP, TMP, TMP);
+	F::add(TMP, TMP, TMP);
+	F::sub(rp.y, rp.y, TMP);
+
+	// Z' = 2*Y*Z
+	F::mul(rp.z, a->y, a->z);
+	F::add(rp.z, rp.z, rp.z);
+
+	rp.is_inf = 0;
+	*r = rp;
+}
+
+/* Point addition in Jacobian coordinates, see gorec_pt_add_jacobian() */
+template<class F>
+void pt_add_jacobian(EcPoint<F>* r, const EcPoint<F>* a, const EcPoint<F>* b, const EcCurve<F>* crv) {
+	typedef typename F::elem elem;
+
+	if (a->is_inf) {
+		*r = *b;
+		return;
+	}
+
+	if (b->is_inf) {
+		*r = *a;
+		return;
+	}
+
+	elem U1, U2, S1, S2, TMP, H, R, HH, HHH, V;
+	EcPoint<F> rp;
+
+	// U1 = X1*Z2^2
+	// U2 = X2*Z1^2
+	// S1 = Y1*Z2^3
+	// S2 = Y2*Z1^3
+	F::sqr(TMP, b->z);
+	F::mul(U1, a->x, TMP);
+	F::mul(S1, TMP, a->y);
+	F::mul(S1, S1, b->z);
+	F::sqr(TMP, a->z);
+	F::mul(U2, TMP, b->x);
+	F::mul(S2, TMP, b->y);
+	F::mul(S2, S2, a->z);
+
+	if (elem::equal(U1, U2)) {
+		if (!elem::equal(S1, S2)) {
+			pt_clear(r);
+		}
+		else {
+			pt_double_jacobian(r, a, crv);
+		}
+		return;
+	}
+
+	// Z3 = H*Z1*Z2
+	F::sub(H, U2, U1);
+	F::mul(TMP, a->z, b->z);
+	F::mul(rp.z, TMP, H);
+
+	// X3 = R^2 - H^3 - 2*U1*H^2
+	// Y3 = R*(U1*H^2 - X3) - S1*H^3
+	F::sub(R, S2, S1);
+	F::sqr(HH, H);
+	F::mul(HHH, HH, H);
+	F::mul(V, HH, U1);
+
+	F::sqr(rp.x, R);
+	F::sub(rp.x, rp.x, HHH);
+	F::sub(rp.x, rp.x, V);
+	F::sub(rp.x, rp.x, V);
+
+	F::sub(V, V, rp.x);
+	F::mul(V, V, R);
+	F::mul(HHH, HHH, S1);
+	F::sub(rp.y, V, HHH);
+
+	rp.is_inf = 0;
+	*r = rp;
+}
+
+/* Back to affine coordinates, Z = 1 */
+template<class F>
+void pt_to_affine(EcPoint<F>* r, const EcPoint<F>* p) {
+	typedef typename F::elem elem;
+
+	if (p->is_inf) {
+		*r = *p;
+		return;
+	}
+
+	elem zinv, zinv2;
+
+	F::inv(zinv, p->z);
+	F::sqr(zinv2, zinv);
+	F::mul(r->x, p->x, zinv2);
+	F::mul(zinv2, zinv2, zinv);
+	F::mul(r->y, p->y, zinv2);
+	elem::from_uint(r->z, 1);
+	r->is_inf = 0;
+}
+
+/*
+	r = s * p with 4-bit fixed windows, result is affine. Scalar is a number
+	of the same width as the field, p may be affine or Jacobian.
+*/
+template<class F>
+void pt_mul_jacobian(EcPoint<F>* r, const EcPoint<F>* p, const typename F::elem& s, const EcCurve<F>* crv) {
+	typedef typename F::elem elem;
+
+	EcPoint<F> table[16];
+	EcPoint<F> result;
+
+	pt_clear(&table[0]);
+	table[1] = *p;
+	for (int i = 2; i < 16; i++) {
+		pt_add_jacobian(&table[i], &table[i - 1], p, crv);
+	}
+
+	pt_clear(&result);
+
+	int t = elem::nbits(s);
+	int top = ((t + 3) / 4) * 4;
+	for (int i = top - 4; i >= 0; i -= 4) {
+		pt_double_jacobian(&result, &result, crv);
+		pt_double_jacobian(&result, &result, crv);
+		pt_double_jacobian(&result, &result, crv);
+		pt_double_jacobian(&result, &result, crv);
+
+		int digit =
+			elem::bit(s, i) |
+			(elem::bit(s, i + 1) << 1) |
+			(elem::bit(s, i + 2) << 2) |
+			(elem::bit(s, i + 3) << 3);
+		if (digit) {
+			pt_add_jacobian(&result, &result, &table[digit], crv);
+		}
+	}
+
+	pt_to_affine(r, &result);
+}
+
+/* Checks y^2 = x^3 + a*x + b for an affine point */
+template<class F>
+int pt_is_on_curve(const EcPoint<F>* p, const EcCurve<F>* crv) {
+	typedef typename F::elem elem;
+
+	if (p->is_inf) {
+		return(1);
+	}
+
+	elem lhs, rhs;
+
+	F::sqr(lhs, p->y);
+	F::sqr(rhs, p->x);
+	F::add(rhs, rhs, crv->a);
+	F::mul(rhs, rhs, p->x);
+	F::add(rhs, rhs, crv->b);
+
+	return(elem::equal(lhs, rhs));
+}
+
+}
+
+#endif